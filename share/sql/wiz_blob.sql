@@ -0,0 +1,7 @@
+create table WIZ_BLOB
+(
+   BLOB_MD5                       char(32)                       not null,
+   BLOB_SIZE                      int64,
+   BLOB_REF_COUNT                 int,
+   primary key (BLOB_MD5)
+)
\ No newline at end of file
@@ -0,0 +1,11 @@
+create virtual table WIZ_DOCUMENT_INFO_FTS using fts4
+(
+   DOCUMENT_TITLE,
+   DOCUMENT_NAME,
+   DOCUMENT_SEO,
+   DOCUMENT_URL,
+   DOCUMENT_AUTHOR,
+   DOCUMENT_KEYWORDS,
+   DOCUMENT_OWNER,
+   DOCUMENT_GUID
+)
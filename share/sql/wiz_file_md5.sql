@@ -0,0 +1,9 @@
+create table WIZ_FILE_MD5
+(
+   FILE_NAME                      varchar(1000)                  not null,
+   FILE_SIZE                      int64,
+   FILE_MODIFIED                  int64,
+   FILE_INODE                     int64,
+   FILE_MD5                       char(32),
+   primary key (FILE_NAME)
+)
\ No newline at end of file
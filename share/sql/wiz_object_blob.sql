@@ -0,0 +1,8 @@
+create table WIZ_OBJECT_BLOB
+(
+   OBJECT_GUID                    char(36)                       not null,
+   BLOB_NAME                      varchar(300)                   not null,
+   OBJECT_DATA_MD5                char(32),
+   BLOB_MD5                       char(32)                       not null,
+   primary key (OBJECT_GUID, BLOB_NAME)
+)
\ No newline at end of file
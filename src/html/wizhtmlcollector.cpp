@@ -1,11 +1,37 @@
 #include "wizhtmlcollector.h"
 #include "../share/wizhtml2zip.h"
 #include "../share/wizObjectDataDownloader.h"
-#include <QEventLoop>
+#include <QCoreApplication>
 #include <QFile>
-#include <QTimer>
+#include <QSemaphore>
+#include <QSharedPointer>
 #include <QDebug>
 
+// wait for each image for 15 seconds after its download started
+#define WIZHTML_DOWNLOAD_TIMEOUT (15 * 1000)
+
+// tell collector when done, semaphore is shared because collector may stop
+// waiting before download is done
+class CWizHtmlResourceDownloader : public CWizFileDownloader
+{
+public:
+    CWizHtmlResourceDownloader(const QString& strUrl, const QString& strFileName,
+                               const QString& strPath, QSharedPointer<QSemaphore> semaphore)
+        : CWizFileDownloader(strUrl, strFileName, strPath)
+        , m_semaphore(semaphore)
+    {
+    }
+
+    virtual void run()
+    {
+        CWizFileDownloader::run();
+        m_semaphore->release();
+    }
+
+private:
+    QSharedPointer<QSemaphore> m_semaphore;
+};
+
 bool CWizHtmlFileMap::Lookup(const QString& strUrl, QString& strFileName)
 {
     QString strKey(strUrl.toLower());
@@ -191,31 +217,60 @@ void CWizHtmlCollector::ProcessImgTagValue(CWizHtmlTag* pTag, const QString& str
     QString strShme = url.scheme().toLower();
     if (strShme == "http" || strShme == "https" || strShme == "ftp")
     {
-        //
-        qDebug() << "[Save] Start to download image : " << strValue;
-        QString strFileName = ::WizGenGUIDLowerCaseLetterOnly()
+        // all images are downloaded at the same time after parsing, tag is
+        // pointed to local image now and restored if download failed
+        WIZHTMLDOWNLOADDATA data;
+        data.strUrl = strValue;
+        data.strFileName = ::WizGenGUIDLowerCaseLetterOnly()
                 + strValue.right(strValue.length() - strValue.lastIndexOf('.'));
-        CWizFileDownloader* downloader = new CWizFileDownloader(strValue, strFileName, m_strTempPath);
-        QEventLoop loop;
-        loop.connect(downloader, SIGNAL(downloadDone(QString,bool)), &loop, SLOT(quit()));
+        data.strTag = pTag->getTag();
+        data.nIndex = m_ret.size();
+        m_downloads.push_back(data);
+
+        pTag->setValueToName(strAttributeName, ToResourceFileName(m_strTempPath + data.strFileName));
+        return;
+    }
+
+    ProcessTagValue(pTag, strAttributeName, eType);
+}
+
+void CWizHtmlCollector::DownloadResources()
+{
+    if (m_downloads.empty())
+        return;
+
+    QSharedPointer<QSemaphore> semaphore(new QSemaphore(0));
+    std::deque<WIZHTMLDOWNLOADDATA>::const_iterator it;
+    for (it = m_downloads.begin(); it != m_downloads.end(); it++) {
+        qDebug() << "[Save] Start to download image : " << it->strUrl;
+        CWizHtmlResourceDownloader* downloader = new CWizHtmlResourceDownloader(it->strUrl,
+                                                                                it->strFileName,
+                                                                                m_strTempPath,
+                                                                                semaphore);
+        downloader->setTimeout(WIZHTML_DOWNLOAD_TIMEOUT);
         downloader->startDownload();
-        //  just wait for 15 seconds
-        QTimer::singleShot(15 * 1000, &loop, SLOT(quit()));
-        loop.exec();
-        //
+    }
 
-        QString strFile = m_strTempPath + strFileName;
-        if (QFile::exists(strFile))
-        {
+    // keep ui responsive while waiting, same as event loop before. every
+    // download gives up by itself, images queued in thread pool still get
+    // their full time once started
+    int nCount = m_downloads.size();
+    while (!semaphore->tryAcquire(nCount, 50)) {
+        QCoreApplication::processEvents();
+    }
+
+    for (it = m_downloads.begin(); it != m_downloads.end(); it++) {
+        QString strFile = m_strTempPath + it->strFileName;
+        if (QFile::exists(strFile)) {
             qDebug() <<"[Save] change to local image : " << strFile;
             QString strAbsFile = "file://" + strFile;
-            m_files.Add(strAbsFile, strFile, eType, false);
-            pTag->setValueToName(strAttributeName, ToResourceFileName(strFile));
-            return;
+            m_files.Add(strAbsFile, strFile, WIZHTMLFILEDATA::typeResource, false);
+        } else {
+            m_ret[it->nIndex] = it->strTag;
         }
     }
 
-    ProcessTagValue(pTag, strAttributeName, eType);
+    m_downloads.clear();
 }
 
 QString CWizHtmlCollector::ToResourceFileName(const QString& strFileName)
@@ -233,6 +288,7 @@ bool CWizHtmlCollector::Collect(const QString& strUrl, \
                                 const QString& strTempPath)
 {
     m_ret.clear();
+    m_downloads.clear();
     m_bMainPage = mainPage;
     m_strTempPath = strTempPath;
     //
@@ -247,9 +303,13 @@ bool CWizHtmlCollector::Collect(const QString& strUrl, \
 
     CWizHtmlReader reader;
     reader.setEventHandler(this);
+    // only a few attributes of resource tags are used
+    reader.setBoolOption(CWizHtmlReader::lazyAttributes, true);
 
     reader.Read(strHtml);
 
+    DownloadResources();
+
     CString strHtml2 = strHtml;
 
     ::WizStringArrayToText(m_ret, strHtml2, "");
@@ -259,7 +319,8 @@ bool CWizHtmlCollector::Collect(const QString& strUrl, \
 
 bool CWizHtmlCollector::Html2Zip(const QString& strExtResourcePath, \
                                  const QString& strMetaText, \
-                                 const QString& strZipFileName)
+                                 const QString& strZipFileName, \
+                                 WIZHTML2ZIPRESULT* pResult /*= NULL*/)
 {
     //CString strMainHtml(strHtml);
     //if (!Collect(strUrl, strMainHtml, true))
@@ -292,38 +353,215 @@ bool CWizHtmlCollector::Html2Zip(const QString& strExtResourcePath, \
     CWizStdStringArray arrayAllResource;
     arrayAllResource.assign(files.begin(), files.end());
 
-    return WizHtml2Zip(strRet, arrayAllResource, strMetaText, strZipFileName);
+    return WizHtml2Zip(strRet, arrayAllResource, strMetaText, strZipFileName, pResult);
 }
 
 /* -------------------------- CWizHtmlToPlainText -------------------------- */
+#define WIZHTML_ENTITY_MAX 12
+
+static bool WizHtmlIsNameChar(ushort ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9');
+}
+
+static bool WizHtmlIsName(const ushort* p, int nLen, const char* lpszName)
+{
+    int i = 0;
+    for (; i < nLen && lpszName[i]; i++) {
+        ushort ch = p[i];
+        if (ch >= 'A' && ch <= 'Z')
+            ch += 'a' - 'A';
+
+        if (ch != lpszName[i])
+            return false;
+    }
+
+    return i == nLen && !lpszName[i];
+}
+
+// content of these elements are not text of note
+static bool WizHtmlIsSkippedTag(const ushort* p, int nLen)
+{
+    return WizHtmlIsName(p, nLen, "script")
+            || WizHtmlIsName(p, nLen, "style")
+            || WizHtmlIsName(p, nLen, "head")
+            || WizHtmlIsName(p, nLen, "title");
+}
+
+// return position after closing tag, or NULL if not found
+static const ushort* WizHtmlFindEndTag(const ushort* p, const ushort* pEnd,
+                                       const ushort* pName, int nNameLen)
+{
+    for (; p < pEnd; p++) {
+        if (p[0] != '<' || p + 1 >= pEnd || p[1] != '/')
+            continue;
+
+        const ushort* q = p + 2;
+        if (pEnd - q < nNameLen || WizHtmlIsNameChar(q[nNameLen]))
+            continue;
+
+        int i = 0;
+        for (; i < nNameLen; i++) {
+            if (QChar::toLower(q[i]) != QChar::toLower(pName[i]))
+                break;
+        }
+
+        if (i < nNameLen)
+            continue;
+
+        for (q += nNameLen; q < pEnd && *q != '>'; q++)
+            ;
+
+        return q < pEnd ? q + 1 : pEnd;
+    }
+
+    return NULL;
+}
+
 CWizHtmlToPlainText::CWizHtmlToPlainText()
+    : m_bSpace(true)
 {
 }
 
-bool CWizHtmlToPlainText::toText(const QString& strHtmlAll, QString& strPlainText)
+bool CWizHtmlToPlainText::toText(const QString& strHtml, QString& strPlainText, int nMaxLength)
 {
     m_strText.clear();
+    m_strText.reserve(nMaxLength >= 0 ? qMin(nMaxLength + 1, strHtml.length()) : strHtml.length() / 2);
+    m_bSpace = true;
+
+    const ushort* p = strHtml.utf16();
+    const ushort* pEnd = p + strHtml.length();
+    while (p < pEnd) {
+        if (nMaxLength >= 0 && m_strText.length() > nMaxLength)
+            break;
+
+        ushort ch = *p;
+        if (ch == '<') {
+            p = skipTag(p, pEnd);
+            continue;
+        }
+
+        if (ch == '&') {
+            // copy entity, resolver should never scan to end of document
+            ushort szEntity[WIZHTML_ENTITY_MAX + 2];
+            int n = 0;
+            for (; n < WIZHTML_ENTITY_MAX && p + n < pEnd && p[n] != ';'; n++)
+                szEntity[n] = p[n];
+
+            if (p + n < pEnd && p[n] == ';') {
+                szEntity[n] = ';';
+                szEntity[n + 1] = 0;
+
+                ushort chSubst = 0;
+                UINT nLen = ::WizHtmlResolveEntity(szEntity, chSubst);
+                if (nLen) {
+                    appendChar(chSubst);
+                    p += nLen;
+                    continue;
+                }
+            }
+        }
 
-    // remove head or title if exists
-    QString strHtml = strHtmlAll;
-    strHtml.replace(QRegExp("<head>.*</head>", Qt::CaseInsensitive), "");
-    strHtml.replace(QRegExp("<title>.*</title>", Qt::CaseInsensitive), "");
+        appendChar(ch);
+        p++;
+    }
 
-    CWizHtmlReader reader;
-    reader.setEventHandler(this);
-    reader.setBoolOption(CWizHtmlReader::resolveEntities, true);
+    if (m_bSpace && !m_strText.isEmpty())
+        m_strText.chop(1);
 
-    reader.Read(strHtml);
+    if (nMaxLength >= 0 && m_strText.length() > nMaxLength)
+        m_strText.truncate(nMaxLength);
 
-    m_strText.replace('\0', ' '); // otherwise sqlite statement will be failed!
-    strPlainText = m_strText.simplified();
+    strPlainText = m_strText;
     return true;
 }
 
-void CWizHtmlToPlainText::Characters(const CString &rText, DWORD dwAppData, bool &bAbort)
+void CWizHtmlToPlainText::appendChar(ushort ch)
 {
-    Q_UNUSED(dwAppData);
-    Q_UNUSED(bAbort);
+    // '\0' should be removed too, otherwise sqlite statement will be failed!
+    if (ch == 0 || ch == ' ' || ((ch > 0x7f || ch < ' ') && QChar(ch).isSpace())) {
+        appendSpace();
+        return;
+    }
+
+    m_strText.append(QChar(ch));
+    m_bSpace = false;
+}
+
+void CWizHtmlToPlainText::appendSpace()
+{
+    if (m_bSpace)
+        return;
+
+    m_strText.append(QChar(' '));
+    m_bSpace = true;
+}
+
+const ushort* CWizHtmlToPlainText::skipTag(const ushort* p, const ushort* pEnd)
+{
+    const ushort* q = p + 1;
+
+    // comment
+    if (pEnd - q >= 3 && q[0] == '!' && q[1] == '-' && q[2] == '-') {
+        for (q += 3; q + 2 < pEnd; q++) {
+            if (q[0] == '-' && q[1] == '-' && q[2] == '>')
+                return q + 3;
+        }
+
+        return pEnd;
+    }
+
+    bool bEndTag = false;
+    if (q < pEnd && *q == '/') {
+        bEndTag = true;
+        q++;
+    }
+
+    // not a tag, such as "a < b"
+    if (q >= pEnd || !(WizHtmlIsNameChar(*q) || (!bEndTag && (*q == '!' || *q == '?')))) {
+        appendChar('<');
+        return p + 1;
+    }
+
+    const ushort* pName = q;
+    while (q < pEnd && WizHtmlIsNameChar(*q))
+        q++;
+
+    int nNameLen = q - pName;
+
+    // skip attributes, value quoted after '=' may contain '>'
+    ushort chQuote = 0;
+    ushort chPrev = 0;
+    for (; q < pEnd; q++) {
+        ushort ch = *q;
+        if (chQuote) {
+            if (ch == chQuote)
+                chQuote = 0;
+        } else if ((ch == '"' || ch == '\'') && chPrev == '=') {
+            chQuote = ch;
+        } else if (ch == '>') {
+            break;
+        }
+
+        if (!::wiz_isspace(ch))
+            chPrev = ch;
+    }
+
+    if (q >= pEnd)
+        return pEnd;
+
+    bool bEmptyTag = q[-1] == '/';
+    q++;
+
+    // tags separate words
+    appendSpace();
+
+    if (!bEndTag && !bEmptyTag && WizHtmlIsSkippedTag(pName, nNameLen)) {
+        // keep going if element is not closed
+        const ushort* pClosed = WizHtmlFindEndTag(q, pEnd, pName, nNameLen);
+        if (pClosed)
+            return pClosed;
+    }
 
-    m_strText.push_back(rText + " ");
+    return q;
 }
@@ -5,6 +5,8 @@
 #include "../share/wizmisc.h"
 #include <QUrl>
 
+struct WIZHTML2ZIPRESULT;
+
 struct WIZHTMLFILEDATA
 {
     enum HtmlFileType { typeResource, typeFrame, typeCSS };
@@ -16,6 +18,17 @@ struct WIZHTMLFILEDATA
     WIZHTMLFILEDATA() : eType(typeResource), bProcessed(false) {}
 };
 
+// remote image downloaded after html is parsed
+struct WIZHTMLDOWNLOADDATA
+{
+    QString strUrl;
+    QString strFileName;
+    QString strTag;     // original tag, restored if download failed
+    int nIndex;         // index of tag in collected html
+
+    WIZHTMLDOWNLOADDATA() : nIndex(-1) {}
+};
+
 /* ---------------------------- CWizHtmlFileMap ---------------------------- */
 class CWizHtmlFileMap
 {
@@ -41,7 +54,7 @@ public:
 
     bool Collect(const QString &strUrl, QString &strHtml, bool mainPage, const QString& strTempPath);
     bool Html2Zip(const QString& strExtResourcePath, const QString& strMetaText, \
-                  const QString& strZipFileName);
+                  const QString& strZipFileName, WIZHTML2ZIPRESULT* pResult = NULL);
 
 protected:
     virtual void StartTag(CWizHtmlTag *pTag, DWORD dwAppData, bool &bAbort);
@@ -55,25 +68,32 @@ private:
     QUrl m_url;
     CWizStdStringArray m_ret;
     QString m_strTempPath;
+    std::deque<WIZHTMLDOWNLOADDATA> m_downloads;
 
     void ProcessTagValue(CWizHtmlTag *pTag, const QString& strAttributeName,
                          WIZHTMLFILEDATA::HtmlFileType eType);
     void ProcessImgTagValue(CWizHtmlTag *pTag, const QString& strAttributeName,
                          WIZHTMLFILEDATA::HtmlFileType eType);
     QString ToResourceFileName(const QString &strFileName);
+    void DownloadResources();
 };
 
-class CWizHtmlToPlainText : public IWizHtmlReaderEvents
+// single pass text extractor, only used for search index and abstract, so
+// attributes are never parsed and script, style, head and title are skipped
+class CWizHtmlToPlainText
 {
 public:
     CWizHtmlToPlainText();
-    bool toText(const QString& strHtml, QString& strPlainText);
-
-protected:
-    virtual void Characters(const CString& rText, DWORD dwAppData, bool& bAbort);
+    // stop after nMaxLength characters if nMaxLength >= 0
+    bool toText(const QString& strHtml, QString& strPlainText, int nMaxLength = -1);
 
 private:
     QString m_strText;
+    bool m_bSpace;
+
+    void appendChar(ushort ch);
+    void appendSpace();
+    const ushort* skipTag(const ushort* p, const ushort* pEnd);
 };
 
 #endif // WIZHTMLCOLLECTOR_H
@@ -240,6 +240,11 @@ private:
 
 CWizHtmlEntityResolver::CCharEntityRefs CWizHtmlEntityResolver::m_CharEntityRefs;
 
+UINT WizHtmlResolveEntity(const unsigned short* lpszEntity, unsigned short &chSubst)
+{
+    return CWizHtmlEntityResolver::resolveEntity(lpszEntity, chSubst);
+}
+
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -720,6 +725,59 @@ UINT CWizHtmlElemAttr::parseFromStr(const unsigned short* lpszString)
 
     return (0U);
 }
+UINT CWizHtmlElemAttr::skipFromStr(const unsigned short* lpszString)
+{
+    const unsigned short*	lpszBegin = lpszString;
+    const unsigned short*	lpszEnd;
+    unsigned short	ch = 0;
+
+    while (::wiz_isspace(*lpszBegin))
+        lpszBegin = ::wiz_strinc(lpszBegin);
+
+    if (!::wiz_isalpha(*lpszBegin))
+        return (0U);
+
+    // attribute name, same rules as parseFromStr
+    lpszEnd = lpszBegin;
+    while (::wiz_isalnum(*lpszEnd) || *lpszEnd == _T('-') || *lpszEnd == _T(':') ||
+           *lpszEnd == _T('_') || *lpszEnd == _T('.'))
+        lpszEnd = ::wiz_strinc(lpszEnd);
+
+    if (!(*lpszEnd == 0 || ::wiz_isspace(*lpszEnd) ||
+          *lpszEnd == _T('=') ||
+          *lpszEnd == _T('>') || *lpszEnd == _T('/')))
+        return (0U);
+
+    if (*lpszEnd != _T('='))
+        return (lpszEnd - lpszString);
+
+    do {
+        lpszEnd = ::wiz_strinc(lpszEnd);
+    } while (::wiz_isspace(*lpszEnd));
+
+    ch = *lpszEnd;
+    if (ch == _T('\'') || ch == _T('\"'))
+    {
+        do
+        {
+            lpszEnd = ::wiz_strinc(lpszEnd);
+        }
+        while (*lpszEnd != 0 && *lpszEnd != ch);
+    }
+    else
+    {
+        do
+        {
+            lpszEnd = ::wiz_strinc(lpszEnd);
+        }
+        while (*lpszEnd != 0 && !::wiz_isspace(*lpszEnd) &&
+               *lpszEnd != _T('>'));
+    }
+
+    return ((lpszEnd - lpszString) +
+            (ch == _T('\'') || ch == _T('\"') ? 1 : 0) );
+}
+
 CString CWizHtmlElemAttr::toString()const
 {
     if (-1 == m_strAttrValue.Find('"'))
@@ -859,6 +917,18 @@ bool CWizHtmlAttributes::removeAll(void)
     return (true);
 }
 
+UINT CWizHtmlAttributes::skipFromStr(const unsigned short* lpszString)
+{
+    // stops at the end of tag, so string length is never needed
+    UINT nRetVal = 0U, nTemp = 0U;
+    while ((nTemp = CWizHtmlElemAttr::skipFromStr(&lpszString[nRetVal])) != 0)
+    {
+        nRetVal += nTemp;
+    }
+
+    return (nRetVal);
+}
+
 UINT CWizHtmlAttributes::parseFromStr(const unsigned short* lpszString)
 {
     CElemAttrArray		*pcoll = NULL;
@@ -1174,6 +1244,8 @@ const unsigned short* GetScriptSource(const unsigned short* lpszUnparsed, CStrin
 
 CWizHtmlTag::CWizHtmlTag(CWizHtmlTag &rSource, bool bCopy)
     : m_pcollAttr(NULL)
+    , m_nAttrStart(rSource.m_nAttrStart)
+    , m_nAttrLen(rSource.m_nAttrLen)
     , m_strTagName(rSource.m_strTagName)
     , m_strTag(rSource.m_strTag)
     , m_bIsOpeningTag(rSource.m_bIsOpeningTag)
@@ -1194,11 +1266,14 @@ CWizHtmlTag::CWizHtmlTag(CWizHtmlTag &rSource, bool bCopy)
 UINT CWizHtmlTag::parseFromStr(const unsigned short* lpszString,
                                       bool &bIsOpeningTag,
                                       bool &bIsClosingTag,
-                                      bool bParseAttrib /* = true */)
+                                      bool bParseAttrib /* = true */,
+                                      bool bLazyAttrib /* = false */)
 {
     bool				bClosingTag = false;
     bool				bOpeningTag = false;
     CWizHtmlAttributes	*pcollAttr = NULL;
+    int                 nAttrStart = 0,
+    nAttrLen = 0;
     CString				strTagName;
     UINT				nRetVal = 0U,
     nTemp = 0U;
@@ -1337,7 +1412,13 @@ UINT CWizHtmlTag::parseFromStr(const unsigned short* lpszString,
             lpszBegin = ::wiz_strinc(lpszBegin);
 
         nTemp = 0U;
-        if (bParseAttrib)	// parse attribute/value pairs?
+        if (bParseAttrib && bLazyAttrib)	// only locate attribute/value pairs?
+        {
+            nTemp = CWizHtmlAttributes::skipFromStr(lpszBegin);
+            nAttrStart = lpszBegin - lpszString;
+            nAttrLen = nTemp;
+        }
+        else if (bParseAttrib)	// parse attribute/value pairs?
         {
             ATLASSERT(pcollAttr == NULL);
             // instantiate collection ...
@@ -1427,11 +1508,34 @@ UINT CWizHtmlTag::parseFromStr(const unsigned short* lpszString,
     WIZ_SAFE_DELETE_POINTER(m_pcollAttr);
     m_pcollAttr = pcollAttr;
     pcollAttr = NULL;
+    m_nAttrStart = nAttrStart;
+    m_nAttrLen = nAttrLen;
     m_bModified = false;
 
     return (nRetVal);
 }
 
+void CWizHtmlTag::ensureAttributes(void) const
+{
+    if (!m_nAttrLen)
+        return;
+
+    // parse attributes from the copy of tag, reader buffer may be gone
+    CString strAttributes = m_strTag.Mid(m_nAttrStart, m_nAttrLen);
+    m_nAttrStart = 0;
+    m_nAttrLen = 0;
+
+    CWizHtmlAttributes* pcollAttr = new CWizHtmlAttributes;
+    if (!pcollAttr->parseFromStr(strAttributes))
+    {
+        WIZ_SAFE_DELETE_POINTER(pcollAttr);
+        return;
+    }
+
+    WIZ_SAFE_DELETE_POINTER(m_pcollAttr);
+    m_pcollAttr = pcollAttr;
+}
+
 CString CWizHtmlTag::getTag(void)
 {
     if (isClosing()
@@ -1463,6 +1567,7 @@ CString CWizHtmlTag::getTag(void)
 
 void CWizHtmlTag::setValueToName(const CString& strAttributeName, const CString& strValue)
 {
+    ensureAttributes();
     if (!m_pcollAttr)
     {
         m_pcollAttr = new CWizHtmlAttributes();
@@ -1475,6 +1580,7 @@ void CWizHtmlTag::setValueToName(const CString& strAttributeName, const CString&
 
 void CWizHtmlTag::removeAttribute(const CString& strAttributeName)
 {
+    ensureAttributes();
     if (!m_pcollAttr)
         return;
     //
@@ -1489,6 +1595,7 @@ void CWizHtmlTag::removeAttribute(const CString& strAttributeName)
 CWizHtmlReader::CWizHtmlReader()
 {
     m_bResolveEntities = false;	    // entities are resolved, by default
+    m_bLazyAttributes = false;	    // attributes are parsed with tag, by default
     m_dwAppData = 0L;	// reasonable default!
     m_dwBufPos = 0L;	// start from the very beginning
     m_dwBufLen = 0L;	// buffer length is unknown yet
@@ -1583,6 +1690,12 @@ bool CWizHtmlReader::getBoolOption(ReaderOptionsEnum option, bool& bCurVal) cons
             bSuccess = true;
             break;
         }
+    case lazyAttributes:
+        {
+            bCurVal = m_bLazyAttributes;
+            bSuccess = true;
+            break;
+        }
     default:
         {
             bSuccess = false;
@@ -1604,6 +1717,12 @@ bool CWizHtmlReader::setBoolOption(ReaderOptionsEnum option, bool bNewVal)
             bSuccess = true;
             break;
         }
+    case lazyAttributes:
+        {
+            m_bLazyAttributes = bNewVal;
+            bSuccess = true;
+            break;
+        }
     default:
         {
             bSuccess = false;
@@ -1669,7 +1788,8 @@ bool CWizHtmlReader::parseTag(CWizHtmlTag &rTag,
     ATLASSERT(m_dwBufPos + 3 <= m_dwBufLen);
 
     UINT nRetVal = rTag.parseFromStr(&m_lpszBuffer[m_dwBufPos],
-                                     bIsOpeningTag, bIsClosingTag);
+                                     bIsOpeningTag, bIsClosingTag,
+                                     true, m_bLazyAttributes);
     if (!nRetVal)
         return (false);
 
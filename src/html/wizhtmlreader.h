@@ -71,6 +71,8 @@ private:
 public:
     // parses an attribute/value pair from the given string
     UINT parseFromStr(const unsigned short* lpszString);
+    // same length as parseFromStr, but nothing is copied
+    static UINT skipFromStr(const unsigned short* lpszString);
     CString toString()const;
 
 // Data Members
@@ -98,6 +100,8 @@ public:
 public:
     // parses attribute/value pairs from the given string
     UINT parseFromStr(const unsigned short* lpszString);
+    // same length as parseFromStr, but nothing is allocated
+    static UINT skipFromStr(const unsigned short* lpszString);
 
 // Attributes
 public:
@@ -131,27 +135,33 @@ class CWizHtmlTag
 {
 // Construction/Destruction
 public:
-    CWizHtmlTag() : m_pcollAttr(NULL), m_bIsOpeningTag(false), m_bIsClosingTag(false), m_bModified(false) { }
+    CWizHtmlTag() : m_pcollAttr(NULL), m_nAttrStart(0), m_nAttrLen(0), m_bIsOpeningTag(false), m_bIsClosingTag(false), m_bModified(false) { }
     CWizHtmlTag(CWizHtmlTag &rSource, bool bCopy = false);
     virtual ~CWizHtmlTag() { WIZ_SAFE_DELETE_POINTER(m_pcollAttr); }
 // Attributes
 public:
     CString getTagName(void) const { return (m_strTagName); }
-    const CWizHtmlAttributes* getAttributes(void) const { return (m_pcollAttr);  }
+    const CWizHtmlAttributes* getAttributes(void) const { ensureAttributes(); return (m_pcollAttr);  }
     bool isOpening(void) const { return m_bIsOpeningTag; }
     bool isClosing(void) const { return m_bIsClosingTag; }
-    CString getValueFromName(const CString& strAttributeName) const { if (!m_pcollAttr) return CString(); return m_pcollAttr->getValueFromName(strAttributeName); }
+    CString getValueFromName(const CString& strAttributeName) const { ensureAttributes(); if (!m_pcollAttr) return CString(); return m_pcollAttr->getValueFromName(strAttributeName); }
     CString getTag(void);
     void setValueToName(const CString& strAttributeName, const CString& strValue);
     void removeAttribute(const CString& strAttributeName);
 
 // Parsing Helpers
 public:
-    UINT parseFromStr(const unsigned short* lpszString, bool &bIsOpeningTag, bool &bIsClosingTag, bool bParseAttrib = true);
+    // if bLazyAttrib, attributes are only located in tag and parsed when used
+    UINT parseFromStr(const unsigned short* lpszString, bool &bIsOpeningTag, bool &bIsClosingTag, bool bParseAttrib = true, bool bLazyAttrib = false);
+
+private:
+    void ensureAttributes(void) const;
 
 // Data Members
 private:
-    CWizHtmlAttributes	*m_pcollAttr;
+    mutable CWizHtmlAttributes	*m_pcollAttr;
+    mutable int         m_nAttrStart;   // offset of attributes in m_strTag, not parsed yet
+    mutable int         m_nAttrLen;
     CString				m_strTagName;
     CString             m_strTag;
     bool m_bIsOpeningTag;
@@ -172,7 +182,8 @@ public:
 	};
 
 	enum ReaderOptionsEnum {
-        resolveEntities	    // determines whether entity references should be resolved
+        resolveEntities,	    // determines whether entity references should be resolved
+        lazyAttributes      // determines whether attributes are parsed only when used
 	};
 
 // Construction/Destruction
@@ -211,6 +222,7 @@ protected:
 
 protected:
 	bool	m_bResolveEntities;
+	bool	m_bLazyAttributes;
 	DWORD	m_dwAppData;
 	DWORD	m_dwBufPos;
 	DWORD	m_dwBufLen;
@@ -219,5 +231,8 @@ protected:
     const unsigned short*	m_lpszBuffer;
 };
 
+// resolve entity reference at lpszEntity, return length of it or 0 if unknown
+UINT WizHtmlResolveEntity(const unsigned short* lpszEntity, unsigned short &chSubst);
+
 
 #endif	// !__WIZHTMLREADER_H__
@@ -260,6 +260,9 @@ int mainCore(int argc, char *argv[])
         QNetworkProxy::setApplicationProxy(proxy);
     }
 
+    // sqlite tuning, must be set before any database is opened
+    CppSQLite3DB::setDefaultOptions(wizSettings.GetDatabaseOptions());
+
 
     // manually login
     if (bFallback) {
@@ -287,6 +290,8 @@ int mainCore(int argc, char *argv[])
     translatorQt.load(strLocaleFile);
     a.installTranslator(&translatorQt);
 
+    CWizDatabase::setBlobStoreEnabled(userSettings.useBlobStore());
+
     CWizDatabaseManager dbMgr(strUserId);
     if (!dbMgr.openAll()) {
         QMessageBox::critical(NULL, "", QObject::tr("Can not open database"));
@@ -119,6 +119,7 @@ const char* CppSQLite3Exception::errorCodeAsString(int nErrCode)
 
 CppSQLite3Query::CppSQLite3Query()
 {
+	mpDB = 0;
 	mpVM = 0;
 	mbEof = true;
 	mnCols = 0;
@@ -128,6 +129,7 @@ CppSQLite3Query::CppSQLite3Query()
 
 CppSQLite3Query::CppSQLite3Query(const CppSQLite3Query& rQuery)
 {
+	mpDB = rQuery.mpDB;
 	mpVM = rQuery.mpVM;
 	// Only one object can own the VM
 	const_cast<CppSQLite3Query&>(rQuery).mpVM = 0;
@@ -171,6 +173,7 @@ CppSQLite3Query& CppSQLite3Query::operator=(const CppSQLite3Query& rQuery)
 	catch (...)
 	{
 	}
+	mpDB = rQuery.mpDB;
 	mpVM = rQuery.mpVM;
 	// Only one object can own the VM
 	const_cast<CppSQLite3Query&>(rQuery).mpVM = 0;
@@ -628,6 +631,25 @@ void CppSQLite3Statement::bind(int nParam, const char* szValue)
 }
 
 
+void CppSQLite3Statement::bind(int nParam, const CString& strValue)
+{
+	if (strValue.isEmpty())
+	{
+		bindNull(nParam);
+		return;
+	}
+
+	checkVM();
+	int nRes = sqlite3_bind_text16(mpVM, nParam, strValue.utf16(),
+								strValue.length() * sizeof(ushort), SQLITE_TRANSIENT);
+
+	if (nRes != SQLITE_OK)
+	{
+        throw CppSQLite3Exception(nRes, "Error binding string param");
+	}
+}
+
+
 void CppSQLite3Statement::bind(int nParam, const int nValue)
 {
 	checkVM();
@@ -640,6 +662,18 @@ void CppSQLite3Statement::bind(int nParam, const int nValue)
 }
 
 
+void CppSQLite3Statement::bind(int nParam, const sqlite_int64 nValue)
+{
+	checkVM();
+	int nRes = sqlite3_bind_int64(mpVM, nParam, nValue);
+
+	if (nRes != SQLITE_OK)
+	{
+        throw CppSQLite3Exception(nRes, "Error binding int64 param");
+	}
+}
+
+
 void CppSQLite3Statement::bind(int nParam, const double dValue)
 {
 	checkVM();
@@ -766,7 +800,56 @@ void CppSQLite3DB::open(const CString& strFile)
         throw CppSQLite3Exception(nRet, szError);
 	}
 
-	setBusyTimeout(mnBusyTimeoutMs);
+	applyOptions(s_defaultOptions);
+}
+
+
+void CppSQLite3DB::applyOptions(const WIZSQLITEOPTIONS& options)
+{
+	setBusyTimeout(options.nBusyTimeout);
+
+	// tuning only, database is still usable if any pragma failed,
+	// eg: WAL is not available on read-only or network file systems
+	QStringList listPragma;
+	listPragma << (options.bWAL ? "pragma journal_mode=WAL" : "pragma journal_mode=DELETE");
+	listPragma << QString("pragma synchronous=%1").arg(options.nSynchronous);
+	// bundled sqlite (3.7.8) takes cache_size in pages only, negative KB
+	// needs 3.7.10, so convert the budget to pages of this database
+	int nPageSize = 0;
+	try
+	{
+		nPageSize = execScalar("pragma page_size");
+	}
+	catch (const CppSQLite3Exception&)
+	{
+	}
+	if (nPageSize <= 0)
+		nPageSize = 1024;
+	listPragma << QString("pragma cache_size=%1").arg(qMax(1, int(qint64(options.nCacheSize) * 1024 / nPageSize)));
+	// ignored by sqlite older than 3.7.17
+	listPragma << QString("pragma mmap_size=%1").arg(options.nMmapSize);
+	listPragma << (options.bTempStoreMemory ? "pragma temp_store=MEMORY" : "pragma temp_store=DEFAULT");
+
+	for (int i = 0; i < listPragma.size(); i++)
+	{
+		QByteArray utf8 = listPragma.at(i).toUtf8();
+		sqlite3_exec(mpDB, utf8.constData(), 0, 0, 0);
+	}
+}
+
+
+WIZSQLITEOPTIONS CppSQLite3DB::s_defaultOptions;
+
+
+void CppSQLite3DB::setDefaultOptions(const WIZSQLITEOPTIONS& options)
+{
+	s_defaultOptions = options;
+}
+
+
+const WIZSQLITEOPTIONS& CppSQLite3DB::defaultOptions()
+{
+	return s_defaultOptions;
 }
 
 
@@ -897,7 +980,9 @@ sqlite3_stmt* CppSQLite3DB::compile(const CString& strSQL)
     const void* szTail=0;
 	sqlite3_stmt* pVM;
 
-    int nRet = sqlite3_prepare16(mpDB, strSQL, -1, &pVM, &szTail);
+    // v2 statements are re-prepared by sqlite itself after schema changes,
+    // which cached statements rely on
+    int nRet = sqlite3_prepare16_v2(mpDB, strSQL, -1, &pVM, &szTail);
 
 	if (nRet != SQLITE_OK)
 	{
@@ -35,6 +35,27 @@
 
 #define CPPSQLITE_ERROR 1000
 
+// pragmas applied to every database right after it is opened
+struct WIZSQLITEOPTIONS
+{
+    bool bWAL;                  // journal_mode=WAL, readers do not block writer
+    int nSynchronous;           // 0: OFF, 1: NORMAL, 2: FULL
+    int nCacheSize;             // page cache of each connection, in KB
+    sqlite_int64 nMmapSize;     // memory mapped I/O, in bytes, 0 to disable
+    bool bTempStoreMemory;      // temp tables and indices in memory
+    int nBusyTimeout;           // milliseconds
+
+    WIZSQLITEOPTIONS()
+        : bWAL(true)
+        , nSynchronous(1)
+        , nCacheSize(8 * 1024)
+        , nMmapSize(64 * 1024 * 1024)
+        , bTempStoreMemory(true)
+        , nBusyTimeout(60000)
+    {
+    }
+};
+
 class CppSQLite3Exception
 {
 public:
@@ -151,7 +172,10 @@ public:
     CppSQLite3Query execQuery();
 
     void bind(int nParam, const char* szValue);
+    // empty string is bound as NULL, same as STR2SQL
+    void bind(int nParam, const CString& strValue);
     void bind(int nParam, const int nValue);
+    void bind(int nParam, const sqlite_int64 nValue);
     void bind(int nParam, const double dwValue);
     void bind(int nParam, const unsigned char* blobValue, int nLen);
     void bindNull(int nParam);
@@ -198,6 +222,10 @@ public:
 
     void setBusyTimeout(int nMillisecs);
 
+    // used by databases opened after this call
+    static void setDefaultOptions(const WIZSQLITEOPTIONS& options);
+    static const WIZSQLITEOPTIONS& defaultOptions();
+
     static const char* SQLiteVersion() { return SQLITE_VERSION; }
 	//
     BOOL IsOpened();
@@ -216,8 +244,12 @@ private:
 
     void checkDB();
 
+    void applyOptions(const WIZSQLITEOPTIONS& options);
+
     sqlite3* mpDB;
     int mnBusyTimeoutMs;
+
+    static WIZSQLITEOPTIONS s_defaultOptions;
 	//
     bool dump(const CString& strNewFileName);
     bool read(const CString& strNewFileName);
@@ -4,6 +4,7 @@
 #include "CLucene/analysis/standard/StandardTokenizer.h"
 #include "CLucene/queryParser/MultiFieldQueryParser.h"
 #include "CLucene/analysis/standard/StandardFilter.h"
+#include "CLucene/document/FieldSelector.h"
 
 #include <map>
 #include <deque>
@@ -97,6 +98,7 @@ public:
 
 const wchar_t* tokenTypeSingle = _T("single");
 const wchar_t* tokenTypeDouble = _T("double");
+const wchar_t* tokenTypeUnigram = _T("unigram");
 
 class CJKTokenizer: public lucene::analysis::Tokenizer
 {
@@ -344,6 +346,112 @@ public:
 };
 
 
+/*
+ * Split CJKTokenizer bigrams into unigrams as well, every CJK character is
+ * emitted alone and the bigram starting with it shares the same position:
+ *
+ *   C1C2C3 => C1 C1C2 | C2 C2C3 | C3
+ *
+ * so both unigram and bigram phrases match against one field and each note
+ * only need to be analyzed and indexed once.
+ */
+class CJKUnigramFilter: public lucene::analysis::TokenFilter
+{
+private:
+    struct PendingToken
+    {
+        std::wstring text;
+        int32_t start;
+        int32_t end;
+        const TCHAR* type;
+        int32_t positionIncrement;
+    };
+
+    std::deque<PendingToken> m_pending;
+
+    /** last character of previous bigram, emitted if next bigram doesn't start with it */
+    PendingToken m_tail;
+    bool m_hasTail;
+
+    static bool isCJK(TCHAR ch)
+    {
+        return _CJK;
+    }
+
+    void push(const TCHAR* text, int32_t length, int32_t start, int32_t end,
+              const TCHAR* type, int32_t positionIncrement)
+    {
+        PendingToken t;
+        t.text.assign(text, length);
+        t.start = start;
+        t.end = end;
+        t.type = type;
+        t.positionIncrement = positionIncrement;
+        m_pending.push_back(t);
+    }
+
+    void flushTail()
+    {
+        if (m_hasTail) {
+            m_pending.push_back(m_tail);
+            m_hasTail = false;
+        }
+    }
+
+public:
+    CJKUnigramFilter(lucene::analysis::TokenStream* in, bool deleteTokenStream)
+        : TokenFilter(in, deleteTokenStream)
+        , m_hasTail(false)
+    {
+    }
+
+    lucene::analysis::Token* next(lucene::analysis::Token* token)
+    {
+        while (m_pending.empty()) {
+            lucene::analysis::Token* t = input->next(token);
+            if (!t) {
+                if (!m_hasTail)
+                    return NULL;
+
+                flushTail();
+                break;
+            }
+
+            const TCHAR* text = t->termBuffer();
+            int32_t start = t->startOffset();
+
+            if (t->type() == tokenTypeDouble && t->termLength() == 2
+                    && isCJK(text[0]) && isCJK(text[1])) {
+                // C1C2 followed by C2C3, C2 is emitted as the head of C2C3
+                if (m_hasTail && m_tail.start != start) {
+                    flushTail();
+                }
+
+                m_hasTail = false;
+                push(text, 1, start, start + 1, tokenTypeUnigram, 1);
+                push(text, 2, start, start + 2, tokenTypeDouble, 0);
+
+                m_tail.text.assign(text + 1, 1);
+                m_tail.start = start + 1;
+                m_tail.end = start + 2;
+                m_tail.type = tokenTypeUnigram;
+                m_tail.positionIncrement = 1;
+                m_hasTail = true;
+            } else {
+                flushTail();
+                push(text, t->termLength(), start, t->endOffset(), t->type(), 1);
+            }
+        }
+
+        const PendingToken& p = m_pending.front();
+        token->set(p.text.c_str(), p.start, p.end, p.type);
+        token->setPositionIncrement(p.positionIncrement);
+        m_pending.pop_front();
+        return token;
+    }
+};
+
+
 class LanguageBasedAnalyzer: public lucene::analysis::Analyzer
 {
     TCHAR lang[100];
@@ -381,6 +489,10 @@ public:
         {
             ret = new CJKTokenizer3(reader);
         }
+        else if (wcscmp(lang, _T("cjkall"))==0)
+        {
+            ret = new CJKUnigramFilter(new CJKTokenizer(reader), true);
+        }
         else
         {
             lucene::util::BufferedReader* bufferedReader = reader->__asBufferedReader();
@@ -444,12 +556,14 @@ struct WIZFTSDATA
 {
         lucene::index::IndexWriter* writer;
         LanguageBasedAnalyzer an;
-        LanguageBasedAnalyzer an3;
 
-        WIZFTSDATA() : writer(NULL)
+        WIZFTSSESSIONOPTIONS options;
+        int nPendingDocuments;
+        qint64 nPendingBytes;
+
+        WIZFTSDATA() : writer(NULL), nPendingDocuments(0), nPendingBytes(0)
         {
-                an.setLanguage(_T("cjk"));
-                an3.setLanguage(_T("cjk3"));
+                an.setLanguage(_T("cjkall"));
         }
 
         ~WIZFTSDATA()
@@ -482,7 +596,8 @@ struct WIZFTSDATA
 //	}
 //};
 
-bool IWizCluceneSearch::beginUpdateDocument(const wchar_t* lpszIndexPath, void** ppHandle)
+bool IWizCluceneSearch::beginUpdateDocument(const wchar_t* lpszIndexPath, void** ppHandle,
+                                            const WIZFTSSESSIONOPTIONS& options)
 {
     std::wstring strIndexPath(lpszIndexPath);
     WizPathRemoveBackslash(strIndexPath);
@@ -490,6 +605,7 @@ bool IWizCluceneSearch::beginUpdateDocument(const wchar_t* lpszIndexPath, void**
 
     try {
         WIZFTSDATA* pData = new WIZFTSDATA();
+        pData->options = options;
 
         if (lucene::index::IndexReader::indexExists(strIndexPathA.c_str()) ) {
 			//open exists
@@ -505,6 +621,14 @@ bool IWizCluceneSearch::beginUpdateDocument(const wchar_t* lpszIndexPath, void**
 
         if (pData->writer) {
 			pData->writer->setMaxFieldLength(WIZTOOLS_FTS_MAX_FILE_LENGTH);
+
+            // we commit by ourself, make sure writer will not flush small segments
+            // in the middle of a batch
+            if (options.nCommitBytes > 0) {
+                float_t mb = float_t(options.nCommitBytes) / (1024 * 1024);
+                pData->writer->setRAMBufferSizeMB(mb > 16 ? mb : 16);
+            }
+
 			*ppHandle = pData;
             return true;
         } else {
@@ -524,6 +648,41 @@ bool IWizCluceneSearch::beginUpdateDocument(const wchar_t* lpszIndexPath, void**
 	}
 }
 
+bool IWizCluceneSearch::commitUpdateDocument(void* pHandle)
+{
+    WIZFTSDATA* pData = (WIZFTSDATA*)pHandle;
+    if (!pData) {
+        return false;
+    }
+
+    try {
+        // writer is opened with autoCommit, flush makes pending documents visible to readers
+        pData->writer->flush();
+        pData->nPendingDocuments = 0;
+        pData->nPendingBytes = 0;
+        return true;
+
+    } catch (CLuceneError& e) {
+		TOLOG(_T("Indexing exception in WizFTSCommitUpdateDocument"));
+		TOLOG(e.twhat());
+        return false;
+
+    } catch (...) {
+		TOLOG(_T("Unknown exception in WizFTSCommitUpdateDocument"));
+        return false;
+	}
+}
+
+int IWizCluceneSearch::pendingUpdateDocuments(void* pHandle)
+{
+    WIZFTSDATA* pData = (WIZFTSDATA*)pHandle;
+    if (!pData) {
+        return 0;
+    }
+
+    return pData->nPendingDocuments;
+}
+
 bool IWizCluceneSearch::endUpdateDocument(void* pHandle)
 {
 	WIZFTSDATA* pData = (WIZFTSDATA*)pHandle;
@@ -532,7 +691,12 @@ bool IWizCluceneSearch::endUpdateDocument(void* pHandle)
     }
 
     try {
-        pData->writer->optimize();
+        // optimize(n) only merges when index contains more than n segments,
+        // so most sessions never pay for a full merge
+        if (pData->options.nMaxSegments > 0) {
+            pData->writer->optimize(pData->options.nMaxSegments);
+        }
+
         pData->writer->close();
 		delete pData;
         return true;
@@ -565,6 +729,45 @@ bool IWizCluceneSearch::updateDocument(void* pHandle,
     //std::wstring strTitle(lpszTitle);
     std::wstring strText(lpszText);
 
+    deleteDocument(pHandle, lpszDocumentID);
+
+    try {
+        lucene::document::Document doc;
+        doc.add( *_CLNEW lucene::document::Field(_T("documentid"), strDocumentID.c_str(), lucene::document::Field::STORE_YES | lucene::document::Field::INDEX_UNTOKENIZED ) );
+        doc.add( *_CLNEW lucene::document::Field(_T("kbguid"), strKbGUID.c_str(), lucene::document::Field::STORE_YES | lucene::document::Field::INDEX_UNTOKENIZED ) );
+        doc.add( *_CLNEW lucene::document::Field(_T("contents"), strText.c_str(), lucene::document::Field::STORE_NO | lucene::document::Field::INDEX_TOKENIZED) );
+        pData->writer->addDocument(&doc, &pData->an);
+
+    } catch (CLuceneError& e) {
+		TOLOG(_T("Indexing exception in addDocument"));
+		TOLOG(e.twhat());
+        return false;
+    } catch (...) {
+		TOLOG(_T("Unknown exception in addDocument"));
+        return false;
+    }
+
+    pData->nPendingDocuments++;
+    pData->nPendingBytes += strText.length() * sizeof(wchar_t);
+
+    const WIZFTSSESSIONOPTIONS& options = pData->options;
+    if ((options.nCommitDocuments > 0 && pData->nPendingDocuments >= options.nCommitDocuments)
+            || (options.nCommitBytes > 0 && pData->nPendingBytes >= options.nCommitBytes)) {
+        return commitUpdateDocument(pHandle);
+    }
+
+    return true;
+}
+
+bool IWizCluceneSearch::deleteDocument(void* pHandle, const wchar_t* lpszDocumentID)
+{
+    WIZFTSDATA* pData = (WIZFTSDATA*)pHandle;
+    if (!pData) {
+        return false;
+    }
+
+    std::wstring strDocumentID(lpszDocumentID);
+
     try {
 
         {
@@ -575,6 +778,7 @@ bool IWizCluceneSearch::updateDocument(void* pHandle,
             }
         }
 
+        // documents indexed by cjk3 analyzer before FTS version 6
         {
             lucene::index::Term* term2 = _CLNEW lucene::index::Term(_T("documentid2"), strDocumentID.c_str());
             if (term2)
@@ -586,105 +790,225 @@ bool IWizCluceneSearch::updateDocument(void* pHandle,
     } catch (CLuceneError& e) {
 		TOLOG(_T("Indexing exception in deleteDocuments"));
 		TOLOG(e.twhat());
+        return false;
     } catch (...) {
 		TOLOG(_T("Unknown exception in deleteDocuments"));
-    }
-
-    {
-        lucene::document::Document doc;
-        doc.add( *_CLNEW lucene::document::Field(_T("documentid"), strDocumentID.c_str(), lucene::document::Field::STORE_YES | lucene::document::Field::INDEX_UNTOKENIZED ) );
-        doc.add( *_CLNEW lucene::document::Field(_T("kbguid"), strKbGUID.c_str(), lucene::document::Field::STORE_YES | lucene::document::Field::INDEX_UNTOKENIZED ) );
-        doc.add( *_CLNEW lucene::document::Field(_T("contents"), strText.c_str(), lucene::document::Field::STORE_NO | lucene::document::Field::INDEX_TOKENIZED) );
-        pData->writer->addDocument(&doc, &pData->an);
-    }
-
-    {
-        lucene::document::Document doc;
-        doc.add( *_CLNEW lucene::document::Field(_T("documentid2"), strDocumentID.c_str(), lucene::document::Field::STORE_YES | lucene::document::Field::INDEX_UNTOKENIZED ) );
-        doc.add( *_CLNEW lucene::document::Field(_T("kbguid"), strKbGUID.c_str(), lucene::document::Field::STORE_YES | lucene::document::Field::INDEX_UNTOKENIZED ) );
-        doc.add( *_CLNEW lucene::document::Field(_T("contents"), strText.c_str(), lucene::document::Field::STORE_NO | lucene::document::Field::INDEX_TOKENIZED) );
-        pData->writer->addDocument(&doc, &pData->an3);
+        return false;
     }
 
     return true;
 }
 
-bool IWizCluceneSearch::searchDocument(const wchar_t* lpszIndexPath,
-                                       const wchar_t* lpszKeywords)
+struct WIZFTSSEARCHDATA
+{
+        std::string strIndexPath;
+        lucene::index::IndexReader* reader;
+        lucene::search::IndexSearcher* searcher;
+        LanguageBasedAnalyzer an;
+
+        // last parsed query, reused while paging through the same keywords
+        std::wstring strKeywords;
+        lucene::search::Query* query;
+
+        // only guid fields are loaded for hits, contents is never read back
+        lucene::document::MapFieldSelector selector;
+
+        WIZFTSSEARCHDATA() : reader(NULL), searcher(NULL), query(NULL)
+        {
+                // unigrams and bigrams share one field, one query matches both
+                an.setLanguage(_T("cjkall"));
+
+                selector.add(_T("documentid"));
+                selector.add(_T("kbguid"));
+        }
+
+        ~WIZFTSSEARCHDATA()
+        {
+                close();
+                resetQuery();
+        }
+
+        void resetQuery()
+        {
+                if (query)
+                {
+                        _CLDELETE(query);
+                        query = NULL;
+                }
+
+                strKeywords.clear();
+        }
+
+        lucene::search::Query* ensureQuery(const std::wstring& strNewKeywords)
+        {
+                if (query && strKeywords == strNewKeywords)
+                        return query;
+
+                resetQuery();
+                query = lucene::queryParser::QueryParser::parse(strNewKeywords.c_str(), L"contents", &an);
+                if (query)
+                        strKeywords = strNewKeywords;
+
+                return query;
+        }
+
+        void close()
+        {
+                if (searcher)
+                {
+                        searcher->close();
+                        delete searcher;
+                        searcher = NULL;
+                }
+
+                if (reader)
+                {
+                        reader->close();
+                        delete reader;
+                        reader = NULL;
+                }
+        }
+
+        // open searcher lazily, index may not exist when search begin
+        bool ensureSearcher()
+        {
+                if (reader)
+                {
+                        // reopen only read segments changed since last commit
+                        lucene::index::IndexReader* newReader = reader->reopen();
+                        if (newReader != reader)
+                        {
+                                close();
+                                reader = newReader;
+                                searcher = _CLNEW lucene::search::IndexSearcher(reader);
+                        }
+
+                        return true;
+                }
+
+                if (!lucene::index::IndexReader::indexExists(strIndexPath.c_str()))
+                        return false;
+
+                reader = lucene::index::IndexReader::open(strIndexPath.c_str());
+                searcher = _CLNEW lucene::search::IndexSearcher(reader);
+                return true;
+        }
+};
+
+bool IWizCluceneSearch::beginSearchDocument(const wchar_t* lpszIndexPath, void** ppHandle)
 {
     std::wstring strIndexPath(lpszIndexPath);
     WizPathRemoveBackslash(strIndexPath);
-    std::string strIndexPathA = WizW2A(strIndexPath);
-    std::wstring strKeywords(lpszKeywords);
 
-    const wchar_t* arrAnalyzer[] = {
-        L"cjk",
-        L"cjk3",
-        NULL
-    };
+    WIZFTSSEARCHDATA* pData = new WIZFTSSEARCHDATA();
+    pData->strIndexPath = WizW2A(strIndexPath);
 
-    //const wchar_t* fields[] = {L"title", L"contents", NULL};
+    *ppHandle = pData;
+    return true;
+}
 
-    std::set<std::string> setGUIDs;
+bool IWizCluceneSearch::endSearchDocument(void* pHandle)
+{
+    WIZFTSSEARCHDATA* pData = (WIZFTSSEARCHDATA*)pHandle;
+    if (!pData) {
+        return false;
+    }
 
     try {
-        lucene::search::IndexSearcher searcher(strIndexPathA.c_str());
+        delete pData;
+        return true;
 
-		for (int i = 0; ; i++)
-		{
-			if (!arrAnalyzer[i])
-                break;
+    } catch (CLuceneError& e) {
+		TOLOG(e.twhat());
+        return false;
 
-            //for (int j = 0; ; j++) {
-            //    if (!fields[j]) break;
+    } catch (...) {
+        return false;
+	}
+}
 
-                LanguageBasedAnalyzer analyzer(arrAnalyzer[i]);
-                lucene::search::Query* query = lucene::queryParser::QueryParser::parse(strKeywords.c_str(), L"contents", &analyzer);
+bool IWizCluceneSearch::searchDocument(void* pHandle,
+                                       const wchar_t* lpszKeywords,
+                                       int nStart,
+                                       int nCount,
+                                       int& nTotalHits)
+{
+    WIZFTSSEARCHDATA* pData = (WIZFTSSEARCHDATA*)pHandle;
+    if (!pData) {
+        return false;
+    }
 
-                if (!query) {
-                    continue;
-                }
+    nTotalHits = 0;
+    if (nStart < 0 || nCount <= 0) {
+        return false;
+    }
 
-                lucene::search::Hits* hits = searcher.search(query);
-                if (!hits) {
-                    _CLDELETE(query);
-                    continue;
-                }
+    std::wstring strKeywords(lpszKeywords);
 
-                for (size_t i = 0;i < hits->length(); i++ ) {
-                    lucene::document::Document* doc = &hits->doc(i);
-                    const TCHAR* kbid = doc->get(_T("kbguid"));
-                    const TCHAR* docid = doc->get(_T("documentid"));
-                    if (!docid) {
-                        docid = doc->get(_T("documentid2"));
-                    }
+    try {
+        if (!pData->ensureSearcher()) {
+            onSearchEnd();
+            return true;
+        }
+
+        lucene::search::Query* query = pData->ensureQuery(strKeywords);
+        if (query) {
+            // collect top (nStart + nCount) hits by score, the rest are only counted
+            lucene::search::TopDocs* topDocs = pData->searcher->_search(query, NULL, nStart + nCount);
+            if (topDocs) {
+                nTotalHits = topDocs->totalHits;
+
+                for (int32_t i = nStart; i < topDocs->scoreDocsLength; i++) {
+                    lucene::document::Document doc;
+                    if (!pData->reader->document(topDocs->scoreDocs[i].doc, doc, &pData->selector))
+                        continue;
+
+                    const TCHAR* kbid = doc.get(_T("kbguid"));
+                    const TCHAR* docid = doc.get(_T("documentid"));
 
                     if (docid) {
-                        std::string strDocumentGUID = ::WizW2A(docid);
-                        if (setGUIDs.find(strDocumentGUID) == setGUIDs.end()) {
-                            setGUIDs.insert(strDocumentGUID);
-                            onSearchProcess(kbid, docid, _T(""));
-                        }
+                        onSearchProcess(kbid ? kbid : _T(""), docid, _T(""));
                     }
                 }
 
-                _CLDELETE(query);
-            //}
+                _CLDELETE(topDocs);
+            }
         }
 
-        searcher.close();
         onSearchEnd();
         return true;
 
     } catch (CLuceneError& e) {
 		TOLOG(e.twhat());
+        // index may be rebuilt from scratch, open it again next time
+        pData->close();
+        pData->resetQuery();
         return false;
 
     } catch (...) {
+        pData->close();
+        pData->resetQuery();
         return false;
 	}
 }
 
+bool IWizCluceneSearch::searchDocument(const wchar_t* lpszIndexPath,
+                                       const wchar_t* lpszKeywords,
+                                       int nStart,
+                                       int nCount,
+                                       int& nTotalHits)
+{
+    void* pHandle = NULL;
+    if (!beginSearchDocument(lpszIndexPath, &pHandle)) {
+        return false;
+    }
+
+    bool ret = searchDocument(pHandle, lpszKeywords, nStart, nCount, nTotalHits);
+    endSearchDocument(pHandle);
+
+    return ret;
+}
+
 bool IWizCluceneSearch::deleteDocument(const wchar_t* lpszIndexPath,
                                        const wchar_t* lpszDocumentID)
 {
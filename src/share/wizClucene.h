@@ -3,20 +3,52 @@
 
 #include <QtGlobal>
 
+// indexing session settings, one writer is kept open between
+// beginUpdateDocument and endUpdateDocument
+struct WIZFTSSESSIONOPTIONS
+{
+    int nCommitDocuments;   // commit after this many documents, 0 means never
+    qint64 nCommitBytes;    // commit after this many bytes of text, 0 means never
+    int nMaxSegments;       // merge down to this many segments at the end, 0 means never
+
+    WIZFTSSESSIONOPTIONS()
+        : nCommitDocuments(1000)
+        , nCommitBytes(32 * 1024 * 1024)
+        , nMaxSegments(10)
+    {
+    }
+};
+
 // interface
 class IWizCluceneSearch
 {
 protected:
-    bool beginUpdateDocument(const wchar_t* lpszIndexPath, void** ppHandle);
+    bool beginUpdateDocument(const wchar_t* lpszIndexPath, void** ppHandle,
+                             const WIZFTSSESSIONOPTIONS& options = WIZFTSSESSIONOPTIONS());
+    bool commitUpdateDocument(void* pHandle);
     bool endUpdateDocument(void* pHandle);
+    // documents added but not committed yet, 0 right after a commit
+    int pendingUpdateDocuments(void* pHandle);
     bool updateDocument(void* pHandle,
                         const wchar_t* lpszKbGUID,
                         const wchar_t* lpszDocumentID,
                         const wchar_t* lpszTitle,
                         const wchar_t* lpszText);
 
+    bool deleteDocument(void* pHandle, const wchar_t* lpszDocumentID);
     bool deleteDocument(const wchar_t* lpszIndexPath, const wchar_t* lpszDocumentID);
-    bool searchDocument(const wchar_t* lpszIndexPath, const wchar_t* lpszKeywords);
+
+    // searcher is kept open between searches and only reopened after
+    // the index has been committed by writer
+    bool beginSearchDocument(const wchar_t* lpszIndexPath, void** ppHandle);
+    bool endSearchDocument(void* pHandle);
+
+    // report hits ranked [nStart, nStart + nCount) by relevance through
+    // onSearchProcess, nTotalHits receive count of all matched documents
+    bool searchDocument(void* pHandle, const wchar_t* lpszKeywords,
+                        int nStart, int nCount, int& nTotalHits);
+    bool searchDocument(const wchar_t* lpszIndexPath, const wchar_t* lpszKeywords,
+                        int nStart, int nCount, int& nTotalHits);
 
     virtual bool onSearchProcess(const wchar_t* lpszKbGUID,
                                  const wchar_t* lpszDocumentID,
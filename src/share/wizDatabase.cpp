@@ -11,10 +11,26 @@
 #include <QMimeData>
 #include <QApplication>
 #include <QClipboard>
+#include <QBuffer>
+#include <QImageReader>
+#include <QSet>
+
+#ifndef Q_OS_WIN
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#endif
+
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentMap>
+#endif
 
 #include <extensionsystem/pluginmanager.h>
 
 #include "wizhtml2zip.h"
+#include "wizmd5.h"
 #include "share/wizzip.h"
 #include "html/wizhtmlcollector.h"
 #include "rapidjson/document.h"
@@ -98,6 +114,8 @@ void CWizDocument::PermanentlyDelete()
     {
         WizDeleteFile(strZipFileName);
     }
+
+    m_db.DeleteFileMD5(strZipFileName);
 }
 
 void CWizDocument::MoveTo(QObject* p)
@@ -422,6 +440,41 @@ bool CWizDatabase::GetModifiedAttachmentList(CWizDocumentAttachmentDataArray& ar
     return GetModifiedAttachments(arrayData);
 }
 
+bool CWizDatabase::RefreshModifiedAttachments()
+{
+    CWizDocumentAttachmentDataArray arrayData;
+    if (!GetModifiedAttachments(arrayData))
+        return false;
+
+    // attachment may be edited again after file monitor stopped, check all
+    // of them at once before upload, unchanged files are not hashed again
+    QStringList arrayFileName;
+    CWizDocumentAttachmentDataArray::const_iterator it;
+    for (it = arrayData.begin(); it != arrayData.end(); it++) {
+        arrayFileName.append(GetAttachmentFileName(it->strGUID));
+    }
+
+    QMap<QString, QString> mapMD5;
+    CalFilesMD5(arrayFileName, mapMD5);
+
+    for (size_t i = 0; i < arrayData.size(); i++) {
+        WIZDOCUMENTATTACHMENTDATAEX& attach = arrayData[i];
+        QString strMD5 = mapMD5.value(arrayFileName.at(i));
+        if (strMD5.isEmpty() || strMD5 == attach.strDataMD5)
+            continue;
+
+        TOLOG1("[Sync] attachment data modified: %1", attach.strName);
+        attach.strDataMD5 = strMD5;
+        attach.tDataModified = QFileInfo(arrayFileName.at(i)).lastModified();
+        attach.tInfoModified = WizGetCurrentTime();
+        attach.strInfoMD5 = CalDocumentAttachmentInfoMD5(attach);
+
+        ModifyAttachmentInfoEx(attach);
+    }
+
+    return true;
+}
+
 bool CWizDatabase::GetObjectsNeedToBeDownloaded(CWizObjectDataArray& arrayObject)
 {
     return GetAllObjectsNeedToBeDownloaded(arrayObject, GetObjectSyncTimeline());
@@ -500,6 +553,21 @@ bool CWizDatabase::OnDownloadDocument(int part, const WIZDOCUMENTDATAEX& data)
     return UpdateDocument(d);
 }
 
+bool CWizDatabase::BeginTransaction()
+{
+    return CWizIndexBase::BeginTransaction();
+}
+
+bool CWizDatabase::CommitTransaction()
+{
+    return CWizIndexBase::CommitTransaction();
+}
+
+bool CWizDatabase::RollbackTransaction()
+{
+    return CWizIndexBase::RollbackTransaction();
+}
+
 qint64 CWizDatabase::GetObjectLocalVersion(const QString& strObjectGUID,
                                            const QString& strObjectType)
 {
@@ -2056,6 +2124,16 @@ QString CWizDatabase::GetAttachmentFileName(const QString& strGUID)
     return  strNewFileName;
 }
 
+QString CWizDatabase::GetBlobsDataPath() const
+{
+    return GetDataPath() + "blobs/";
+}
+
+QString CWizDatabase::GetBlobFileName(const QString& strMD5) const
+{
+    return GetBlobsDataPath() + strMD5.left(2) + "/" + strMD5;
+}
+
 QString CWizDatabase::GetAvatarPath() const
 {
     QString strPath = GetAccountPath() + "avatar/";
@@ -2521,10 +2599,20 @@ bool CWizDatabase::UpdateDocumentData(WIZDOCUMENTDATA& data,
 
     CString strZipFileName = GetDocumentFileName(data.strGUID);
     if (!data.nProtected) {
-        bool bZip = ::WizHtml2Zip(strURL, strProcessedHtml, strResourcePath, nFlags, strMetaText, strZipFileName);
+        WIZHTML2ZIPRESULT result;
+        bool bZip = ::WizHtml2Zip(strURL, strProcessedHtml, strResourcePath, nFlags, strMetaText, strZipFileName, &result);
         if (!bZip) {
             return false;
         }
+
+        SetObjectDataDownloaded(data.strGUID, "document", true);
+
+        // md5 and abstract from what has just been zipped, don't read note again
+        bool bRet = ModifyDocumentDataMD5(data, result.strDataMD5, notifyDataModify);
+        UpdateDocumentAbstract(data, result.strHtml, result.arrayResource);
+        AddDocumentBlobs(data, result.arrayResource, result.arrayResourceMD5);
+
+        return bRet;
     } else {
         CString strTempFile = Utils::PathResolve::tempPath() + data.strGUID + "-decrypted";
         bool bZip = ::WizHtml2Zip(strURL, strProcessedHtml, strResourcePath, nFlags, strMetaText, strTempFile);
@@ -2561,13 +2649,125 @@ void CWizDatabase::ClearUnusedImages(const QString& strHtml, const QString& strF
 
 bool CWizDatabase::UpdateDocumentDataMD5(WIZDOCUMENTDATA& data, const CString& strZipFileName, bool notifyDataModify /*= true*/)
 {
-    bool bRet = CWizIndex::UpdateDocumentDataMD5(data, strZipFileName, notifyDataModify);
+    // note file has been rewritten, eg: encrypted in place
+    CWizUnzipFile::invalidateDirectoryCache(strZipFileName);
+
+    bool bRet = ModifyDocumentDataMD5(data, CalFileMD5(strZipFileName), notifyDataModify);
 
     UpdateDocumentAbstract(data.strGUID);
 
     return bRet;
 }
 
+// file modified this close to hashing may be written again with the same
+// size and time (2 seconds is the coarsest time resolution, fat), so its md5
+// is not cached
+#define WIZ_FILE_MD5_RACY_MSECS     2000
+
+struct WIZFILEMD5DATA
+{
+    QString strFileName;
+    qint64 nSize;
+    qint64 nModified;
+    qint64 nInode;
+    qint64 nHashed;
+    QString strMD5;
+
+    WIZFILEMD5DATA() : nSize(0), nModified(0), nInode(0), nHashed(0) {}
+
+    bool isCacheable() const
+    {
+        return !strMD5.isEmpty() && nHashed - nModified >= WIZ_FILE_MD5_RACY_MSECS;
+    }
+};
+
+static bool WizInitFileMD5Data(const QString& strFileName, WIZFILEMD5DATA& data)
+{
+    QFileInfo info(strFileName);
+    if (!info.isFile())
+        return false;
+
+    data.strFileName = strFileName;
+    data.nSize = info.size();
+    data.nModified = info.lastModified().toMSecsSinceEpoch();
+
+    // file replaced by another one with the same size and time
+#ifndef Q_OS_WIN
+    struct stat st;
+    if (0 == ::stat(QFile::encodeName(strFileName).constData(), &st)) {
+        data.nInode = st.st_ino;
+    }
+#endif
+
+    return true;
+}
+
+// run by thread pool
+static void WizCalFileMD5Data(WIZFILEMD5DATA& data)
+{
+    // time before reading, any later write has a newer time
+    data.nHashed = QDateTime::currentMSecsSinceEpoch();
+    data.strMD5 = ::WizMd5FileString(data.strFileName);
+}
+
+QString CWizDatabase::CalFileMD5(const QString& strFileName)
+{
+    WIZFILEMD5DATA data;
+    if (!WizInitFileMD5Data(strFileName, data))
+        return ::WizMd5FileString(strFileName);
+
+    CString strMD5;
+    if (GetFileMD5(data.strFileName, data.nSize, data.nModified, data.nInode, strMD5))
+        return strMD5;
+
+    WizCalFileMD5Data(data);
+    if (data.isCacheable()) {
+        SetFileMD5(data.strFileName, data.nSize, data.nModified, data.nInode, data.strMD5);
+    }
+
+    return data.strMD5;
+}
+
+bool CWizDatabase::CalFilesMD5(const QStringList& arrayFileName, QMap<QString, QString>& mapMD5)
+{
+    QVector<WIZFILEMD5DATA> arrayData;
+    foreach (const QString& strFileName, arrayFileName) {
+        WIZFILEMD5DATA data;
+        if (!WizInitFileMD5Data(strFileName, data))
+            continue;
+
+        CString strMD5;
+        if (GetFileMD5(data.strFileName, data.nSize, data.nModified, data.nInode, strMD5)) {
+            mapMD5[strFileName] = strMD5;
+        } else {
+            arrayData.push_back(data);
+        }
+    }
+
+    if (arrayData.isEmpty())
+        return true;
+
+    QtConcurrent::blockingMap(arrayData, WizCalFileMD5Data);
+
+    // cache is best effort, still write the rows one by one without transaction
+    bool bTransaction = BeginTransaction();
+    for (int i = 0; i < arrayData.size(); i++) {
+        const WIZFILEMD5DATA& data = arrayData.at(i);
+        if (data.strMD5.isEmpty())
+            continue;
+
+        mapMD5[data.strFileName] = data.strMD5;
+        if (data.isCacheable()) {
+            SetFileMD5(data.strFileName, data.nSize, data.nModified, data.nInode, data.strMD5);
+        }
+    }
+
+    if (bTransaction)
+        CommitTransaction();
+
+    return true;
+}
+
 bool CWizDatabase::DeleteAttachment(const WIZDOCUMENTATTACHMENTDATA& data,
                                     bool bLog,
                                     bool bReset /* = true */)
@@ -2578,6 +2778,8 @@ bool CWizDatabase::DeleteAttachment(const WIZDOCUMENTATTACHMENTDATA& data,
         ::WizDeleteFile(strFileName);
     }
 
+    DeleteFileMD5(strFileName);
+
     emit attachmentsUpdated();
 
     return bRet;
@@ -2670,6 +2872,12 @@ bool CWizDatabase::UpdateSyncObjectLocalData(const WIZOBJECTDATA& data)
             return false;
         }
 
+        CWizUnzipFile::invalidateDirectoryCache(strFileName);
+
+        if (!document.nProtected) {
+            AddDocumentBlobs(document, data.arrayData);
+        }
+
         Q_EMIT documentDataModified(document);
         UpdateDocumentAbstract(data.strObjectGUID);
         setDocumentSearchIndexed(data.strObjectGUID, false);
@@ -2826,6 +3034,7 @@ bool CWizDatabase::AddAttachment(const WIZDOCUMENTDATA& document, const CString&
     dataRet.strKbGUID = document.strKbGUID;
     dataRet.strDocumentGUID = document.strGUID;
 
+    // source file is outside of database, don't cache it
     CString strMD5 = ::WizMd5FileString(strFileName);
     if (!CreateAttachment(document.strGUID, WizExtractFileName(strFileName), strFileName, "", strMD5, dataRet))
         return false;
@@ -2838,6 +3047,7 @@ bool CWizDatabase::AddAttachment(const WIZDOCUMENTDATA& document, const CString&
 
     SetAttachmentDataDownloaded(dataRet.strGUID, true);
     UpdateDocumentAttachmentCount(document.strGUID);
+    AddAttachmentBlob(dataRet.strGUID, strMD5);
 
     return true;
 }
@@ -2876,14 +3086,14 @@ bool CWizDatabase::LoadDocumentData(const QString& strDocumentGUID, QByteArray&
             if (!m_ziwReader->setFile(strFileName))
                 return false;
 
-            strFileName = Utils::PathResolve::tempPath() + document.strGUID + "-decrypted";
-            QFile::remove(strFileName);
-
-            if (!m_ziwReader->decryptDataToTempFile(strFileName)) {
+            // decrypt in memory, plain data never goes to disk
+            if (!m_ziwReader->decryptDataToBuffer(arrayData)) {
                 // force clear usercipher
                 m_ziwReader->setUserCipher(QString());
                 return false;
             }
+
+            return !arrayData.isEmpty();
         }
     }
 
@@ -2904,7 +3114,11 @@ bool CWizDatabase::WriteDataToDocument(const QString& strDocumentGUID, const QBy
     if (!file.open(QFile::WriteOnly | QIODevice::Truncate))
         return false;
 
-    return (file.write(arrayData) != -1);
+    bool bRet = (file.write(arrayData) != -1);
+    file.close();
+
+    CWizUnzipFile::invalidateDirectoryCache(strFileName);
+    return bRet;
 }
 
 bool CWizDatabase::LoadAttachmentData(const CString& strDocumentGUID, QByteArray& arrayData)
@@ -2974,6 +3188,10 @@ bool CWizDatabase::SaveCompressedAttachmentData(const CString& strGUID, const QB
     }
 
     CString strFileName = GetAttachmentFileName(strGUID);
+
+    // may be a link of blob, don't write into it
+    QFile::remove(strFileName);
+
     if (!zip.extractFile(0, strFileName))
     {
         Q_EMIT updateError("Failed to extract attachment file: " + strFileName);
@@ -2982,6 +3200,8 @@ bool CWizDatabase::SaveCompressedAttachmentData(const CString& strGUID, const QB
 
     zip.close();
 
+    AddAttachmentBlob(strGUID, ::WizMd5FileString(strFileName));
+
     return true;
 }
 
@@ -3040,42 +3260,68 @@ bool CWizDatabase::UpdateDocumentAbstract(const QString& strDocumentGUID)
         ::WizLoadUnicodeTextFromFile(strHtmlFileName, strHtml);
     }
 
+    CString strResourcePath = WizExtractFilePath(strHtmlFileName) + "index_files/";
+    CWizStdStringArray arrayImageFileName;
+    ::WizEnumFiles(strResourcePath, "*.jpg;*.png;*.bmp;*.gif", arrayImageFileName, 0);
+
+    bool ret = UpdateDocumentAbstract(data, strHtml, arrayImageFileName);
+
+    ::WizDeleteFolder(strHtmlTempPath);
+
+    return ret;
+}
+
+bool CWizDatabase::UpdateDocumentAbstract(const WIZDOCUMENTDATA& data,
+                                          const QString& strHtml,
+                                          const CWizStdStringArray& arrayResource)
+{
     WIZABSTRACT abstract;
-    abstract.guid = strDocumentGUID;
+    abstract.guid = data.strGUID;
 
     CWizHtmlToPlainText htmlConverter;
-    htmlConverter.toText(strHtml, abstract.text);
-    abstract.text = abstract.text.left(2000);
+    htmlConverter.toText(strHtml, abstract.text, 2000);
 
-    CString strResourcePath = WizExtractFilePath(strHtmlFileName) + "index_files/";
-    CWizStdStringArray arrayImageFileName;
-    ::WizEnumFiles(strResourcePath, "*.jpg;*.png;*.bmp;*.gif", arrayImageFileName, 0);
-    if (!arrayImageFileName.empty())
-    {
-        CString strImageFileName = arrayImageFileName[0];
+    CString strImageFileName;
+    qint64 m = 0;
+    CWizStdStringArray::const_iterator it;
+    for (it = arrayResource.begin(); it != arrayResource.end(); it++) {
+        CString strFileName = *it;
+        CString strExt = WizExtractFileExt(strFileName).toLower();
+        if (strExt != ".jpg" && strExt != ".png" && strExt != ".bmp" && strExt != ".gif")
+            continue;
 
-        qint64 m = 0;
-        CWizStdStringArray::const_iterator it;
-        for (it = arrayImageFileName.begin() + 1; it != arrayImageFileName.end(); it++) {
-            CString strFileName = *it;
-            qint64 size = ::WizGetFileSize(strFileName);
-            if (size > m)
-            {
-                strImageFileName = strFileName;
-                m = size;
-            }
+        qint64 size = ::WizGetFileSize(strFileName);
+        if (strImageFileName.isEmpty() || size > m)
+        {
+            strImageFileName = strFileName;
+            m = size;
         }
+    }
 
-        QImage img;
-        if (img.load(strImageFileName))
+    if (!strImageFileName.isEmpty())
+    {
+        // thumbnail is 120 x 120, decode image at that size rather than full size
+        QImageReader reader(strImageFileName);
+        QSize sz = reader.size();
+        //DEBUG_TOLOG2("Abstract image size: %1 X %2", WizIntToStr(sz.width()), WizIntToStr(sz.height()));
+        if (sz.width() > 32 && sz.height() > 32)
         {
-            //DEBUG_TOLOG2("Abstract image size: %1 X %2", WizIntToStr(img.width()), WizIntToStr(img.height()));
-            if (img.width() > 32 && img.height() > 32)
+            if (sz.width() > 240 && sz.height() > 240)
+            {
+                reader.setScaledSize(sz.scaled(120, 120, Qt::KeepAspectRatioByExpanding));
+            }
+
+            QImage img;
+            if (reader.read(&img))
             {
                 abstract.image = img;
             }
+            else
+            {
+                Q_EMIT updateError("Failed to load image file: " + strImageFileName);
+            }
         }
-        else
+        else if (!sz.isValid())
         {
             Q_EMIT updateError("Failed to load image file: " + strImageFileName);
         }
@@ -3086,8 +3332,6 @@ bool CWizDatabase::UpdateDocumentAbstract(const QString& strDocumentGUID)
         Q_EMIT updateError("Failed to update note abstract!");
     }
 
-    ::WizDeleteFolder(strHtmlTempPath);
-
     Q_EMIT documentAbstractModified(data);
 
     return ret;
@@ -3245,12 +3489,13 @@ void CWizDatabase::DocumentsToHtmlLink(const QList<WIZDOCUMENTDATA>& documents,
 }
 
 bool CWizDatabase::DocumentToTempHtmlFile(const WIZDOCUMENTDATA& document,
-                                          QString& strTempHtmlFileName, const QString& strTargetFileNameWithoutPath)
+                                          QString& strTempHtmlFileName, const QString& strTargetFileNameWithoutPath,
+                                          bool bExtractResources)
 {
     QString strTempFolder = Utils::PathResolve::tempPath() + document.strGUID + "/";
     ::WizEnsurePathExists(strTempFolder);
 
-    if (!DocumentToHtmlFile(document, strTempFolder, strTargetFileNameWithoutPath))
+    if (!DocumentToHtmlFile(document, strTempFolder, strTargetFileNameWithoutPath, bExtractResources))
         return false;
 
     strTempHtmlFileName = strTempFolder + strTargetFileNameWithoutPath;
@@ -3260,29 +3505,390 @@ bool CWizDatabase::DocumentToTempHtmlFile(const WIZDOCUMENTDATA& document,
 
 bool CWizDatabase::DocumentToHtmlFile(const WIZDOCUMENTDATA& document,
                                           const QString& strPath,
-                                          const QString& strHtmlFileName)
+                                          const QString& strHtmlFileName,
+                                          bool bExtractResources)
 {
     ::WizEnsurePathExists(strPath);
 
-    if (!extractZiwFileToFolder(document, strPath))
-        return false;
+    QString strText;
+    if (bExtractResources) {
+        if (!extractZiwFileToFolder(document, strPath))
+            return false;
 
-    QString strTempHtmlFileName = strPath + "index.html";
+        ::WizLoadUnicodeTextFromFile(strPath + "index.html", strText);
+    } else {
+        if (!DocumentToHtmlData(document, strText))
+            return false;
+    }
 
     m_mtxTempFile.lock();
-    QString strText;
-    ::WizLoadUnicodeTextFromFile(strTempHtmlFileName, strText);
-
     QUrl url = QUrl::fromLocalFile(strPath + "index_files/");
     strText.replace("index_files/", url.toString());
 
-    strTempHtmlFileName = strPath + strHtmlFileName;
+    QString strTempHtmlFileName = strPath + strHtmlFileName;
     WizSaveUnicodeTextToUtf8File(strTempHtmlFileName, strText);
     m_mtxTempFile.unlock();
 
     return PathFileExists(strTempHtmlFileName);
 }
 
+bool CWizDatabase::DocumentToHtmlData(const WIZDOCUMENTDATA& document, QString& strHtml)
+{
+    QByteArray data;
+    if (!extractZiwFileEntry(document, "index.html", data)) {
+        return false;
+    }
+
+    return ::WizLoadUnicodeTextFromBuffer(data, strHtml);
+}
+
+bool CWizDatabase::extractZiwFileEntry(const WIZDOCUMENTDATA& document,
+                                       const QString& strNameInZip,
+                                       QByteArray& data)
+{
+    CString strZipFileName = GetDocumentFileName(document.strGUID);
+    if (!PathFileExists(strZipFileName)) {
+        return false;
+    }
+
+    if (document.nProtected) {
+        if (userCipher().isEmpty()) {
+            return false;
+        }
+
+        if (!m_ziwReader->setFile(strZipFileName)) {
+            return false;
+        }
+
+        // only blocks of the entry are decrypted
+        QIODevice* device = m_ziwReader->decryptDataToDevice();
+        if (!device) {
+            // force clear usercipher
+            m_ziwReader->setUserCipher(QString());
+            return false;
+        }
+
+        CWizUnzipFile zip;
+        bool bRet = zip.open(device) && zip.extractFile(strNameInZip, data);
+        zip.close();
+        delete device;
+
+        return bRet;
+    }
+
+    // central directory is cached by CWizUnzipFile
+    CWizUnzipFile zip;
+    return zip.open(strZipFileName) && zip.extractFile(strNameInZip, data);
+}
+
+bool CWizDatabase::extractZiwFileResource(const WIZDOCUMENTDATA& document,
+                                          const QString& strNameInZip,
+                                          QByteArray& data)
+{
+    // never write plain text of protected notes to disk
+    if (isBlobStoreEnabled() && !document.nProtected && !document.strDataMD5.isEmpty()) {
+        CString strBlobMD5;
+        if (GetObjectBlob(document.strGUID, strNameInZip, document.strDataMD5, strBlobMD5)) {
+            QFile file(GetBlobFileName(strBlobMD5));
+            if (file.open(QIODevice::ReadOnly)) {
+                data = file.readAll();
+                return true;
+            }
+        }
+    }
+
+    return extractZiwFileEntry(document, strNameInZip, data);
+}
+
+// name of the only blob of attachment
+#define WIZ_ATTACHMENT_BLOB_NAME    "attachment"
+
+static bool g_bBlobStoreEnabled = true;
+
+// rename over existing file, atomic on posix
+static bool WizReplaceFile(const QString& strFileName, const QString& strDestFileName)
+{
+#ifndef Q_OS_WIN
+    return 0 == ::rename(QFile::encodeName(strFileName).constData(),
+                         QFile::encodeName(strDestFileName).constData());
+#else
+    QFile::remove(strDestFileName);
+    return QFile::rename(strFileName, strDestFileName);
+#endif
+}
+
+// files share data until one of them is replaced or removed
+static bool WizLinkFile(const QString& strFileName, const QString& strLinkFileName)
+{
+#ifndef Q_OS_WIN
+    return 0 == ::link(QFile::encodeName(strFileName).constData(),
+                       QFile::encodeName(strLinkFileName).constData());
+#else
+    Q_UNUSED(strFileName);
+    Q_UNUSED(strLinkFileName);
+    return false;
+#endif
+}
+
+// written to temp file then renamed, readers never see partial blob
+static bool WizWriteBlobFile(const QString& strBlobFileName, const QByteArray& data)
+{
+    if (::WizGetFileSize(strBlobFileName) == data.size())
+        return true;
+
+    ::WizEnsurePathExists(WizExtractFilePath(strBlobFileName));
+
+    QString strTempFileName = strBlobFileName + ".tmp";
+    QFile file(strTempFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(data) != data.size()) {
+        file.close();
+        QFile::remove(strTempFileName);
+        return false;
+    }
+    file.close();
+
+    if (!WizReplaceFile(strTempFileName, strBlobFileName)) {
+        QFile::remove(strTempFileName);
+        return false;
+    }
+
+    return true;
+}
+
+static bool WizCopyBlobFile(const QString& strBlobFileName, const QString& strFileName)
+{
+    qint64 nSize = ::WizGetFileSize(strFileName);
+    if (::WizGetFileSize(strBlobFileName) == nSize)
+        return true;
+
+    ::WizEnsurePathExists(WizExtractFilePath(strBlobFileName));
+
+    QString strTempFileName = strBlobFileName + ".tmp";
+    QFile::remove(strTempFileName);
+    if (!QFile::copy(strFileName, strTempFileName)
+            || ::WizGetFileSize(strTempFileName) != nSize
+            || !WizReplaceFile(strTempFileName, strBlobFileName)) {
+        QFile::remove(strTempFileName);
+        return false;
+    }
+
+    return true;
+}
+
+void CWizDatabase::setBlobStoreEnabled(bool bEnabled)
+{
+    g_bBlobStoreEnabled = bEnabled;
+}
+
+bool CWizDatabase::isBlobStoreEnabled()
+{
+    return g_bBlobStoreEnabled;
+}
+
+bool CWizDatabase::AddDocumentBlobs(const WIZDOCUMENTDATA& document,
+                                    const CWizStdStringArray& arrayResource,
+                                    const CWizStdStringArray& arrayResourceMD5)
+{
+    if (!isBlobStoreEnabled() || document.nProtected || document.strDataMD5.isEmpty())
+        return false;
+
+    // files and references are added together, compaction takes the same
+    // lock before removing unreferenced files
+    if (!BeginTransaction())
+        return false;
+
+    // references of old note data are released
+    DeleteObjectBlobs(document.strGUID);
+
+    for (size_t i = 0; i < arrayResource.size() && i < arrayResourceMD5.size(); i++) {
+        const QString& strMD5 = arrayResourceMD5[i];
+        if (strMD5.isEmpty())
+            continue;
+
+        if (!WizCopyBlobFile(GetBlobFileName(strMD5), arrayResource[i]))
+            continue;
+
+        QString strName = "index_files/" + WizExtractFileName(arrayResource[i]);
+        AddObjectBlob(document.strGUID, strName, document.strDataMD5, strMD5,
+                      ::WizGetFileSize(arrayResource[i]));
+    }
+
+    return CommitTransaction();
+}
+
+bool CWizDatabase::AddDocumentBlobs(const WIZDOCUMENTDATA& document, const QByteArray& arrayData)
+{
+    if (!isBlobStoreEnabled() || document.nProtected || document.strDataMD5.isEmpty())
+        return false;
+
+    QBuffer buffer;
+    buffer.setData(arrayData);
+
+    CWizUnzipFile zip;
+    if (!zip.open(&buffer))
+        return false;
+
+    // decoded and hashed before locking, the note file holds no md5 of entries
+    QList<QPair<QString, QByteArray> > listResource;
+    int count = zip.count();
+    for (int i = 0; i < count; i++) {
+        CString strName = zip.fileName(i);
+        if (!strName.startsWith("index_files/"))
+            continue;
+
+        QByteArray data;
+        if (zip.extractFile(strName, data) && !data.isEmpty()) {
+            listResource.append(qMakePair(strName, data));
+        }
+    }
+
+    zip.close();
+
+    if (!BeginTransaction())
+        return false;
+
+    DeleteObjectBlobs(document.strGUID);
+
+    for (int i = 0; i < listResource.size(); i++) {
+        const QByteArray& data = listResource.at(i).second;
+
+        CWizMd5 md5;
+        md5.update(data.constData(), data.size());
+        QString strMD5 = md5.resultStringNoSpace();
+
+        if (!WizWriteBlobFile(GetBlobFileName(strMD5), data))
+            continue;
+
+        AddObjectBlob(document.strGUID, listResource.at(i).first, document.strDataMD5,
+                      strMD5, data.size());
+    }
+
+    return CommitTransaction();
+}
+
+bool CWizDatabase::AddAttachmentBlob(const QString& strGUID, const QString& strMD5)
+{
+    if (!isBlobStoreEnabled() || strMD5.isEmpty())
+        return false;
+
+    QString strFileName = GetAttachmentFileName(strGUID);
+    qint64 nSize = ::WizGetFileSize(strFileName);
+    if (nSize <= 0)
+        return false;
+
+    QString strBlobFileName = GetBlobFileName(strMD5);
+    ::WizEnsurePathExists(WizExtractFilePath(strBlobFileName));
+
+    if (!BeginTransaction())
+        return false;
+
+    bool bRet = false;
+    if (::WizGetFileSize(strBlobFileName) == nSize) {
+        // stored already, attachment file becomes another link of the blob
+        QString strTempFileName = strFileName + ".tmp";
+        QFile::remove(strTempFileName);
+        bRet = WizLinkFile(strBlobFileName, strTempFileName)
+                && WizReplaceFile(strTempFileName, strFileName);
+        if (!bRet) {
+            QFile::remove(strTempFileName);
+        }
+    } else {
+        QString strTempFileName = strBlobFileName + ".tmp";
+        QFile::remove(strTempFileName);
+        bRet = WizLinkFile(strFileName, strTempFileName)
+                && WizReplaceFile(strTempFileName, strBlobFileName);
+        if (!bRet) {
+            QFile::remove(strTempFileName);
+        }
+    }
+
+    if (bRet) {
+        bRet = AddObjectBlob(strGUID, WIZ_ATTACHMENT_BLOB_NAME, strMD5, strMD5, nSize);
+    }
+
+    CommitTransaction();
+    return bRet;
+}
+
+bool CWizDatabase::DetachAttachmentBlob(const QString& strGUID)
+{
+#ifndef Q_OS_WIN
+    QString strFileName = GetAttachmentFileName(strGUID);
+    struct stat st;
+    if (0 != ::stat(QFile::encodeName(strFileName).constData(), &st) || st.st_nlink <= 1)
+        return true;
+
+    // edited by other apps in place, changes must not go to the blob
+    QString strTempFileName = strFileName + ".tmp";
+    QFile::remove(strTempFileName);
+    if (!QFile::copy(strFileName, strTempFileName)
+            || !WizReplaceFile(strTempFileName, strFileName)) {
+        QFile::remove(strTempFileName);
+        TOLOG1("[Blob] failed to detach attachment: %1", strFileName);
+        return false;
+    }
+
+    return DeleteObjectBlobs(strGUID);
+#else
+    Q_UNUSED(strGUID);
+    return true;
+#endif
+}
+
+bool CWizDatabase::CompactBlobs(bool bScanFiles)
+{
+    CWizStdStringArray arrayMD5;
+    if (!GetUnusedBlobs(arrayMD5))
+        return false;
+
+    int nRemoved = 0;
+    CWizStdStringArray::const_iterator it;
+    for (it = arrayMD5.begin(); it != arrayMD5.end(); it++) {
+        if (!BeginTransaction())
+            return false;
+
+        // referenced again since queried
+        if (DeleteUnusedBlob(*it)) {
+            QFile::remove(GetBlobFileName(*it));
+            nRemoved++;
+        }
+
+        CommitTransaction();
+    }
+
+    if (bScanFiles && PathFileExists(GetBlobsDataPath())) {
+        if (!BeginTransaction())
+            return false;
+
+        CWizStdStringArray arrayBlob;
+        GetAllBlobs(arrayBlob);
+
+        QSet<QString> setBlob;
+        for (it = arrayBlob.begin(); it != arrayBlob.end(); it++) {
+            setBlob.insert(*it);
+        }
+
+        // such as written by crashed session, or left by failed rename
+        CWizStdStringArray arrayFile;
+        ::WizEnumFiles(GetBlobsDataPath(), "*", arrayFile, EF_INCLUDESUBDIR);
+        for (it = arrayFile.begin(); it != arrayFile.end(); it++) {
+            if (!setBlob.contains(WizExtractFileName(*it))) {
+                QFile::remove(*it);
+                nRemoved++;
+            }
+        }
+
+        CommitTransaction();
+    }
+
+    if (nRemoved) {
+        qDebug() << "[Blob] compacted, removed files:" << nRemoved;
+    }
+
+    return true;
+}
+
 bool CWizDatabase::extractZiwFileToTempFolder(const WIZDOCUMENTDATA& document, QString& strTempFolder)
 {
     strTempFolder = Utils::PathResolve::tempPath() + document.strGUID + "/";
@@ -3292,7 +3898,8 @@ bool CWizDatabase::extractZiwFileToTempFolder(const WIZDOCUMENTDATA& document, Q
 }
 
 bool CWizDatabase::extractZiwFileToFolder(const WIZDOCUMENTDATA& document,
-                                              const QString& strFolder)
+                                              const QString& strFolder,
+                                              bool bOverwrite)
 {
     CString strZipFileName = GetDocumentFileName(document.strGUID);
     if (!PathFileExists(strZipFileName)) {
@@ -3308,14 +3915,25 @@ bool CWizDatabase::extractZiwFileToFolder(const WIZDOCUMENTDATA& document,
             return false;
         }
 
-        strZipFileName = Utils::PathResolve::tempPath() + document.strGUID + "-decrypted";
-        QFile::remove(strZipFileName);
-
-        if (!m_ziwReader->decryptDataToTempFile(strZipFileName)) {
+        // unzip from decrypting device, no decrypted copy of whole note
+        QIODevice* device = m_ziwReader->decryptDataToDevice();
+        if (!device) {
             // force clear usercipher
             m_ziwReader->setUserCipher(QString());
             return false;
         }
+
+        CWizUnzipFile zip;
+        bool bRet = zip.open(device) && zip.extractAll(strFolder, bOverwrite);
+        zip.close();
+        delete device;
+
+        return bRet;
+    }
+
+    if (!bOverwrite) {
+        CWizUnzipFile zip;
+        return zip.open(strZipFileName) && zip.extractAll(strFolder, false);
     }
 
     return CWizUnzipFile::extractZip(strZipFileName, strFolder);
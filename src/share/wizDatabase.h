@@ -131,6 +131,7 @@ public:
     virtual bool GetModifiedStyleList(CWizStyleDataArray& arrayData);
     virtual bool GetModifiedDocumentList(CWizDocumentDataArray& arrayData);
     virtual bool GetModifiedAttachmentList(CWizDocumentAttachmentDataArray& arrayData);
+    virtual bool RefreshModifiedAttachments();
     virtual bool GetObjectsNeedToBeDownloaded(CWizObjectDataArray& arrayObject);
 
     virtual bool DocumentFromGUID(const QString& strGUID,
@@ -143,6 +144,9 @@ public:
     virtual bool OnDownloadAttachmentList(const CWizDocumentAttachmentDataArray& arrayData);
     virtual bool OnDownloadMessages(const CWizUserMessageDataArray& arrayData);
     virtual bool OnDownloadDocument(int part, const WIZDOCUMENTDATAEX& data);
+    virtual bool BeginTransaction();
+    virtual bool CommitTransaction();
+    virtual bool RollbackTransaction();
     virtual bool UpdateObjectData(const QString& strObjectGUID,
                                   const QString& strObjectType,
                                   const QByteArray& stream);
@@ -286,6 +290,8 @@ public:
     QString GetAttachmentsDataPath() const;
     QString GetDocumentFileName(const QString& strGUID) const;
     QString GetAttachmentFileName(const QString& strGUID);
+    QString GetBlobsDataPath() const;
+    QString GetBlobFileName(const QString& strMD5) const;
     QString GetAvatarPath() const;
     QString GetDefaultNoteLocation() const;
 
@@ -341,9 +347,18 @@ public:
                             const QString& strURL, int nFlags, bool notifyDataModify = true);
     void ClearUnusedImages(const QString& strHtml, const QString& strFilePath);
     bool UpdateDocumentAbstract(const QString& strDocumentGUID);
+    bool UpdateDocumentAbstract(const WIZDOCUMENTDATA& data, const QString& strHtml,
+                                const CWizStdStringArray& arrayResource);
 
     virtual bool UpdateDocumentDataMD5(WIZDOCUMENTDATA& data, const CString& strZipFileName, bool notifyDataModify = true);
 
+    // md5 of file in database, cached in index with file size, modified time
+    // and inode, so unchanged files are never hashed again. files modified
+    // just before hashing are not cached
+    QString CalFileMD5(const QString& strFileName);
+    // as above, files not cached are hashed by thread pool
+    bool CalFilesMD5(const QStringList& arrayFileName, QMap<QString, QString>& mapMD5);
+
     bool DeleteTagWithChildren(const WIZTAGDATA& data, bool bLog);
     bool DeleteAttachment(const WIZDOCUMENTATTACHMENTDATA& data, bool bLog, bool bReset);
 
@@ -401,13 +416,40 @@ public:
                        WIZDOCUMENTATTACHMENTDATA& dataRet);
 
 
+    // if !bExtractResources, only index.html is extracted, resources are
+    // read by CWizDocumentWebViewNetworkAccessManager when requested
     bool DocumentToTempHtmlFile(const WIZDOCUMENTDATA& document, \
                                 QString& strTempHtmlFileName, \
-                                const QString& strTargetFileNameWithoutPath = "index.html");
+                                const QString& strTargetFileNameWithoutPath = "index.html", \
+                                bool bExtractResources = true);
     bool DocumentToHtmlFile(const WIZDOCUMENTDATA& document, \
-                                const QString& strPath, const QString& strHtmlFileName = "index.html");
+                                const QString& strPath, const QString& strHtmlFileName = "index.html", \
+                                bool bExtractResources = true);
+    // read index.html only, nothing is written to disk
+    bool DocumentToHtmlData(const WIZDOCUMENTDATA& document, QString& strHtml);
+    // read one entry of note, such as index.html or index_files/xxx.png
+    bool extractZiwFileEntry(const WIZDOCUMENTDATA& document, const QString& strNameInZip, QByteArray& data);
+    // as above, resource is read from blob store if note has been registered
+    bool extractZiwFileResource(const WIZDOCUMENTDATA& document, const QString& strNameInZip, QByteArray& data);
+
+    // local blob store named by md5 of content, identical resources of notes
+    // are stored and decoded once, attachments share data by hard link
+    static void setBlobStoreEnabled(bool bEnabled);
+    static bool isBlobStoreEnabled();
+    // register resources of note just zipped, files are in arrayResource
+    bool AddDocumentBlobs(const WIZDOCUMENTDATA& document,
+                          const CWizStdStringArray& arrayResource,
+                          const CWizStdStringArray& arrayResourceMD5);
+    // register resources of note downloaded, arrayData is the note file
+    bool AddDocumentBlobs(const WIZDOCUMENTDATA& document, const QByteArray& arrayData);
+    bool AddAttachmentBlob(const QString& strGUID, const QString& strMD5);
+    // attachment file may be a link of blob, copy it before written in place
+    bool DetachAttachmentBlob(const QString& strGUID);
+    // remove blobs no longer referenced, and files unknown to the index if bScanFiles
+    bool CompactBlobs(bool bScanFiles);
+
     bool extractZiwFileToTempFolder(const WIZDOCUMENTDATA& document, QString& strTempFolder);
-    bool extractZiwFileToFolder(const WIZDOCUMENTDATA& document, const QString& strFolder);
+    bool extractZiwFileToFolder(const WIZDOCUMENTDATA& document, const QString& strFolder, bool bOverwrite = true);
     bool encryptTempFolderToZiwFile(WIZDOCUMENTDATA& document, const QString& strTempFoler, \
                                     const QString& strIndexFile, const QStringList& strResourceList);
 
@@ -708,6 +708,11 @@ bool CWizIndex::DeleteDocument(const WIZDOCUMENTDATA& data, bool bLog)
         return false;
     }
 
+    // blobs are removed by compaction after reference count drop to zero
+    if (!DeleteObjectBlobs(data.strGUID)) {
+        TOLOG1("Warning: Failed to release document blobs: %1", data.strTitle);
+    }
+
     if (bLog) {
         if (!LogDeletedGUID(data.strGUID, wizobjectDocument)) {
             TOLOG("Warning: Failed to log deleted document guid!");
@@ -898,6 +903,10 @@ bool CWizIndex::DeleteAttachment(const WIZDOCUMENTATTACHMENTDATA& data,
         return false;
     }
 
+    if (!DeleteObjectBlobs(data.strGUID)) {
+        TOLOG1("Warning: Failed to release attachment blob: %1", data.strName);
+    }
+
     if (bLog) {
         if (!LogDeletedGUID(data.strGUID, wizobjectDocumentAttachment)) {
             TOLOG("Warning: Failed to log deleted attachment guid!");
@@ -952,7 +961,11 @@ bool CWizIndex::DeleteDocumentsByLocation(const CString& strLocation)
         strLocation.utf16()
         );
 
-	return ExecSQL(strSQL);
+    if (!ExecSQL(strSQL))
+        return false;
+
+    PurgeDocumentInfoFTS();
+    return true;
 }
 
 bool CWizIndex::UpdateDocumentInfoMD5(WIZDOCUMENTDATA& data)
@@ -966,10 +979,15 @@ bool CWizIndex::UpdateDocumentInfoMD5(WIZDOCUMENTDATA& data)
 }
 
 bool CWizIndex::UpdateDocumentDataMD5(WIZDOCUMENTDATA& data, const CString& strZipFileName, bool notifyDataModify /*= true*/)
+{
+    return ModifyDocumentDataMD5(data, ::WizMd5FileString(strZipFileName), notifyDataModify);
+}
+
+bool CWizIndex::ModifyDocumentDataMD5(WIZDOCUMENTDATA& data, const CString& strDataMD5, bool notifyDataModify /*= true*/)
 {
     data.tModified = WizGetCurrentTime();
 
-    data.strDataMD5 = ::WizMd5FileString(strZipFileName);
+    data.strDataMD5 = strDataMD5;
     data.tDataModified = WizGetCurrentTime();
 
     // modify note data lead modify time change, recount info md5 needed
@@ -1436,32 +1454,41 @@ bool CWizIndex::GetDocumentParam(const CString& strDocumentGUID, \
 	strParamName.Trim();
 	strParamName.MakeUpper();
 
-	CString strWhere = WizFormatString2(_T("DOCUMENT_GUID=%1 and PARAM_NAME=%2"), 
-        STR2SQL(strDocumentGUID),
-		STR2SQL(strParamName)
-		);
+	CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_DOCUMENT_PARAM, FIELD_LIST_WIZ_DOCUMENT_PARAM,
+                                    "DOCUMENT_GUID=? and PARAM_NAME=?");
 
-	CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_DOCUMENT_PARAM, FIELD_LIST_WIZ_DOCUMENT_PARAM, strWhere); 
+    QMutexLocker locker(&m_mutexStatement);
 
-	CWizDocumentParamDataArray arrayParam;
-    if (!SQLToDocumentParamDataArray(strSQL, arrayParam)) {
-		TOLOG1(_T("Failed tog get document param: %1"), strParamName);
-        return false;
-	}
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, strDocumentGUID);
+        stmt.bind(2, strParamName);
 
-    if (arrayParam.empty()) {
-        strParamValue = CString(strDefault);
-    } else {
-		strParamValue = arrayParam[0].strValue;
+        CppSQLite3Query query = stmt.execQuery();
+        if (query.eof()) {
+            strParamValue = CString(strDefault);
+            return true;
+        }
 
-        if (arrayParam.size() > 1) {
-			TOLOG1(_T("Warning: too more param: %1"), strParamName);
-		}
+        strParamValue = query.getStringField(documentparamPARAM_VALUE);
 
-        if (pbParamExists) {
-            *pbParamExists = true;
-		}
-	}
+        query.nextRow();
+        if (!query.eof()) {
+            TOLOG1(_T("Warning: too more param: %1"), strParamName);
+        }
+
+        stmt.reset();
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        TOLOG1(_T("Failed tog get document param: %1"), strParamName);
+        return LogSQLException(e, strSQL);
+    }
+
+    if (pbParamExists) {
+        *pbParamExists = true;
+    }
 
     return true;
 }
@@ -1565,24 +1592,34 @@ bool CWizIndex::SetDocumentParam(WIZDOCUMENTDATA& data,
 
 	CString strSQL;
     if (bParamExists) {
-        strSQL.Format("update WIZ_DOCUMENT_PARAM set PARAM_VALUE=%s where DOCUMENT_GUID=%s and PARAM_NAME=%s",
-            STR2SQL(strParamValue).utf16(),
-            STR2SQL(data.strGUID).utf16(),
-            STR2SQL(strParamName).utf16()
-			);
+        strSQL = "update WIZ_DOCUMENT_PARAM set PARAM_VALUE=? where DOCUMENT_GUID=? and PARAM_NAME=?";
     } else {
-        CString strFormat = FormatInsertSQLFormat(TABLE_NAME_WIZ_DOCUMENT_PARAM,
-                                                  FIELD_LIST_WIZ_DOCUMENT_PARAM,
-                                                  PARAM_LIST_WIZ_DOCUMENT_PARAM);
-
-		strSQL.Format(strFormat,
-            STR2SQL(data.strGUID).utf16(),
-            STR2SQL(strParamName).utf16(),
-            STR2SQL(strParamValue).utf16()
-			);
+        strSQL = FormatInsertSQLFormat(TABLE_NAME_WIZ_DOCUMENT_PARAM,
+                                       FIELD_LIST_WIZ_DOCUMENT_PARAM,
+                                       "?, ?, ?");
 	}
 
-    if (!ExecSQL(strSQL)) {
+    try
+    {
+        QMutexLocker lockerWrite(&m_mutexTransaction);
+        QMutexLocker locker(&m_mutexStatement);
+
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        if (bParamExists) {
+            stmt.bind(1, CString(strParamValue));
+            stmt.bind(2, data.strGUID);
+            stmt.bind(3, CString(strParamName));
+        } else {
+            stmt.bind(1, data.strGUID);
+            stmt.bind(2, CString(strParamName));
+            stmt.bind(3, CString(strParamValue));
+        }
+
+        stmt.execDML();
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        LogSQLException(e, strSQL);
         TOLOG2("Failed to update document %1 param: %2", data.strTitle, strParamName);
         return false;
 	}
@@ -2285,25 +2322,35 @@ bool CWizIndex::ObjectExists(const QString& strGUID, const QString& strType, boo
         return false;
 	}
 
-    CString strSQL = WizFormatString3("select %1 from %2 where %1=%3",
-        strKeyFieldName, strTableName, STR2SQL(strGUID));
+    CString strSQL = WizFormatString2("select %1 from %2 where %1=?",
+        strKeyFieldName, strTableName);
 
-	CWizStdStringArray arrayGUID;
-    if (!SQLToStringArray(strSQL, 0, arrayGUID)) {
-        TOLOG("Failed to check objects!");
-        return false;
-	}
+    QMutexLocker locker(&m_mutexStatement);
 
-    if (arrayGUID.empty()) {
-        bExists = false;
-        return true;
-    } else if (arrayGUID.size() == 1) {
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, CString(strGUID));
+
+        CppSQLite3Query query = stmt.execQuery();
+        if (query.eof()) {
+            bExists = false;
+            return true;
+        }
+
+        query.nextRow();
+        bool bUnique = query.eof();
+        stmt.reset();
+
+        Q_ASSERT(bUnique);
         bExists = true;
-        return true;
-    } else {
-        Q_ASSERT(0);
-        return false;
-	}
+        return bUnique;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        TOLOG("Failed to check objects!");
+        return LogSQLException(e, strSQL);
+    }
 }
 
 bool CWizIndex::DeleteObject(const QString& strGUID, const QString& strType, bool bLog)
@@ -2388,18 +2435,24 @@ qint64 CWizIndex::GetObjectLocalVersion(const QString& strGUID, const QString& s
         return false;
 
     CString strSQL;
-    strSQL = WizFormatString3("select WIZ_VERSION from %1 where %2=%3",
+    strSQL = WizFormatString2("select WIZ_VERSION from %1 where %2=?",
                             strTableName,
-                            strKeyFieldName,
-                            STR2SQL(strGUID));
+                            strKeyFieldName);
+
+    QMutexLocker locker(&m_mutexStatement);
 
     try
     {
-        CppSQLite3Query query = m_db.execQuery(strSQL);
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, CString(strGUID));
+
+        CppSQLite3Query query = stmt.execQuery();
 
         if (!query.eof())
         {
-            return query.getInt64Field(0);
+            qint64 nVersion = query.getInt64Field(0);
+            stmt.reset();
+            return nVersion;
         }
         else
         {
@@ -2426,13 +2479,25 @@ bool CWizIndex::ModifyObjectVersion(const CString& strGUID, const CString& strTy
     if (!GetObjectTableInfo(strType, strTableName, strKeyFieldName))
         return false;
     //
-    CString strSQL = WizFormatString4("update %1 set WIZ_VERSION=%2 where %3=%4",
+    CString strSQL = WizFormatString2("update %1 set WIZ_VERSION=? where %2=?",
 		strTableName,
-		WizInt64ToStr(nVersion),
-		strKeyFieldName, 
-        STR2SQL(strGUID));
+		strKeyFieldName);
 
-    return ExecSQL(strSQL);
+    QMutexLocker lockerWrite(&m_mutexTransaction);
+    QMutexLocker locker(&m_mutexStatement);
+
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, (sqlite_int64)nVersion);
+        stmt.bind(2, strGUID);
+        stmt.execDML();
+        return true;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        return LogSQLException(e, strSQL);
+    }
 }
 
 bool CWizIndex::IsObjectDataModified(const CString& strGUID, const CString& strType)
@@ -2510,7 +2575,10 @@ bool CWizIndex::SearchDocumentByTitle(const QString& strTitle,
                                       int nMaxCount,
                                       CWizDocumentDataArray& arrayDocument)
 {
-    CString strWhere = WizFormatString1(" DOCUMENT_TITLE like '%%1%'", strTitle);
+    CString strWhere = DocumentInfoFTSToSQL(strTitle, "DOCUMENT_TITLE");
+    if (strWhere.isEmpty()) {
+        strWhere = WizFormatString1(" DOCUMENT_TITLE like '%%1%'", strTitle);
+    }
 
     if (!strLocation.isEmpty()) {
         CString strWhereLocation;
@@ -2523,16 +2591,11 @@ bool CWizIndex::SearchDocumentByTitle(const QString& strTitle,
         strWhere += strWhereLocation;
     }
 
-    CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_DOCUMENT, FIELD_LIST_WIZ_DOCUMENT, strWhere);
-
-    if (!SQLToDocumentDataArray(strSQL, arrayDocument))
-        return false;
+    strWhere += WizFormatString1(" limit %1", nMaxCount);
 
-    if (arrayDocument.size() > nMaxCount) {
-        arrayDocument.resize(nMaxCount);
-    }
+    CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_DOCUMENT, FIELD_LIST_WIZ_DOCUMENT, strWhere);
 
-    return true;
+    return SQLToDocumentDataArray(strSQL, arrayDocument);
 }
 
 CString URLToSQL(const CString& strURL)
@@ -2801,12 +2864,20 @@ CString TitleToSQL(CWizIndex& index, const CString& strKeywords, const WIZSEARCH
 	
 	if (bAddExtra)
 	{
-		arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_TITLE like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
-		arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_NAME like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
-		arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_SEO like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
-		arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_URL like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
-		arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_AUTHOR like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
-		arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_KEYWORDS like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
+		CString strFTS = index.DocumentInfoFTSToSQL(strTitle);
+		if (!strFTS.IsEmpty())
+		{
+			arrayWhere.push_back(WizFormatString1(_T("(%1)"), strFTS));
+		}
+		else
+		{
+			arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_TITLE like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
+			arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_NAME like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
+			arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_SEO like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
+			arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_URL like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
+			arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_AUTHOR like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
+			arrayWhere.push_back(WizFormatString1(_T("(DOCUMENT_KEYWORDS like %1)"), STR2SQL_LIKE_BOTH(strTitle)));
+		}
 		if (data.strAttachmentName.IsEmpty())
 		{
 			arrayWhere.push_back(WizFormatString1(_T("(%1)"), AttachmentNameToSQL(strTitle)));
@@ -2846,6 +2917,10 @@ CString TitleToSQL(CWizIndex& index, const CString& strKeywords, const WIZSEARCH
 	}
 	else
 	{
+		CString strFTS = index.DocumentInfoFTSToSQL(strTitle, _T("DOCUMENT_TITLE"));
+		if (!strFTS.IsEmpty())
+			return strFTS;
+		//
 		CWizStdStringArray arrayText;
 		::WizSplitTextToArray(strTitle, ' ', arrayText);
 		for (CWizStdStringArray::const_iterator it = arrayText.begin();
@@ -2954,7 +3029,12 @@ bool CWizIndex::Search(const CString& strKeywords,
 	//
 	strFormat = _T("(") + strFormat + _T(")");
 	//
-	CString strWhere;
+	CString strWhere = DocumentInfoFTSToSQL(strKeywords);
+	if (!strWhere.IsEmpty())
+	{
+		// matched by fts index already, no need to like every field
+		arrayKeywords.clear();
+	}
 	//
 	for (CWizStdStringArray::const_iterator it = arrayKeywords.begin();
 		it != arrayKeywords.end();
@@ -3924,3 +4004,259 @@ void CWizIndex::DeleteExtraFolder(const QString& strLocation)
 
     SetExtraFolder(arrayLocation);
 }
+
+bool CWizIndex::GetFileMD5(const CString& strFileName,
+                           qint64 nSize,
+                           qint64 nModified,
+                           qint64 nInode,
+                           CString& strMD5)
+{
+    CString strSQL = "select FILE_MD5 from " TABLE_NAME_WIZ_FILE_MD5
+            " where FILE_NAME=? and FILE_SIZE=? and FILE_MODIFIED=? and FILE_INODE=?";
+
+    QMutexLocker locker(&m_mutexStatement);
+
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, strFileName);
+        stmt.bind(2, sqlite_int64(nSize));
+        stmt.bind(3, sqlite_int64(nModified));
+        stmt.bind(4, sqlite_int64(nInode));
+
+        CppSQLite3Query query = stmt.execQuery();
+        if (query.eof())
+            return false;
+
+        strMD5 = query.getStringField(0);
+        stmt.reset();
+        return !strMD5.isEmpty();
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        return LogSQLException(e, strSQL);
+    }
+}
+
+bool CWizIndex::SetFileMD5(const CString& strFileName,
+                           qint64 nSize,
+                           qint64 nModified,
+                           qint64 nInode,
+                           const CString& strMD5)
+{
+    CString strSQL = "insert or replace into " TABLE_NAME_WIZ_FILE_MD5
+            " (" FIELD_LIST_WIZ_FILE_MD5 ") values (?, ?, ?, ?, ?)";
+
+    QMutexLocker lockerWrite(&m_mutexTransaction);
+    QMutexLocker locker(&m_mutexStatement);
+
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, strFileName);
+        stmt.bind(2, sqlite_int64(nSize));
+        stmt.bind(3, sqlite_int64(nModified));
+        stmt.bind(4, sqlite_int64(nInode));
+        stmt.bind(5, strMD5);
+        stmt.execDML();
+        return true;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        return LogSQLException(e, strSQL);
+    }
+}
+
+bool CWizIndex::DeleteFileMD5(const CString& strFileName)
+{
+    CString strSQL = "delete from " TABLE_NAME_WIZ_FILE_MD5 " where FILE_NAME=?";
+
+    QMutexLocker lockerWrite(&m_mutexTransaction);
+    QMutexLocker locker(&m_mutexStatement);
+
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, strFileName);
+        stmt.execDML();
+        return true;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        return LogSQLException(e, strSQL);
+    }
+}
+
+bool CWizIndex::GetObjectBlob(const CString& strObjectGUID,
+                              const CString& strName,
+                              const CString& strDataMD5,
+                              CString& strBlobMD5)
+{
+    CString strSQL = "select BLOB_MD5 from " TABLE_NAME_WIZ_OBJECT_BLOB
+            " where OBJECT_GUID=? and BLOB_NAME=? and OBJECT_DATA_MD5=?";
+
+    QMutexLocker locker(&m_mutexStatement);
+
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, strObjectGUID);
+        stmt.bind(2, strName);
+        stmt.bind(3, strDataMD5);
+
+        CppSQLite3Query query = stmt.execQuery();
+        if (query.eof())
+            return false;
+
+        strBlobMD5 = query.getStringField(0);
+        stmt.reset();
+        return true;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        return LogSQLException(e, strSQL);
+    }
+}
+
+bool CWizIndex::AddObjectBlob(const CString& strObjectGUID,
+                              const CString& strName,
+                              const CString& strDataMD5,
+                              const CString& strBlobMD5,
+                              qint64 nSize)
+{
+    CString strSQLOld = "select BLOB_MD5 from " TABLE_NAME_WIZ_OBJECT_BLOB
+            " where OBJECT_GUID=? and BLOB_NAME=?";
+    CString strSQLRelease = "update " TABLE_NAME_WIZ_BLOB
+            " set BLOB_REF_COUNT=BLOB_REF_COUNT-1 where BLOB_MD5=?";
+    CString strSQLRef = "insert or replace into " TABLE_NAME_WIZ_OBJECT_BLOB
+            " (" FIELD_LIST_WIZ_OBJECT_BLOB ") values (?, ?, ?, ?)";
+    CString strSQLBlob = "insert or ignore into " TABLE_NAME_WIZ_BLOB
+            " (" FIELD_LIST_WIZ_BLOB ") values (?, ?, 0)";
+    CString strSQLAddRef = "update " TABLE_NAME_WIZ_BLOB
+            " set BLOB_REF_COUNT=BLOB_REF_COUNT+1 where BLOB_MD5=?";
+
+    if (!BeginTransaction())
+        return false;
+
+    CString strSQL;
+    try
+    {
+        QMutexLocker locker(&m_mutexStatement);
+
+        strSQL = strSQLOld;
+        CppSQLite3Statement& stmtOld = Statement(strSQL);
+        stmtOld.bind(1, strObjectGUID);
+        stmtOld.bind(2, strName);
+
+        CString strOldMD5;
+        bool bOld = false;
+        CppSQLite3Query query = stmtOld.execQuery();
+        if (!query.eof()) {
+            strOldMD5 = query.getStringField(0);
+            bOld = true;
+        }
+        stmtOld.reset();
+
+        if (bOld && strOldMD5 != strBlobMD5) {
+            strSQL = strSQLRelease;
+            CppSQLite3Statement& stmt = Statement(strSQL);
+            stmt.bind(1, strOldMD5);
+            stmt.execDML();
+        }
+
+        strSQL = strSQLRef;
+        CppSQLite3Statement& stmtRef = Statement(strSQL);
+        stmtRef.bind(1, strObjectGUID);
+        stmtRef.bind(2, strName);
+        stmtRef.bind(3, strDataMD5);
+        stmtRef.bind(4, strBlobMD5);
+        stmtRef.execDML();
+
+        if (!bOld || strOldMD5 != strBlobMD5) {
+            strSQL = strSQLBlob;
+            CppSQLite3Statement& stmtBlob = Statement(strSQL);
+            stmtBlob.bind(1, strBlobMD5);
+            stmtBlob.bind(2, sqlite_int64(nSize));
+            stmtBlob.execDML();
+
+            strSQL = strSQLAddRef;
+            CppSQLite3Statement& stmt = Statement(strSQL);
+            stmt.bind(1, strBlobMD5);
+            stmt.execDML();
+        }
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        RollbackTransaction();
+        return LogSQLException(e, strSQL);
+    }
+
+    return CommitTransaction();
+}
+
+bool CWizIndex::DeleteObjectBlobs(const CString& strObjectGUID)
+{
+    // one reference per name, same image may be used twice by one note
+    CString strSQLRelease = "update " TABLE_NAME_WIZ_BLOB " set BLOB_REF_COUNT=BLOB_REF_COUNT-"
+            "(select count(*) from " TABLE_NAME_WIZ_OBJECT_BLOB
+            " where OBJECT_GUID=?1 and BLOB_MD5=" TABLE_NAME_WIZ_BLOB ".BLOB_MD5)"
+            " where BLOB_MD5 in (select BLOB_MD5 from " TABLE_NAME_WIZ_OBJECT_BLOB
+            " where OBJECT_GUID=?1)";
+    CString strSQLDelete = "delete from " TABLE_NAME_WIZ_OBJECT_BLOB " where OBJECT_GUID=?";
+
+    if (!BeginTransaction())
+        return false;
+
+    CString strSQL;
+    try
+    {
+        QMutexLocker locker(&m_mutexStatement);
+
+        strSQL = strSQLRelease;
+        CppSQLite3Statement& stmtRelease = Statement(strSQL);
+        stmtRelease.bind(1, strObjectGUID);
+        stmtRelease.execDML();
+
+        strSQL = strSQLDelete;
+        CppSQLite3Statement& stmtDelete = Statement(strSQL);
+        stmtDelete.bind(1, strObjectGUID);
+        stmtDelete.execDML();
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        RollbackTransaction();
+        return LogSQLException(e, strSQL);
+    }
+
+    return CommitTransaction();
+}
+
+bool CWizIndex::GetUnusedBlobs(CWizStdStringArray& arrayMD5)
+{
+    return SQLToStringArray("select BLOB_MD5 from " TABLE_NAME_WIZ_BLOB " where BLOB_REF_COUNT<=0",
+                            0, arrayMD5);
+}
+
+bool CWizIndex::GetAllBlobs(CWizStdStringArray& arrayMD5)
+{
+    return SQLToStringArray("select BLOB_MD5 from " TABLE_NAME_WIZ_BLOB, 0, arrayMD5);
+}
+
+bool CWizIndex::DeleteUnusedBlob(const CString& strMD5)
+{
+    CString strSQL = "delete from " TABLE_NAME_WIZ_BLOB " where BLOB_MD5=? and BLOB_REF_COUNT<=0";
+
+    QMutexLocker lockerWrite(&m_mutexTransaction);
+    QMutexLocker locker(&m_mutexStatement);
+
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, strMD5);
+        return stmt.execDML() > 0;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        return LogSQLException(e, strSQL);
+    }
+}
@@ -189,6 +189,8 @@ public:
     virtual bool UpdateDocumentInfoMD5(WIZDOCUMENTDATA& data);
     bool UpdateDocumentsInfoMD5(CWizDocumentDataArray& arrayDocument);
     virtual bool UpdateDocumentDataMD5(WIZDOCUMENTDATA& data, const CString& strZipFileName, bool notifyDataModify = true);
+    // md5 of note data is known already, eg: calculated while writing zip
+    bool ModifyDocumentDataMD5(WIZDOCUMENTDATA& data, const CString& strDataMD5, bool notifyDataModify = true);
 
     bool CreateDocument(const CString& strTitle, const CString& strName, \
                         const CString& strLocation, const CString& strURL, \
@@ -343,6 +345,25 @@ public:
     bool SetMetaInt64(const CString& strMetaName, const CString& strKey, qint64 n);
     bool deleteMetasByName(const QString& strMetaName);
 
+    /* File md5 cache related operations */
+    bool GetFileMD5(const CString& strFileName, qint64 nSize, qint64 nModified,
+                    qint64 nInode, CString& strMD5);
+    bool SetFileMD5(const CString& strFileName, qint64 nSize, qint64 nModified,
+                    qint64 nInode, const CString& strMD5);
+    bool DeleteFileMD5(const CString& strFileName);
+
+    /* Blob store related operations */
+    bool GetObjectBlob(const CString& strObjectGUID, const CString& strName,
+                       const CString& strDataMD5, CString& strBlobMD5);
+    // replace blob used by strName of object, reference count is updated
+    bool AddObjectBlob(const CString& strObjectGUID, const CString& strName,
+                       const CString& strDataMD5, const CString& strBlobMD5, qint64 nSize);
+    bool DeleteObjectBlobs(const CString& strObjectGUID);
+    bool GetUnusedBlobs(CWizStdStringArray& arrayMD5);
+    bool GetAllBlobs(CWizStdStringArray& arrayMD5);
+    // return false if blob is referenced again
+    bool DeleteUnusedBlob(const CString& strMD5);
+
     /* Deleted related operations */
     bool GetDeletedGUIDs(CWizDeletedGUIDDataArray& arrayGUID);
     bool GetDeletedGUIDs(WizObjectType eType, CWizDeletedGUIDDataArray& arrayGUID);
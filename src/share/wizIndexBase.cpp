@@ -1,13 +1,18 @@
 #include "wizIndexBase.h"
 
 #include <QDebug>
+#include <QStringList>
 
 #include "utils/logger.h"
 #include "utils/pathresolve.h"
 
 
 CWizIndexBase::CWizIndexBase(void)
-    : m_bUpdating(false)
+    : m_mutexStatement(QMutex::Recursive)
+    , m_mutexTransaction(QMutex::Recursive)
+    , m_bUpdating(false)
+    , m_nTransactionDepth(0)
+    , m_bDocumentInfoFTS(false)
 {
     qRegisterMetaType<WIZTAGDATA>("WIZTAGDATA");
     qRegisterMetaType<WIZSTYLEDATA>("WIZSTYLEDATA");
@@ -39,6 +44,9 @@ bool CWizIndexBase::Open(const CString& strFileName)
             return false;
     }
 
+    // optional, search fallback to like if failed
+    InitDocumentInfoFTS();
+
     return true;
 }
 
@@ -49,7 +57,335 @@ bool CWizIndexBase::IsOpened()
 
 void CWizIndexBase::Close()
 {
+    if (m_bDocumentInfoFTS) {
+        SaveDocumentInfoFTSState();
+    }
+
+    // sqlite refuse to close database with unfinalized statements
+    ClearStatements();
     m_db.close();
+    m_bDocumentInfoFTS = false;
+}
+
+CppSQLite3Statement& CWizIndexBase::Statement(const CString& strSQL)
+{
+    std::map<CString, CppSQLite3Statement*>::const_iterator it = m_mapStatement.find(strSQL);
+    if (it != m_mapStatement.end()) {
+        it->second->reset();
+        return *it->second;
+    }
+
+    CppSQLite3Statement* pStatement = new CppSQLite3Statement(m_db.compileStatement(strSQL));
+    m_mapStatement[strSQL] = pStatement;
+    return *pStatement;
+}
+
+void CWizIndexBase::ClearStatements()
+{
+    QMutexLocker locker(&m_mutexStatement);
+
+    std::map<CString, CppSQLite3Statement*>::const_iterator it;
+    for (it = m_mapStatement.begin(); it != m_mapStatement.end(); it++) {
+        delete it->second;
+    }
+
+    m_mapStatement.clear();
+}
+
+bool CWizIndexBase::BeginTransaction()
+{
+    // held until the matching commit or rollback, writes from other
+    // threads wait instead of landing inside this transaction
+    m_mutexTransaction.lock();
+
+    if (!ExecSQL("savepoint WIZ_TRANSACTION")) {
+        m_mutexTransaction.unlock();
+        return false;
+    }
+
+    m_nTransactionDepth++;
+    return true;
+}
+
+bool CWizIndexBase::CommitTransaction()
+{
+    Q_ASSERT(m_nTransactionDepth > 0);
+    if (m_nTransactionDepth <= 0)
+        return false;
+
+    // release of outermost savepoint commits the transaction
+    if (ExecSQL("release savepoint WIZ_TRANSACTION")) {
+        m_nTransactionDepth--;
+        m_mutexTransaction.unlock();
+        return true;
+    }
+
+    // leave nothing pending if commit failed, eg: disk is full
+    RollbackTransaction();
+    return false;
+}
+
+bool CWizIndexBase::RollbackTransaction()
+{
+    Q_ASSERT(m_nTransactionDepth > 0);
+    if (m_nTransactionDepth <= 0)
+        return false;
+
+    m_nTransactionDepth--;
+
+    bool bRet = ExecSQL("rollback transaction to savepoint WIZ_TRANSACTION");
+    bRet = ExecSQL("release savepoint WIZ_TRANSACTION") && bRet;
+    m_mutexTransaction.unlock();
+    return bRet;
+}
+
+static bool WizIsCJKChar(ushort c)
+{
+    return (c >= 0x2E80 && c <= 0x9FFF)     // cjk symbols, kana, ideographs
+        || (c >= 0xAC00 && c <= 0xD7AF)     // hangul
+        || (c >= 0xF900 && c <= 0xFAFF)     // compatibility ideographs
+        || (c >= 0xFF00 && c <= 0xFFEF);    // full width forms
+}
+
+QString CWizIndexBase::DocumentInfoFTSText(const QString& strText)
+{
+    // simple tokenizer take a run of non-ascii chars as one token, split cjk
+    // text into single chars so words inside a sentence can be matched
+    QString strRet;
+    strRet.reserve(strText.size() * 2);
+
+    for (int i = 0; i < strText.size(); i++) {
+        QChar ch = strText.at(i);
+        if (WizIsCJKChar(ch.unicode())) {
+            strRet += ' ';
+            strRet += ch;
+            strRet += ' ';
+        } else {
+            strRet += ch;
+        }
+    }
+
+    return strRet;
+}
+
+CString CWizIndexBase::DocumentInfoFTSToSQL(const CString& strKeywords,
+                                            const CString& strField /* = CString() */) const
+{
+    if (!m_bDocumentInfoFTS)
+        return CString();
+
+    // guid column is not searched, sqlite 3.7.8 has no notindexed option
+    QStringList listField;
+    if (strField.isEmpty()) {
+        listField = QString(FIELD_LIST_WIZ_DOCUMENT_INFO_FTS).split(',', QString::SkipEmptyParts);
+    } else {
+        listField.append(strField);
+    }
+
+    QStringList listWord = strKeywords.split(' ', QString::SkipEmptyParts);
+    QStringList listExpr;
+    foreach (const QString& strWord, listWord) {
+        // ascii punctuation is separator for tokenizer, drop it here to
+        // avoid query syntax chars, eg: " * : - ( )
+        QString strTerm;
+        for (int i = 0; i < strWord.size(); i++) {
+            QChar ch = strWord.at(i);
+            strTerm += (ch.unicode() < 128 && !ch.isLetterOrNumber()) ? QChar(' ') : ch;
+        }
+
+        strTerm = DocumentInfoFTSText(strTerm).simplified();
+        if (strTerm.isEmpty())
+            continue;
+
+        // every word as a phrase, prefix match if ends with ascii word
+        if (strTerm.at(strTerm.size() - 1).unicode() < 128) {
+            strTerm += '*';
+        }
+
+        // OR binds tighter than implicit AND in standard query syntax
+        QStringList listColumnExpr;
+        foreach (const QString& strColumn, listField) {
+            listColumnExpr.append(strColumn.trimmed() + ":\"" + strTerm + "\"");
+        }
+
+        listExpr.append(listColumnExpr.join(" OR "));
+    }
+
+    if (listExpr.isEmpty())
+        return CString();
+
+    return WizFormatString2("DOCUMENT_GUID in (select DOCUMENT_GUID from %1 where %1 match %2)",
+                            TABLE_NAME_WIZ_DOCUMENT_INFO_FTS,
+                            STR2SQL(listExpr.join(" ")));
+}
+
+bool CWizIndexBase::InitDocumentInfoFTS()
+{
+    m_bDocumentInfoFTS = false;
+
+    // sqlite may be built without fts
+    bool bCreated = !m_db.tableExists(TABLE_NAME_WIZ_DOCUMENT_INFO_FTS);
+    if (!bCreated) {
+        // early index was keyed by rowid of documents, which is not stable
+        try {
+            m_db.execQuery("select DOCUMENT_GUID from " TABLE_NAME_WIZ_DOCUMENT_INFO_FTS " limit 1");
+        } catch (const CppSQLite3Exception&) {
+            ExecSQL("drop table " TABLE_NAME_WIZ_DOCUMENT_INFO_FTS);
+            bCreated = true;
+        }
+    }
+
+    if (!CheckTable(TABLE_NAME_WIZ_DOCUMENT_INFO_FTS)) {
+        TOLOG("Document info fts is not available, search by like instead");
+        return false;
+    }
+
+    m_bDocumentInfoFTS = true;
+
+    // rebuild if just created, or documents are changed by old versions
+    // which know nothing about the index, or not closed normally
+    if (!bCreated) {
+        CWizStdStringArray arrayState;
+        SQLToStringArray("select META_VALUE from " TABLE_NAME_WIZ_META
+                         " where META_NAME='INDEX' and META_KEY='DOCUMENT_INFO_FTS'", 0, arrayState);
+
+        CString strState = DocumentInfoFTSState();
+        if (!arrayState.empty() && !strState.isEmpty() && arrayState[0] == strState) {
+            return true;
+        }
+    }
+
+    return RebuildDocumentInfoFTS() && SaveDocumentInfoFTSState();
+}
+
+CString CWizIndexBase::DocumentInfoFTSState()
+{
+    CWizStdStringArray arrayState;
+    if (!SQLToStringArray("select count(*) || '|' || ifnull(max(DT_MODIFIED), '') || '|' "
+                          "|| ifnull(max(DT_INFO_MODIFIED), '') from " TABLE_NAME_WIZ_DOCUMENT,
+                          0, arrayState) || arrayState.empty()) {
+        return CString();
+    }
+
+    return arrayState[0];
+}
+
+bool CWizIndexBase::SaveDocumentInfoFTSState()
+{
+    CString strState = DocumentInfoFTSState();
+    if (strState.isEmpty())
+        return false;
+
+    CString strSQL = WizFormatString2("insert or replace into " TABLE_NAME_WIZ_META
+                                      " (META_NAME, META_KEY, META_VALUE, DT_MODIFIED)"
+                                      " values ('INDEX', 'DOCUMENT_INFO_FTS', %1, %2)",
+                                      STR2SQL(strState),
+                                      TIME2SQL(WizGetCurrentTime()));
+    return ExecSQL(strSQL);
+}
+
+bool CWizIndexBase::RebuildDocumentInfoFTS()
+{
+    if (!BeginTransaction()) {
+        m_bDocumentInfoFTS = false;
+        return false;
+    }
+
+    CString strSQL = "select DOCUMENT_GUID, " FIELD_LIST_WIZ_DOCUMENT_INFO_FTS " from " TABLE_NAME_WIZ_DOCUMENT;
+    bool bRet = ExecSQL("delete from " TABLE_NAME_WIZ_DOCUMENT_INFO_FTS);
+    if (bRet) {
+        try {
+            CppSQLite3Statement stmt = m_db.compileStatement(
+                        "insert into " TABLE_NAME_WIZ_DOCUMENT_INFO_FTS
+                        "(DOCUMENT_GUID, " FIELD_LIST_WIZ_DOCUMENT_INFO_FTS ") values (?, ?, ?, ?, ?, ?, ?, ?)");
+
+            CppSQLite3Query query = m_db.execQuery(strSQL);
+            while (!query.eof()) {
+                stmt.bind(1, CString(query.getStringField(0)));
+                for (int i = 1; i <= FIELD_COUNT_WIZ_DOCUMENT_INFO_FTS; i++) {
+                    stmt.bind(i + 1, CString(DocumentInfoFTSText(query.getStringField(i))));
+                }
+
+                stmt.execDML();
+                stmt.reset();
+                query.nextRow();
+            }
+        } catch (const CppSQLite3Exception& e) {
+            bRet = LogSQLException(e, strSQL);
+        }
+    }
+
+    if (!bRet) {
+        RollbackTransaction();
+        m_bDocumentInfoFTS = false;
+        return false;
+    }
+
+    m_bDocumentInfoFTS = CommitTransaction();
+    return m_bDocumentInfoFTS;
+}
+
+bool CWizIndexBase::UpdateDocumentInfoFTS(const WIZDOCUMENTDATA& data)
+{
+    if (!m_bDocumentInfoFTS)
+        return true;
+
+    if (!DeleteDocumentInfoFTS(data.strGUID))
+        return false;
+
+    CString strSQL = "insert into " TABLE_NAME_WIZ_DOCUMENT_INFO_FTS
+            "(DOCUMENT_GUID, " FIELD_LIST_WIZ_DOCUMENT_INFO_FTS ") values (?, ?, ?, ?, ?, ?, ?, ?)";
+
+    try {
+        QMutexLocker lockerWrite(&m_mutexTransaction);
+        QMutexLocker locker(&m_mutexStatement);
+
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, data.strGUID);
+        stmt.bind(2, CString(DocumentInfoFTSText(data.strTitle)));
+        stmt.bind(3, CString(DocumentInfoFTSText(data.strName)));
+        stmt.bind(4, CString(DocumentInfoFTSText(data.strSEO)));
+        stmt.bind(5, CString(DocumentInfoFTSText(data.strURL)));
+        stmt.bind(6, CString(DocumentInfoFTSText(data.strAuthor)));
+        stmt.bind(7, CString(DocumentInfoFTSText(data.strKeywords)));
+        stmt.bind(8, CString(DocumentInfoFTSText(data.strOwner)));
+        stmt.execDML();
+        return true;
+    } catch (const CppSQLite3Exception& e) {
+        return LogSQLException(e, strSQL);
+    }
+}
+
+bool CWizIndexBase::DeleteDocumentInfoFTS(const CString& strDocumentGUID)
+{
+    if (!m_bDocumentInfoFTS)
+        return true;
+
+    // guid is tokenized, so match it as a phrase before comparing exactly
+    CString strSQL = "delete from " TABLE_NAME_WIZ_DOCUMENT_INFO_FTS " where "
+            TABLE_NAME_WIZ_DOCUMENT_INFO_FTS " match ? and DOCUMENT_GUID=?";
+
+    try {
+        QMutexLocker lockerWrite(&m_mutexTransaction);
+        QMutexLocker locker(&m_mutexStatement);
+
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, CString("DOCUMENT_GUID:\"" + strDocumentGUID + "\""));
+        stmt.bind(2, strDocumentGUID);
+        stmt.execDML();
+        return true;
+    } catch (const CppSQLite3Exception& e) {
+        return LogSQLException(e, strSQL);
+    }
+}
+
+bool CWizIndexBase::PurgeDocumentInfoFTS()
+{
+    if (!m_bDocumentInfoFTS)
+        return true;
+
+    return ExecSQL("delete from " TABLE_NAME_WIZ_DOCUMENT_INFO_FTS " where DOCUMENT_GUID not in "
+                   "(select DOCUMENT_GUID from " TABLE_NAME_WIZ_DOCUMENT ")");
 }
 
 bool CWizIndexBase::CheckTable(const QString& strTableName)
@@ -68,6 +404,8 @@ bool CWizIndexBase::CheckTable(const QString& strTableName)
 
 bool CWizIndexBase::ExecSQL(const CString& strSQL)
 {
+    QMutexLocker locker(&m_mutexTransaction);
+
     try {
         m_db.execDML(strSQL);
         return true;
@@ -83,6 +421,7 @@ CppSQLite3Query CWizIndexBase::Query(const CString& strSQL)
 
 int CWizIndexBase::Exec(const CString& strSQL)
 {
+    QMutexLocker locker(&m_mutexTransaction);
     return m_db.execDML(strSQL);
 }
 
@@ -267,6 +606,17 @@ bool CWizIndexBase::SQLToSize(const CString& strSQL, int& size)
     }
 }
 
+void CWizIndexBase::QueryToTagData(CppSQLite3Query& query, WIZTAGDATA& data)
+{
+    data.strKbGUID = kbGUID();
+    data.strGUID = query.getStringField(tagTAG_GUID);
+    data.strParentGUID = query.getStringField(tagTAG_GROUP_GUID);
+    data.strName = query.getStringField(tagTAG_NAME);
+    data.strDescription = query.getStringField(tagTAG_DESCRIPTION);
+    data.tModified = query.getTimeField(tagDT_MODIFIED);
+    data.nVersion = query.getInt64Field(tagVersion);
+}
+
 bool CWizIndexBase::SQLToTagDataArray(const CString& strSQL, CWizTagDataArray& arrayTag)
 {
     try
@@ -275,13 +625,7 @@ bool CWizIndexBase::SQLToTagDataArray(const CString& strSQL, CWizTagDataArray& a
         while (!query.eof())
         {
             WIZTAGDATA data;
-            data.strKbGUID = kbGUID();
-            data.strGUID = query.getStringField(tagTAG_GUID);
-            data.strParentGUID = query.getStringField(tagTAG_GROUP_GUID);
-            data.strName = query.getStringField(tagTAG_NAME);
-            data.strDescription = query.getStringField(tagTAG_DESCRIPTION);
-            data.tModified = query.getTimeField(tagDT_MODIFIED);
-            data.nVersion = query.getInt64Field(tagVersion);
+            QueryToTagData(query, data);
 
             arrayTag.push_back(data);
             query.nextRow();
@@ -421,6 +765,39 @@ bool CWizIndexBase::SQLToDocumentParamDataArray(const CString& strSQL, CWizDocum
     }
 }
 
+void CWizIndexBase::QueryToDocumentData(CppSQLite3Query& query, WIZDOCUMENTDATA& data)
+{
+    data.strKbGUID = kbGUID();
+    data.strGUID = query.getStringField(documentDOCUMENT_GUID);
+    data.strTitle = query.getStringField(documentDOCUMENT_TITLE);
+    data.strLocation = query.getStringField(documentDOCUMENT_LOCATION);
+    data.strName = query.getStringField(documentDOCUMENT_NAME);
+    data.strSEO = query.getStringField(documentDOCUMENT_SEO);
+    data.strURL = query.getStringField(documentDOCUMENT_URL);
+    data.strAuthor = query.getStringField(documentDOCUMENT_AUTHOR);
+    data.strKeywords = query.getStringField(documentDOCUMENT_KEYWORDS);
+    data.strType = query.getStringField(documentDOCUMENT_TYPE);
+    data.strOwner = query.getStringField(documentDOCUMENT_OWNER);
+    data.strFileType = query.getStringField(documentDOCUMENT_FILE_TYPE);
+    data.strStyleGUID = query.getStringField(documentSTYLE_GUID);
+    data.tCreated = query.getTimeField(documentDT_CREATED);
+    data.tModified = query.getTimeField(documentDT_MODIFIED);
+    data.tAccessed = query.getTimeField(documentDT_ACCESSED);
+    data.nIconIndex = query.getIntField(documentDOCUMENT_ICON_INDEX);
+    data.nSync = query.getIntField(documentDOCUMENT_SYNC);
+    data.nProtected = query.getIntField(documentDOCUMENT_PROTECT);
+    data.nReadCount = query.getIntField(documentDOCUMENT_READ_COUNT);
+    data.nAttachmentCount = query.getIntField(documentDOCUMENT_ATTACHEMENT_COUNT);
+    data.nIndexed = query.getIntField(documentDOCUMENT_INDEXED);
+    data.tInfoModified = query.getTimeField(documentDT_INFO_MODIFIED);
+    data.strInfoMD5 = query.getStringField(documentDOCUMENT_INFO_MD5);
+    data.tDataModified = query.getTimeField(documentDT_DATA_MODIFIED);
+    data.strDataMD5 = query.getStringField(documentDOCUMENT_DATA_MD5);
+    data.tParamModified = query.getTimeField(documentDT_PARAM_MODIFIED);
+    data.strParamMD5 = query.getStringField(documentDOCUMENT_PARAM_MD5);
+    data.nVersion = query.getInt64Field(documentVersion);
+}
+
 bool CWizIndexBase::SQLToDocumentDataArray(const CString& strSQL, CWizDocumentDataArray& arrayDocument)
 {
     try
@@ -431,35 +808,7 @@ bool CWizIndexBase::SQLToDocumentDataArray(const CString& strSQL, CWizDocumentDa
         while (!query.eof())
         {
             WIZDOCUMENTDATA data;
-            data.strKbGUID = kbGUID();
-            data.strGUID = query.getStringField(documentDOCUMENT_GUID);
-            data.strTitle = query.getStringField(documentDOCUMENT_TITLE);
-            data.strLocation = query.getStringField(documentDOCUMENT_LOCATION);
-            data.strName = query.getStringField(documentDOCUMENT_NAME);
-            data.strSEO = query.getStringField(documentDOCUMENT_SEO);
-            data.strURL = query.getStringField(documentDOCUMENT_URL);
-            data.strAuthor = query.getStringField(documentDOCUMENT_AUTHOR);
-            data.strKeywords = query.getStringField(documentDOCUMENT_KEYWORDS);
-            data.strType = query.getStringField(documentDOCUMENT_TYPE);
-            data.strOwner = query.getStringField(documentDOCUMENT_OWNER);
-            data.strFileType = query.getStringField(documentDOCUMENT_FILE_TYPE);
-            data.strStyleGUID = query.getStringField(documentSTYLE_GUID);
-            data.tCreated = query.getTimeField(documentDT_CREATED);
-            data.tModified = query.getTimeField(documentDT_MODIFIED);
-            data.tAccessed = query.getTimeField(documentDT_ACCESSED);
-            data.nIconIndex = query.getIntField(documentDOCUMENT_ICON_INDEX);
-            data.nSync = query.getIntField(documentDOCUMENT_SYNC);
-            data.nProtected = query.getIntField(documentDOCUMENT_PROTECT);
-            data.nReadCount = query.getIntField(documentDOCUMENT_READ_COUNT);
-            data.nAttachmentCount = query.getIntField(documentDOCUMENT_ATTACHEMENT_COUNT);
-            data.nIndexed = query.getIntField(documentDOCUMENT_INDEXED);
-            data.tInfoModified = query.getTimeField(documentDT_INFO_MODIFIED);
-            data.strInfoMD5 = query.getStringField(documentDOCUMENT_INFO_MD5);
-            data.tDataModified = query.getTimeField(documentDT_DATA_MODIFIED);
-            data.strDataMD5 = query.getStringField(documentDOCUMENT_DATA_MD5);
-            data.tParamModified = query.getTimeField(documentDT_PARAM_MODIFIED);
-            data.strParamMD5 = query.getStringField(documentDOCUMENT_PARAM_MD5);
-            data.nVersion = query.getInt64Field(documentVersion);
+            QueryToDocumentData(query, data);
 
             arrayGUID.push_back(data.strGUID);
             arrayDocument.push_back(data);
@@ -996,6 +1345,8 @@ bool CWizIndexBase::CreateDocumentEx(const WIZDOCUMENTDATA& dataNew)
     if (!ExecSQL(strSQL))
         return false;
 
+    UpdateDocumentInfoFTS(data);
+
     if (!m_bUpdating) {
         emit documentCreated(data);
     }
@@ -1076,6 +1427,16 @@ bool CWizIndexBase::ModifyDocumentInfoEx(const WIZDOCUMENTDATA& dataCur)
     if (!ExecSQL(strSQL))
         return false;
 
+    if (data.strTitle != dataOld.strTitle
+            || data.strName != dataOld.strName
+            || data.strSEO != dataOld.strSEO
+            || data.strURL != dataOld.strURL
+            || data.strAuthor != dataOld.strAuthor
+            || data.strKeywords != dataOld.strKeywords
+            || data.strOwner != dataOld.strOwner) {
+        UpdateDocumentInfoFTS(data);
+    }
+
     WIZDOCUMENTDATA dataNew;
     DocumentFromGUID(data.strGUID, dataNew);
 
@@ -1099,6 +1460,9 @@ bool CWizIndexBase::DeleteDocumentEx(const WIZDOCUMENTDATA& data)
         STR2SQL(data.strGUID).utf16()
         );
 
+    // drop index entry of the document too
+    DeleteDocumentInfoFTS(data.strGUID);
+
     if (!ExecSQL(strSQL))
         return false;
 
@@ -1280,26 +1644,30 @@ bool CWizIndexBase::TagFromGUID(const CString& strTagGUID, WIZTAGDATA& data)
         return false;
     }
 
-    CString strWhere;
-    strWhere.Format(_T("TAG_GUID=%s"),
-        STR2SQL(strTagGUID).utf16()
-        );
+    CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_TAG, FIELD_LIST_WIZ_TAG, "TAG_GUID=?");
 
-    CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_TAG, FIELD_LIST_WIZ_TAG, strWhere);
+    QMutexLocker locker(&m_mutexStatement);
 
-    CWizTagDataArray arrayTag;
-    if (!SQLToTagDataArray(strSQL, arrayTag)) {
-        TOLOG(_T("Failed to get tag by guid"));
-        return false;
-    }
+    try
+    {
+        CppSQLite3Statement& stmt = Statement(strSQL);
+        stmt.bind(1, strTagGUID);
 
-    if (arrayTag.empty()) {
-        //TOLOG(_T("Failed to get tag by guid, result is empty"));
-        return false;
-    }
+        CppSQLite3Query query = stmt.execQuery();
+        if (query.eof()) {
+            //TOLOG(_T("Failed to get tag by guid, result is empty"));
+            return false;
+        }
 
-    data = arrayTag[0];
-    return true;
+        QueryToTagData(query, data);
+        stmt.reset();
+        return true;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        TOLOG(_T("Failed to get tag by guid"));
+        return LogSQLException(e, strSQL);
+    }
 }
 
 bool CWizIndexBase::GetStyles(CWizStyleDataArray& arrayStyle)
@@ -1378,22 +1746,50 @@ bool CWizIndexBase::DocumentFromGUID(const CString& strDocumentGUID, WIZDOCUMENT
         return false;
     }
 
-    CString strWhere;
-    strWhere.Format(_T("DOCUMENT_GUID=%s"),
-        STR2SQL(strDocumentGUID).utf16()
-        );
-
-    CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_DOCUMENT, FIELD_LIST_WIZ_DOCUMENT, strWhere);
+    CString strSQL = FormatQuerySQL(TABLE_NAME_WIZ_DOCUMENT, FIELD_LIST_WIZ_DOCUMENT, "DOCUMENT_GUID=?");
 
     CWizDocumentDataArray arrayDocument;
-    if (!SQLToDocumentDataArray(strSQL, arrayDocument)) {
-        TOLOG(_T("Failed to get document by guid"));
-        return false;
+
+    {
+        QMutexLocker locker(&m_mutexStatement);
+
+        try
+        {
+            CppSQLite3Statement& stmt = Statement(strSQL);
+            stmt.bind(1, strDocumentGUID);
+
+            CppSQLite3Query query = stmt.execQuery();
+            if (query.eof()) {
+                //TOLOG(_T("Failed to get document by guid, result is empty"));
+                return false;
+            }
+
+            WIZDOCUMENTDATA doc;
+            QueryToDocumentData(query, doc);
+            arrayDocument.push_back(doc);
+            stmt.reset();
+        }
+        catch (const CppSQLite3Exception& e)
+        {
+            TOLOG(_T("Failed to get document by guid"));
+            return LogSQLException(e, strSQL);
+        }
     }
 
-    if (arrayDocument.empty()) {
-        //TOLOG(_T("Failed to get document by guid, result is empty"));
-        return false;
+    // flags, rate and share flags live in other tables
+    try
+    {
+        CWizStdStringArray arrayGUID;
+        arrayGUID.push_back(arrayDocument[0].strGUID);
+
+        std::map<CString, int> mapDocumentIndex;
+        mapDocumentIndex[arrayDocument[0].strGUID] = 0;
+
+        InitDocumentExFields(arrayDocument, arrayGUID, mapDocumentIndex);
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        return LogSQLException(e, strSQL);
     }
 
     data = arrayDocument[0];
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QMetaType>
+#include <QMutex>
 
 #include "wizqthelper.h"
 #include "cppsqlite3.h"
@@ -30,10 +31,23 @@ public:
     bool GetFirstRowFieldValue(const CString& strSQL, int nFieldIndex, CString& strValue);
     bool Repair(const QString& strDestFileName);
 
+    // savepoint based transaction, can be nested. writes between begin and
+    // commit are written to disk at once, rollback only undo writes made
+    // since the matching begin. note: connection is shared by all threads
+    bool BeginTransaction();
+    bool CommitTransaction();
+    bool RollbackTransaction();
+
     QString kbGUID() const { return m_strKbGUID; }
     void setKbGUID(const QString& guid) { m_strKbGUID = guid; }
 
     QString GetDatabasePath() const { return m_strFileName; }
+
+    // document info full text index, used by title and info search instead
+    // of like '%keyword%'. return empty string if fts is not available
+    bool IsDocumentInfoFTSAvailable() const { return m_bDocumentInfoFTS; }
+    CString DocumentInfoFTSToSQL(const CString& strKeywords,
+                                 const CString& strField = CString()) const;
     virtual QString GetDefaultNoteLocation() const { return LOCATION_DEFAULT; }
 
     /* Raw query*/
@@ -84,14 +98,47 @@ public:
 protected:
     CppSQLite3DB m_db;
 
+    // compiled statements shared by all threads, lock this mutex from
+    // Statement() until the statement has been reset
+    QMutex m_mutexStatement;
+
+    // connection is shared by all threads, writers take this mutex and
+    // an open transaction holds it until commit or rollback. always lock
+    // it before m_mutexStatement
+    QMutex m_mutexTransaction;
+
 private:
     QString m_strFileName;
     QString m_strKbGUID;
     bool m_bUpdating;
+    int m_nTransactionDepth;
+    bool m_bDocumentInfoFTS;
+
+    // sql text => compiled statement, finalized before database closed
+    std::map<CString, CppSQLite3Statement*> m_mapStatement;
+
+    void ClearStatements();
 
 protected:
     bool LogSQLException(const CppSQLite3Exception& e, const CString& strSQL);
 
+    // return cached statement of strSQL, compile it at first use. statement
+    // is reset and ready for binding, throw CppSQLite3Exception if failed
+    CppSQLite3Statement& Statement(const CString& strSQL);
+
+    // fts index of document info is maintained here instead of triggers,
+    // cjk text is split into single chars before writing to it
+    bool InitDocumentInfoFTS();
+    bool RebuildDocumentInfoFTS();
+    bool UpdateDocumentInfoFTS(const WIZDOCUMENTDATA& data);
+    bool DeleteDocumentInfoFTS(const CString& strDocumentGUID);
+    bool PurgeDocumentInfoFTS();
+    // count and latest modified times of documents, saved when closed, so
+    // that changes made by old versions are detected at next open
+    CString DocumentInfoFTSState();
+    bool SaveDocumentInfoFTSState();
+    static QString DocumentInfoFTSText(const QString& strText);
+
     void BeginUpdate() { m_bUpdating = true; }
     void EndUpdate() { m_bUpdating = false; }
     bool IsUpdating() const { return m_bUpdating; }
@@ -150,6 +197,7 @@ protected:
     /* Basic operations */
     bool SQLToSize(const CString& strSQL, int& size);
 
+    void QueryToTagData(CppSQLite3Query& query, WIZTAGDATA& data);
     bool SQLToTagDataArray(const CString& strSQL,
                            CWizTagDataArray& arrayTag);
 
@@ -168,6 +216,7 @@ protected:
     bool SQLToDocumentParamDataArray(const CString& strSQL,
                                      CWizDocumentParamDataArray& arrayParam);
 
+    void QueryToDocumentData(CppSQLite3Query& query, WIZDOCUMENTDATA& data);
     bool SQLToDocumentDataArray(const CString& strSQL,
                                 CWizDocumentDataArray& arrayDocument);
 
@@ -388,6 +437,16 @@ enum FieldIndex_WizDocument
         documentVersion
 };
 
+/* ------------------------- WIZ_DOCUMENT_INFO_FTS ------------------------- */
+// fts4 table, DOCUMENT_GUID is indexed too, so match columns explicitly
+#define TABLE_NAME_WIZ_DOCUMENT_INFO_FTS "WIZ_DOCUMENT_INFO_FTS"
+
+#define FIELD_LIST_WIZ_DOCUMENT_INFO_FTS "\
+DOCUMENT_TITLE, DOCUMENT_NAME, DOCUMENT_SEO, DOCUMENT_URL, DOCUMENT_AUTHOR, \
+DOCUMENT_KEYWORDS, DOCUMENT_OWNER"
+
+#define FIELD_COUNT_WIZ_DOCUMENT_INFO_FTS 7
+
 /* ------------------------ WIZ_DOCUMENT_ATTACHMENT ------------------------ */
 #define TABLE_NAME_WIZ_DOCUMENT_ATTACHMENT  "WIZ_DOCUMENT_ATTACHMENT"
 
@@ -528,8 +587,28 @@ enum FieldIndex_WizUser
 };
 
 
+/* ----------------------------- WIZ_FILE_MD5 ----------------------------- */
+// md5 of local files, valid while size, modified time and inode are the same
+#define TABLE_NAME_WIZ_FILE_MD5 "WIZ_FILE_MD5"
+#define FIELD_LIST_WIZ_FILE_MD5 "\
+FILE_NAME, FILE_SIZE, FILE_MODIFIED, FILE_INODE, FILE_MD5"
+
+
+/* ------------------------------- WIZ_BLOB ------------------------------- */
+// local store of note resources and attachments, named by md5 of content
+#define TABLE_NAME_WIZ_BLOB "WIZ_BLOB"
+#define FIELD_LIST_WIZ_BLOB "BLOB_MD5, BLOB_SIZE, BLOB_REF_COUNT"
+
+/* ---------------------------- WIZ_OBJECT_BLOB ---------------------------- */
+// blob used by resource of note or by attachment, valid while data md5 of
+// the object is OBJECT_DATA_MD5
+#define TABLE_NAME_WIZ_OBJECT_BLOB "WIZ_OBJECT_BLOB"
+#define FIELD_LIST_WIZ_OBJECT_BLOB "\
+OBJECT_GUID, BLOB_NAME, OBJECT_DATA_MD5, BLOB_MD5"
+
+
 /* --------------------------------- TOTAL --------------------------------- */
-#define TABLE_COUNT 11
+#define TABLE_COUNT 14
 
 const QString g_arrayTableName[TABLE_COUNT] =
 {
@@ -543,7 +622,10 @@ const QString g_arrayTableName[TABLE_COUNT] =
     TABLE_NAME_WIZ_META,
     TABLE_NAME_WIZ_OBJECT_EX,
     TABLE_NAME_WIZ_MESSAGE,
-    TABLE_NAME_WIZ_USER
+    TABLE_NAME_WIZ_USER,
+    TABLE_NAME_WIZ_FILE_MD5,
+    TABLE_NAME_WIZ_BLOB,
+    TABLE_NAME_WIZ_OBJECT_BLOB
 };
 
 
@@ -3,6 +3,7 @@
 #include <QDebug>
 #include <QEventLoop>
 #include <QNetworkAccessManager>
+#include <QTimer>
 #include "utils/pathresolve.h"
 
 #include "wizDatabaseManager.h"
@@ -109,6 +110,7 @@ void CWizDownloadObjectRunnable::on_downloadProgress(int totalSize, int loadedSi
 CWizFileDownloader::CWizFileDownloader(const QString& strUrl, const QString& strFileName, const QString& strPath)
     : m_strUrl(strUrl)
     , m_strFileName(strFileName)
+    , m_nTimeout(0)
 {
     if (m_strFileName.isEmpty())
     {
@@ -143,8 +145,17 @@ bool CWizFileDownloader::download()
      QEventLoop loop;
      loop.connect(&m_WebCtrl, SIGNAL(finished(QNetworkReply*)), SLOT(quit()));
      QNetworkReply* reply = m_WebCtrl.get(request);
+     if (m_nTimeout > 0) {
+         QTimer::singleShot(m_nTimeout, &loop, SLOT(quit()));
+     }
      loop.exec();
 
+     if (!reply->isFinished()) {
+         qDebug() << "[Download] timeout: " << m_strUrl;
+         reply->abort();
+         return false;
+     }
+
      QByteArray byData = reply->readAll();
      QFile file(m_strFileName);
      if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
@@ -67,12 +67,16 @@ public:
     virtual void run();
     void startDownload();
 
+    // abort if not finished in nMsecs after download started, 0 for no limit
+    void setTimeout(int nMsecs) { m_nTimeout = nMsecs; }
+
 signals:
     void downloadDone(QString strFileName, bool bSucceed);
 
 private:
     QString m_strUrl;
     QString m_strFileName;
+    int m_nTimeout;
 
     bool download();
 };
@@ -2,6 +2,10 @@
 
 #include <QFile>
 #include <QMetaType>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QTime>
 #include <QDebug>
 #include <QCoreApplication>
 
@@ -11,20 +15,190 @@
 #include "wizmisc.h"
 #include "html/wizhtmlcollector.h"
 #include "wizDatabase.h"
+#include "wizsettings.h"
 #include "utils/logger.h"
-#include "utils/pathresolve.h"
+
+#define WIZNOTE_FTS_CPU_BUDGET 50
+
+// since this version every note is indexed once by the combined cjk analyzer
+#define WIZNOTE_FTS_SINGLE_DOCUMENT_VERSION 6
+
+
+/* ------------------------ text extraction pipeline ------------------------ */
+struct WIZFTSTEXTDATA
+{
+    WIZDOCUMENTDATAEX doc;
+    QString strText;
+    bool bSucceeded;
+
+    WIZFTSTEXTDATA() : bSucceeded(false) {}
+};
+
+// bounded queue feeding the single lucene writer from text extractors
+class CWizSearchTextQueue
+{
+public:
+    CWizSearchTextQueue(int nMaxSize, int nProducers)
+        : m_nMaxSize(nMaxSize)
+        , m_nProducers(nProducers)
+        , m_bAbort(false)
+    {
+    }
+
+    // block while queue is full, return false if aborted
+    bool push(const WIZFTSTEXTDATA& data)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_bAbort && int(m_queue.size()) >= m_nMaxSize) {
+            m_notFull.wait(&m_mutex);
+        }
+
+        if (m_bAbort)
+            return false;
+
+        m_queue.push_back(data);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    // block while queue is empty, return false if all producers are done
+    bool pop(WIZFTSTEXTDATA& data)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_bAbort && m_queue.empty() && m_nProducers > 0) {
+            m_notEmpty.wait(&m_mutex);
+        }
+
+        if (m_bAbort || m_queue.empty())
+            return false;
+
+        data = m_queue.front();
+        m_queue.pop_front();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    void producerDone()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_nProducers--;
+        m_notEmpty.wakeAll();
+    }
+
+    void abort()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_bAbort = true;
+        m_notFull.wakeAll();
+        m_notEmpty.wakeAll();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_notFull;
+    QWaitCondition m_notEmpty;
+    std::deque<WIZFTSTEXTDATA> m_queue;
+    int m_nMaxSize;
+    int m_nProducers;
+    bool m_bAbort;
+};
+
+// keep the calling thread within nBudget percent of one core, sleep is
+// proportional to the work done and batched to avoid lots of tiny naps
+class CWizSearchCpuBudget
+{
+public:
+    CWizSearchCpuBudget(int nBudget)
+        : m_nBudget(qBound(1, nBudget, 100))
+        , m_nDebt(0)
+    {
+    }
+
+    void begin()
+    {
+        m_timer.start();
+    }
+
+    void end()
+    {
+        if (m_nBudget >= 100)
+            return;
+
+        m_nDebt += m_timer.elapsed() * (100 - m_nBudget) / m_nBudget;
+        if (m_nDebt >= 50) {
+            ::WizMSleep(m_nDebt);
+            m_nDebt = 0;
+        }
+    }
+
+private:
+    int m_nBudget;
+    int m_nDebt;
+    QTime m_timer;
+};
+
+// unzip, strip html and lower case notes on a worker thread
+class CWizSearchTextExtractor : public QRunnable
+{
+public:
+    CWizSearchTextExtractor(CWizSearchIndexer& indexer,
+                            const CWizDocumentDataArray& arrayDocument,
+                            QAtomicInt& nNext,
+                            CWizSearchTextQueue& queue)
+        : m_indexer(indexer)
+        , m_arrayDocument(arrayDocument)
+        , m_nNext(nNext)
+        , m_queue(queue)
+    {
+    }
+
+    virtual void run()
+    {
+        CWizSearchCpuBudget budget(m_indexer.m_nCpuBudget);
+
+        int nTotal = m_arrayDocument.size();
+        while (!m_indexer.isStopped()) {
+            int i = m_nNext.fetchAndAddOrdered(1);
+            if (i >= nTotal)
+                break;
+
+            budget.begin();
+            WIZFTSTEXTDATA data;
+            data.doc = m_arrayDocument.at(i);
+            data.bSucceeded = m_indexer.extractDocumentText(data.doc, data.strText);
+            budget.end();
+
+            if (!m_queue.push(data))
+                break;
+        }
+
+        m_queue.producerDone();
+    }
+
+private:
+    CWizSearchIndexer& m_indexer;
+    const CWizDocumentDataArray& m_arrayDocument;
+    QAtomicInt& m_nNext;
+    CWizSearchTextQueue& m_queue;
+};
+
 
 
 CWizSearchIndexer::CWizSearchIndexer(CWizDatabaseManager& dbMgr, QObject *parent)
     : QThread(parent)
     , m_dbMgr(dbMgr)
-    , m_stop(false)
+    , m_stop(0)
     , m_buldNow(false)
+    , m_bBlobsScanned(false)
+    , m_pSessionHandle(NULL)
+    , m_nCpuBudget(WIZNOTE_FTS_CPU_BUDGET)
 {
     qRegisterMetaType<WIZDOCUMENTDATAEX>("WIZDOCUMENTDATAEX");
 
     m_strIndexPath = m_dbMgr.db().GetAccountPath() + "fts_index";
 
+    loadSessionOptions();
+
     // signals for deletion, database responsible for reset FTS flag when update document or attachment.
     connect(&m_dbMgr, SIGNAL(documentDeleted(const WIZDOCUMENTDATA&)), \
             SLOT(on_document_deleted(const WIZDOCUMENTDATA&)));
@@ -32,6 +206,32 @@ CWizSearchIndexer::CWizSearchIndexer(CWizDatabaseManager& dbMgr, QObject *parent
             SLOT(on_attachment_deleted(const WIZDOCUMENTATTACHMENTDATA&)));
 }
 
+void CWizSearchIndexer::loadSessionOptions()
+{
+    CWizUserSettings settings(m_dbMgr.db());
+
+    bool ok = false;
+    int nDocuments = settings.get("FTSCommitDocuments").toInt(&ok);
+    if (ok) {
+        m_sessionOptions.nCommitDocuments = nDocuments;
+    }
+
+    qint64 nBytes = settings.get("FTSCommitBytes").toLongLong(&ok);
+    if (ok) {
+        m_sessionOptions.nCommitBytes = nBytes;
+    }
+
+    int nSegments = settings.get("FTSMaxSegments").toInt(&ok);
+    if (ok) {
+        m_sessionOptions.nMaxSegments = nSegments;
+    }
+
+    int nCpuBudget = settings.get("FTSCpuBudget").toInt(&ok);
+    if (ok) {
+        m_nCpuBudget = nCpuBudget;
+    }
+}
+
 void CWizSearchIndexer::rebuild() {
     if (!QMetaObject::invokeMethod(this, "rebuildFTSIndex")) {
         qDebug() << "\nInvoke rebuildFTSIndex failed\n";
@@ -43,15 +243,18 @@ void CWizSearchIndexer::run()
     int idleCounter = 0;
     while (1)
     {
-        if (idleCounter >= 60 || m_buldNow || m_stop)
+        if (idleCounter >= 60 || m_buldNow || isStopped())
         {
-            if (m_stop)
+            if (isStopped())
                 return;
 
             idleCounter = 0;
             //
             buildFTSIndex();
 
+            if (!isStopped())
+                compactBlobs();
+
         }
         else
         {
@@ -68,11 +271,34 @@ void CWizSearchIndexer::waitForDone()
     WizWaitForThread(this);
 }
 
+void CWizSearchIndexer::compactBlobs()
+{
+    // unused blobs are cheap to query, scan files only once per session
+    m_dbMgr.db().CompactBlobs(!m_bBlobsScanned);
+
+    int total = m_dbMgr.count();
+    for (int i = 0; i < total; i++) {
+        if (isStopped())
+            return;
+
+        m_dbMgr.at(i).CompactBlobs(!m_bBlobsScanned);
+    }
+
+    m_bBlobsScanned = true;
+}
+
 bool CWizSearchIndexer::buildFTSIndex()
 {
-    m_stop = false;
+    m_stop.fetchAndStoreOrdered(0);
     int nErrors = 0;
 
+    // old index holds two documents per note, start from scratch rather than
+    // search through stale documents until all notes are indexed again
+    if (m_dbMgr.db().getDocumentFTSVersion().toInt() < WIZNOTE_FTS_SINGLE_DOCUMENT_VERSION) {
+        qDebug() << "FTS index layout changed, clear old index...";
+        clearAllFTSData();
+    }
+
     // build private first
     if (!buildFTSIndexByDatabase(m_dbMgr.db())) {
         nErrors++;
@@ -81,7 +307,7 @@ bool CWizSearchIndexer::buildFTSIndex()
     // build group db
     int total = m_dbMgr.count();
     for (int i = 0; i < total; i++) {
-        if (m_stop)
+        if (isStopped())
             break;
 
         if (!buildFTSIndexByDatabase(m_dbMgr.at(i))) {
@@ -118,25 +344,83 @@ bool CWizSearchIndexer::buildFTSIndexByDatabase(CWizDatabase& db)
     if (arrayDocuments.empty())
         return true;
 
+    void* pHandle = NULL;
+    if (!beginUpdateDocument(m_strIndexPath.toStdWString().c_str(), &pHandle, m_sessionOptions)) {
+        TOLOG("begin update failed while update FTS index");
+        return false;
+    }
+
+    m_mutexSession.lock();
+    m_pSessionHandle = pHandle;
+    m_mutexSession.unlock();
+
+    // extractors run on a pool sized to core count, this thread owns the writer
+    int nThreads = qMax(1, QThread::idealThreadCount());
+    CWizSearchTextQueue queue(nThreads * 4, nThreads);
+    QAtomicInt nNext(0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(nThreads);
+    for (int i = 0; i < nThreads; i++) {
+        pool.start(new CWizSearchTextExtractor(*this, arrayDocuments, nNext, queue));
+    }
+
+    CWizSearchCpuBudget budget(m_nCpuBudget);
+
     int nErrors = 0;
     int nTotal = arrayDocuments.size();
-    for (int i = 0; i < nTotal; i++) {
-        if (m_stop) {
+    int nIndexed = 0;
+    QStringList listIndexed;    // added to writer, not committed yet
+    WIZFTSTEXTDATA data;
+    while (queue.pop(data)) {
+        if (isStopped()) {
             break;
         }
 
-        const WIZDOCUMENTDATAEX& doc = arrayDocuments.at(i);
+        const WIZDOCUMENTDATAEX& doc = data.doc;
+
+        TOLOG(tr("Update search index (%1/%2): %3").arg(++nIndexed).arg(nTotal).arg(doc.strTitle));
 
-        TOLOG(tr("Update search index (%1/%2): %3").arg(i + 1).arg(nTotal).arg(doc.strTitle));
-        if (!updateDocument(doc)) {
+        bool ret = data.bSucceeded;
+        if (ret) {
+            budget.begin();
+            m_mutexSession.lock();
+            ret = _indexDocumentText(pHandle, doc, data.strText);
+            bool bCommitted = pendingUpdateDocuments(pHandle) == 0;
+            m_mutexSession.unlock();
+
+            if (ret) {
+                listIndexed.append(doc.strGUID);
+            }
+
+            if (bCommitted) {
+                setDocumentsIndexed(db, listIndexed);
+            }
+            budget.end();
+        }
+
+        if (!ret) {
             TOLOG(tr("[WARNING] failed to update: %1").arg(doc.strTitle));
             nErrors++;
         }
+    }
+
+    queue.abort();
+    pool.waitForDone();
 
-        // release CPU
-        msleep(100);
+    m_mutexSession.lock();
+    m_pSessionHandle = NULL;
+    bool bEnd = endUpdateDocument(pHandle);
+    m_mutexSession.unlock();
+
+    // notes not committed are indexed again next time
+    if (!bEnd) {
+        TOLOG("end update failed while update FTS index");
+        return false;
     }
 
+    setDocumentsIndexed(db, listIndexed);
+
     if (nErrors >= 3) {
         TOLOG(tr("[WARNING] total %1 notes failed to build").arg(nErrors));
         return false;
@@ -165,68 +449,58 @@ void CWizSearchIndexer::filterDocuments(CWizDatabase& db, CWizDocumentDataArray&
     }
 }
 
-bool CWizSearchIndexer::updateDocument(const WIZDOCUMENTDATAEX& doc)
-{
-    Q_ASSERT(!doc.strGUID.isEmpty());
-
-    void* pHandle = NULL;
-
-    if (!beginUpdateDocument(m_strIndexPath.toStdWString().c_str(), &pHandle)) {
-        TOLOG("begin update failed while update FTS index");
-        return false;
-    }
-
-    bool ret = _updateDocumentImpl(pHandle, doc);
-
-    if (!endUpdateDocument(pHandle)) {
-        TOLOG("end update failed while update FTS index");
-        return false;
-    }
-
-    return ret;
-}
-
-bool CWizSearchIndexer::_updateDocumentImpl(void *pHandle,
-                                            const WIZDOCUMENTDATAEX& doc)
+bool CWizSearchIndexer::extractDocumentText(const WIZDOCUMENTDATAEX& doc,
+                                            QString& strPlainText)
 {
     CWizDatabase& db = m_dbMgr.db(doc.strKbGUID);
 
-    // decompress
-    QString strTempFolder = Utils::PathResolve::tempPath() + doc.strGUID + "-update/";
-    if (!db.DocumentToHtmlFile(doc, strTempFolder, "sindex.html")) {
-        TOLOG("Can't decompress document while update FTS index: " + doc.strTitle);
-        //Q_ASSERT(0);
-        return false;
-    }
-    QString strDataFile = strTempFolder + "sindex.html";
-
-    // get plain text content
+    // read html straight out of the note archive
     QString strHtmlData;
-    if (!::WizLoadUnicodeTextFromFile(strDataFile, strHtmlData)) {
+    if (!db.DocumentToHtmlData(doc, strHtmlData)) {
         TOLOG("Can't load document data while update FTS index:" + doc.strTitle);
         return false;
     }
 
-    QString strPlainText;
     CWizHtmlToPlainText htmlConverter;
     htmlConverter.toText(strHtmlData, strPlainText);
+    strPlainText = strPlainText.toLower();
 
+    return true;
+}
+
+bool CWizSearchIndexer::_indexDocumentText(void *pHandle,
+                                           const WIZDOCUMENTDATAEX& doc,
+                                           const QString& strPlainText)
+{
     bool ret = false;
     if (!strPlainText.isEmpty()) {
         ret = IWizCluceneSearch::updateDocument(pHandle,
                                                 doc.strKbGUID.toStdWString().c_str(),
                                                 doc.strGUID.toStdWString().c_str(),
                                                 doc.strTitle.toLower().toStdWString().c_str(),
-                                                strPlainText.toLower().toStdWString().c_str());
+                                                strPlainText.toStdWString().c_str());
     } else {
         ret = true;
     }
 
-    if (ret) {
-        db.setDocumentSearchIndexed(doc.strGUID, true);
+    return ret;
+}
+
+void CWizSearchIndexer::setDocumentsIndexed(CWizDatabase& db, QStringList& listGUID)
+{
+    if (listGUID.isEmpty())
+        return;
+
+    bool bTransaction = db.BeginTransaction();
+    foreach (const QString& strGUID, listGUID) {
+        db.setDocumentSearchIndexed(strGUID, true);
+    }
+
+    if (bTransaction) {
+        db.CommitTransaction();
     }
 
-    return ret;
+    listGUID.clear();
 }
 
 bool CWizSearchIndexer::deleteDocument(const WIZDOCUMENTDATAEX& doc)
@@ -235,6 +509,13 @@ bool CWizSearchIndexer::deleteDocument(const WIZDOCUMENTDATAEX& doc)
 
     qDebug() << "\nDocument FTS deleted: " << doc.strTitle << "\n";
 
+    // indexing session is running, writer owns the index lock
+    QMutexLocker locker(&m_mutexSession);
+    if (m_pSessionHandle) {
+        return IWizCluceneSearch::deleteDocument(m_pSessionHandle,
+                                                 doc.strGUID.toStdWString().c_str());
+    }
+
     return IWizCluceneSearch::deleteDocument(m_strIndexPath.toStdWString().c_str(),
                                              doc.strGUID.toStdWString().c_str());
 }
@@ -262,7 +543,13 @@ void CWizSearchIndexer::clearFlags(CWizDatabase& db)
 
 void CWizSearchIndexer::stop()
 {
-    m_stop = true;
+    m_stop.fetchAndStoreOrdered(1);
+}
+
+bool CWizSearchIndexer::isStopped()
+{
+    // same on qt4 and qt5, which differ in plain load of atomics
+    return m_stop.fetchAndAddOrdered(0) != 0;
 }
 
 bool CWizSearchIndexer::clearAllFTSData()
@@ -294,31 +581,64 @@ void CWizSearchIndexer::on_attachment_deleted(const WIZDOCUMENTATTACHMENTDATA& a
 
 
 #define SEARCH_PAGE_MAX 100
+#define SEARCH_FTS_PAGE_DEFAULT 500
 
 
 /* ----------------------------- CWizSearcher ----------------------------- */
 CWizSearcher::CWizSearcher(CWizDatabaseManager& dbMgr, QObject *parent)
     : QThread(parent)
     , m_dbMgr(dbMgr)
-    , m_mutexWait(QMutex::NonRecursive)
+    , m_nMaxResult(-1)
+    , m_bSearchMore(false)
+    , m_pSearchHandle(NULL)
     , m_stop(false)
+    , m_mutexWait(QMutex::NonRecursive)
+    , m_nResults(0)
+    , m_nPageSize(SEARCH_FTS_PAGE_DEFAULT)
+    , m_nFtsStart(0)
+    , m_nFtsTotal(-1)
 {
     m_strIndexPath = m_dbMgr.db().GetAccountPath() + "fts_index";
     qRegisterMetaType<CWizDocumentDataArray>("CWizDocumentDataArray");
 }
 
+CWizSearcher::~CWizSearcher()
+{
+    if (m_pSearchHandle) {
+        endSearchDocument(m_pSearchHandle);
+    }
+}
+
 void CWizSearcher::search(const QString &strKeywords, int nMaxSize /* = -1 */)
 {
     m_mutexWait.lock();
     m_strkeywords = strKeywords;
     m_nMaxResult = nMaxSize;
+    // page of last search is useless now
+    m_bSearchMore = false;
+    m_wait.wakeAll();
+    m_mutexWait.unlock();
+
+}
+
+void CWizSearcher::searchMore()
+{
+    // handled by run() on searcher thread, like search()
+    m_mutexWait.lock();
+    m_bSearchMore = true;
     m_wait.wakeAll();
     m_mutexWait.unlock();
+}
 
+bool CWizSearcher::isSearchPending()
+{
+    QMutexLocker lock(&m_mutexWait);
+    return !m_strkeywords.isEmpty();
 }
 
 void CWizSearcher::stop()
 {
+    QMutexLocker lock(&m_mutexWait);
     m_stop = true;
     m_wait.wakeAll();
 }
@@ -330,21 +650,18 @@ void CWizSearcher::waitForDone()
     WizWaitForThread(this);
 }
 
-void CWizSearcher::doSearch()
-{
-    m_mapDocumentSearched.clear();
-    m_nResults = 0;
-
-    if (!QMetaObject::invokeMethod(this, "searchKeyword",
-                                   Q_ARG(const QString&, m_strkeywords))) {
-        qDebug() << "\nInvoke searchKeyword failed\n";
-    }
-}
-
-void CWizSearcher::searchKeyword(const QString& strKeywords)
+void CWizSearcher::searchKeyword(const QString& strKeywords, int nMaxResult)
 {
     Q_ASSERT(!strKeywords.isEmpty());
 
+    m_arrayDocumentSearched.clear();
+    m_setDocumentSearched.clear();
+    m_nResults = 0;
+    m_strSearchedKeywords = strKeywords;
+    m_nPageSize = nMaxResult > 0 ? nMaxResult : SEARCH_FTS_PAGE_DEFAULT;
+    m_nFtsStart = 0;
+    m_nFtsTotal = -1;
+
     QTime counter;
     counter.start();
 
@@ -352,43 +669,82 @@ void CWizSearcher::searchKeyword(const QString& strKeywords)
 
     searchDatabase(strKeywords);
 
-    if (m_nResults < m_nMaxResult)
-    {
-        // NOTE: make sure convert keyword to lower case
-        searchDocument(m_strIndexPath.toStdWString().c_str(),
-                       strKeywords.toLower().toStdWString().c_str());
+    // title matches come first, fill the rest of first page with best full text hits
+    if (m_nResults < m_nPageSize) {
+        searchFullText(strKeywords, m_nPageSize - m_nResults);
     }
 
     int nMilliseconds = counter.elapsed();
     qDebug() << "[Search]search times: " << nMilliseconds;
 
-    int nTimes = m_mapDocumentSearched.size() % SEARCH_PAGE_MAX ?
-                (m_mapDocumentSearched.size() / SEARCH_PAGE_MAX) + 1: (m_mapDocumentSearched.size() / SEARCH_PAGE_MAX);
-    int nPos = 0;
-    for (int i = 0; i < nTimes; i++) {
+    emitSearchResult(strKeywords, 0);
+}
+
+void CWizSearcher::searchKeywordMore()
+{
+    if (m_strSearchedKeywords.isEmpty())
+        return;
+
+    if (m_nFtsTotal != -1 && m_nFtsStart >= m_nFtsTotal)
+        return;
+
+    int nFrom = m_arrayDocumentSearched.size();
+    searchFullText(m_strSearchedKeywords, m_nPageSize);
+
+    // nothing new on this page, do not touch list view
+    if (nFrom == (int)m_arrayDocumentSearched.size())
+        return;
 
+    emitSearchResult(m_strSearchedKeywords, nFrom);
+}
+
+void CWizSearcher::searchFullText(const QString& strKeywords, int nCount)
+{
+    if (!m_pSearchHandle) {
+        beginSearchDocument(m_strIndexPath.toStdWString().c_str(), &m_pSearchHandle);
+    }
+
+    // NOTE: make sure convert keyword to lower case
+    int nTotalHits = 0;
+    if (!searchDocument(m_pSearchHandle, strKeywords.toLower().toStdWString().c_str(),
+                        m_nFtsStart, nCount, nTotalHits)) {
+        m_nFtsTotal = m_nFtsStart;
+        return;
+    }
+
+    m_nFtsStart += nCount;
+    m_nFtsTotal = nTotalHits;
+}
+
+void CWizSearcher::emitSearchResult(const QString& strKeywords, int nFrom)
+{
+    int nTotal = m_arrayDocumentSearched.size();
+    if (nFrom >= nTotal) {
         CWizDocumentDataArray arrayDocument;
-        QMap<QString, WIZDOCUMENTDATAEX>::const_iterator it;
-        for (it = m_mapDocumentSearched.begin() + nPos; it != m_mapDocumentSearched.end(); it++) {
-            arrayDocument.push_back(it.value());
-            nPos++;
-        }
+        Q_EMIT searchProcess(strKeywords, arrayDocument, true);
+        return;
+    }
 
-        if (i == nTimes - 1) {
+    for (int nPos = nFrom; nPos < nTotal; nPos += SEARCH_PAGE_MAX) {
+        int nEnd = qMin(nPos + SEARCH_PAGE_MAX, nTotal);
+
+        CWizDocumentDataArray arrayDocument(m_arrayDocumentSearched.begin() + nPos,
+                                            m_arrayDocumentSearched.begin() + nEnd);
+
+        if (nEnd == nTotal) {
             Q_EMIT searchProcess(strKeywords, arrayDocument, true);
             return;
-        } else {
-            Q_EMIT searchProcess(strKeywords, arrayDocument, false);
         }
 
-        QTime dieTime = QTime::currentTime().addMSecs(30);
-        while (QTime::currentTime() < dieTime) {
-            QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
-        }
-    }
+        Q_EMIT searchProcess(strKeywords, arrayDocument, false);
 
-    CWizDocumentDataArray arrayDocument;
-    Q_EMIT searchProcess(strKeywords, arrayDocument, true);
+        // give list view time to draw
+        msleep(30);
+
+        // new search started meanwhile
+        if (isSearchPending())
+            return;
+    }
 }
 
 void CWizSearcher::searchDatabase(const QString& strKeywords)
@@ -400,7 +756,11 @@ void CWizSearcher::searchDatabase(const QString& strKeywords)
     for (it = arrayDocument.begin(); it != arrayDocument.end(); it++) {
 
         const WIZDOCUMENTDATAEX& doc = *it;
-        m_mapDocumentSearched[doc.strGUID] = doc;
+        if (m_setDocumentSearched.contains(doc.strGUID))
+            continue;
+
+        m_setDocumentSearched.insert(doc.strGUID);
+        m_arrayDocumentSearched.push_back(doc);
         m_nResults++;
     }
 
@@ -412,14 +772,18 @@ void CWizSearcher::searchDatabase(const QString& strKeywords)
 
         for (it = arrayDocument.begin(); it != arrayDocument.end(); it++) {
             const WIZDOCUMENTDATAEX& doc = *it;
-            m_mapDocumentSearched[doc.strGUID] = doc;
+            if (m_setDocumentSearched.contains(doc.strGUID))
+                continue;
+
+            m_setDocumentSearched.insert(doc.strGUID);
+            m_arrayDocumentSearched.push_back(doc);
             m_nResults++;
         }
 
         arrayDocument.clear();
     }
 
-    qDebug() << QString("[Search]Find %1 results in database").arg(m_mapDocumentSearched.size());
+    qDebug() << QString("[Search]Find %1 results in database").arg(m_arrayDocumentSearched.size());
 }
 
 bool CWizSearcher::onSearchProcess(const wchar_t* lpszKbGUID,
@@ -428,16 +792,11 @@ bool CWizSearcher::onSearchProcess(const wchar_t* lpszKbGUID,
 {
     Q_UNUSED(lpszURL);
 
-    if (m_nMaxResult != -1 && m_nMaxResult <= m_nResults) {
-        qDebug() << "\nSearch result is bigger than limits: " << m_nMaxResult;
-        return true;
-    }
-
     QString strKbGUID = QString::fromStdWString(lpszKbGUID);
     QString strGUID = QString::fromStdWString(lpszDocumentID);
 
     // not searched before
-    if (m_mapDocumentSearched.contains(strGUID)) {
+    if (m_setDocumentSearched.contains(strGUID)) {
         return true;
     }
 
@@ -455,7 +814,8 @@ bool CWizSearcher::onSearchProcess(const wchar_t* lpszKbGUID,
     }
 
     m_nResults++;
-    m_mapDocumentSearched[strGUID] = doc;
+    m_setDocumentSearched.insert(strGUID);
+    m_arrayDocumentSearched.push_back(doc);
 
     return true;
 }
@@ -469,21 +829,32 @@ bool CWizSearcher::onSearchEnd()
 void CWizSearcher::run()
 {
     QString strKeyWord;
+    int nMaxResult;
+    bool bSearchMore;
     while (!m_stop)
     {
         //////
         {
             QMutexLocker lock(&m_mutexWait);
-            m_wait.wait(&m_mutexWait);
+            // request may be posted while searching
+            if (m_strkeywords.isEmpty() && !m_bSearchMore && !m_stop)
+                m_wait.wait(&m_mutexWait);
             if (m_stop)
                 return;
 
             strKeyWord = m_strkeywords;
+            nMaxResult = m_nMaxResult;
+            bSearchMore = m_bSearchMore;
+
+            m_strkeywords.clear();
+            m_bSearchMore = false;
         }
         //
-        //
+        // all searching happens on this thread
         if (!strKeyWord.isEmpty()) {
-            doSearch();
+            searchKeyword(strKeyWord, nMaxResult);
+        } else if (bSearchMore) {
+            searchKeywordMore();
         }
     }
 }
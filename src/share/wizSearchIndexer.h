@@ -3,9 +3,13 @@
 
 #include <QTimer>
 #include <QMap>
+#include <QSet>
+#include <QStringList>
 #include <QThread>
 #include  <deque>
 #include <QWaitCondition>
+#include <QMutex>
+#include <QAtomicInt>
 
 #include "wizClucene.h"
 #include "wizDatabaseManager.h"
@@ -33,22 +37,45 @@ private:
     bool buildFTSIndex();
     bool buildFTSIndexByDatabase(CWizDatabase& db);
     void filterDocuments(CWizDatabase& db, CWizDocumentDataArray& arrayDocument);
-    bool updateDocument(const WIZDOCUMENTDATAEX& doc);
     bool deleteDocument(const WIZDOCUMENTDATAEX& doc);
 
-    bool _updateDocumentImpl(void *pHandle, const WIZDOCUMENTDATAEX& doc);
+    bool _indexDocumentText(void *pHandle, const WIZDOCUMENTDATAEX& doc, const QString& strPlainText);
+    // flag notes as indexed only after the writer committed them
+    void setDocumentsIndexed(CWizDatabase& db, QStringList& listGUID);
+
+    // called from extractor threads
+    bool extractDocumentText(const WIZDOCUMENTDATAEX& doc, QString& strPlainText);
+
+    void loadSessionOptions();
 
     Q_INVOKABLE bool rebuildFTSIndex();
     bool clearAllFTSData();
     void clearFlags(CWizDatabase& db);
 
+    // background compaction of blob store
+    void compactBlobs();
+
     void stop();
+    // m_stop is set by gui thread and polled by indexer and extractor threads
+    bool isStopped();
 
 private:
     CWizDatabaseManager& m_dbMgr;
     QString m_strIndexPath; // working path
-    bool m_stop;
+    QAtomicInt m_stop;
     bool m_buldNow;
+    bool m_bBlobsScanned;
+
+    // indexing session opened by buildFTSIndexByDatabase, deletion should
+    // go through the same writer while it holds the index lock
+    WIZFTSSESSIONOPTIONS m_sessionOptions;
+    void* m_pSessionHandle;
+    QMutex m_mutexSession;
+
+    // percent of one core each indexing thread may use
+    int m_nCpuBudget;
+
+    friend class CWizSearchTextExtractor;
 
 private Q_SLOTS:
     void on_document_deleted(const WIZDOCUMENTDATA& doc);
@@ -65,7 +92,10 @@ class CWizSearcher
 
 public:
     explicit CWizSearcher(CWizDatabaseManager& dbMgr, QObject *parent = 0);
+    ~CWizSearcher();
     void search(const QString& strKeywords, int nMaxSize = -1);
+    // fetch next page of full text results of last search
+    void searchMore();
     void waitForDone();
 
 protected:
@@ -77,22 +107,37 @@ protected:
 private:
     CWizDatabaseManager& m_dbMgr;
     QString m_strIndexPath; // working path
+    // posted by gui thread, guarded by m_mutexWait
     QString m_strkeywords;
     int m_nMaxResult;
+    bool m_bSearchMore;
+
+    // searcher kept between searches
+    void* m_pSearchHandle;
 
     bool m_stop;
     QMutex m_mutexWait;
     QWaitCondition m_wait;
 
 
-    // guid-document map, search faster
-    QMap<QString, WIZDOCUMENTDATAEX> m_mapDocumentSearched;
+    // documents in the order found, guid set used to skip duplicates
+    CWizDocumentDataArray m_arrayDocumentSearched;
+    QSet<QString> m_setDocumentSearched;
     int m_nResults; // results returned
 
-    void doSearch();
+    // full text results are fetched page by page in relevance order,
+    // only touched by searcher thread
+    QString m_strSearchedKeywords;
+    int m_nPageSize;
+    int m_nFtsStart;    // rank of next hit to fetch
+    int m_nFtsTotal;    // total hits of last query, -1 if not queried yet
 
-    Q_INVOKABLE void searchKeyword(const QString& strKeywords);
+    void searchKeyword(const QString& strKeywords, int nMaxResult);
+    void searchKeywordMore();
+    bool isSearchPending();
     void searchDatabase(const QString& strKeywords);
+    void searchFullText(const QString& strKeywords, int nCount);
+    void emitSearchResult(const QString& strKeywords, int nFrom);
 
     void stop();
 
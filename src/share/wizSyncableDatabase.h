@@ -39,6 +39,11 @@ struct IWizSyncableDatabase
 
     virtual bool OnDownloadDocument(int part, const WIZDOCUMENTDATAEX& data) = 0;
 
+    // group downloaded objects into one transaction, can be nested
+    virtual bool BeginTransaction() = 0;
+    virtual bool CommitTransaction() = 0;
+    virtual bool RollbackTransaction() = 0;
+
     virtual bool GetObjectsNeedToBeDownloaded(CWizObjectDataArray& arrayObject) = 0;
 
     virtual bool UpdateObjectData(const QString& strObjectGUID,
@@ -53,6 +58,8 @@ struct IWizSyncableDatabase
     virtual bool GetModifiedStyleList(CWizStyleDataArray& arrayData) = 0;
     virtual bool GetModifiedDocumentList(CWizDocumentDataArray& arrayData) = 0;
     virtual bool GetModifiedAttachmentList(CWizDocumentAttachmentDataArray& arrayData) = 0;
+    // rehash files of modified attachments, update data md5 of edited ones
+    virtual bool RefreshModifiedAttachments() = 0;
 
     virtual bool InitDocumentData(const QString& strGUID, WIZDOCUMENTDATAEX& data, UINT part) = 0;
     virtual bool InitAttachmentData(const QString& strGUID, WIZDOCUMENTATTACHMENTDATAEX& data, UINT part) = 0;
@@ -41,10 +41,14 @@ int CAES::getCipherLen(int len)
     return len - pad + 16;
 }
 
-bool CAES::encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
+bool CAES::encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen /*= -1*/)
 {
-    pStreamSrc->device()->seek(0);
-    pStreamDest->device()->seek(0);
+    bool bWhole = nSrcLen < 0;
+    if (bWhole) {
+        pStreamSrc->device()->seek(0);
+        pStreamDest->device()->seek(0);
+        nSrcLen = pStreamSrc->device()->size();
+    }
 
     // resynchronize with an IV
     enc.Resynchronize((const unsigned char *)iv);
@@ -56,8 +60,6 @@ bool CAES::encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
 
     try
     {
-        int nSrcLen = pStreamSrc->device()->size();
-
         const unsigned int BLOCK_SIZE = 1024 * 16;
         assert(BLOCK_SIZE % 16 == 0);
 
@@ -70,9 +72,9 @@ bool CAES::encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
             return false;
         }
 
-        int nBlockCount = nSrcLen / BLOCK_SIZE;
+        qint64 nBlockCount = nSrcLen / BLOCK_SIZE;
 
-        for (int i = 0; i < nBlockCount; i++)
+        for (qint64 i = 0; i < nBlockCount; i++)
         {
             if (pStreamSrc->readRawData((char *)pBufferSrc, BLOCK_SIZE) == -1) {
                 //throw std::exception("Failed to read data from stream!");
@@ -87,7 +89,7 @@ bool CAES::encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
             }
         }
 
-        int nLast = nSrcLen % BLOCK_SIZE;
+        int nLast = int(nSrcLen % BLOCK_SIZE);
 
         if (pStreamSrc->readRawData((char *)pBufferSrc, nLast) == -1) {
             //throw std::exception("Failed to read data from stream!");
@@ -127,7 +129,9 @@ bool CAES::encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
     delete [] pBufferSrc;
     delete [] pBufferDest;
 
-    pStreamDest->device()->seek(0);
+    if (bWhole) {
+        pStreamDest->device()->seek(0);
+    }
     return bRet;
 }
 
@@ -144,10 +148,14 @@ int CAES::getPlainLen(int len)
 }
 
 
-bool CAES::decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
+bool CAES::decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen /*= -1*/)
 {
-    pStreamSrc->device()->seek(0);
-    pStreamDest->device()->seek(0);
+    bool bWhole = nSrcLen < 0;
+    if (bWhole) {
+        pStreamSrc->device()->seek(0);
+        pStreamDest->device()->seek(0);
+        nSrcLen = pStreamSrc->device()->size();
+    }
 
     // resynchronize with an IV
     dec.Resynchronize((const unsigned char *)iv);
@@ -159,7 +167,6 @@ bool CAES::decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
 
     try
     {
-        int nSrcLen = pStreamSrc->device()->size();
         if (nSrcLen % 16 != 0)
         {
             //throw std::exception("nSrcLen % 16 != 0");
@@ -179,14 +186,14 @@ bool CAES::decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
         }
 
         // process normal prefix blocks.
-        int prefix = nSrcLen - 16;
+        qint64 prefix = nSrcLen - 16;
         if (prefix > 0)
         {
             assert(prefix % 16 == 0);
 
-            int nBlockCount = prefix / BLOCK_SIZE;
+            qint64 nBlockCount = prefix / BLOCK_SIZE;
 
-            for (int i = 0; i < nBlockCount; i++)
+            for (qint64 i = 0; i < nBlockCount; i++)
             {
                 if (pStreamSrc->readRawData((char *)pBufferSrc, BLOCK_SIZE) == -1) {
                     //throw std::exception("Failed to read data from stream!");
@@ -203,7 +210,7 @@ bool CAES::decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
                 }
             }
 
-            int nLast = prefix % BLOCK_SIZE;
+            int nLast = int(prefix % BLOCK_SIZE);
             if (nLast > 0)
             {
                 assert(nLast % 16 == 0);
@@ -264,7 +271,9 @@ bool CAES::decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest)
     delete [] pBufferSrc;
     delete [] pBufferDest;
 
-    pStreamDest->device()->seek(0);
+    if (bWhole) {
+        pStreamDest->device()->seek(0);
+    }
     return bRet;
 }
 
@@ -285,7 +294,7 @@ bool processKeyAESCbc(const unsigned char* lpszKey, int nKeyLen, std::string& st
 
 bool encryptAES256CbcPkcs5(const unsigned char* lpszKey, int nKeyLen, \
                            const unsigned char* pIV, int nIVLen, \
-                           QDataStream* pStreamSrc, QDataStream* pStreamDest)
+                           QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen /*= -1*/)
 {
     if (!pStreamSrc)
     {
@@ -317,12 +326,12 @@ bool encryptAES256CbcPkcs5(const unsigned char* lpszKey, int nKeyLen, \
 
     CAES aes;
     aes.init(strKey.c_str(), strKey.length(), pIV);
-    return aes.encrypt(pStreamSrc, pStreamDest);
+    return aes.encrypt(pStreamSrc, pStreamDest, nSrcLen);
 }
 
 bool decryptAES256CbcPkcs5(const unsigned char* lpszKey, int nKeyLen, \
                       const unsigned char* pIV, int nIVLen, \
-                      QDataStream* pStreamSrc, QDataStream* pStreamDest)
+                      QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen /*= -1*/)
 {
     if (!pStreamSrc)
     {
@@ -354,25 +363,25 @@ bool decryptAES256CbcPkcs5(const unsigned char* lpszKey, int nKeyLen, \
 
     CAES aes;
     aes.init(strKey.c_str(), strKey.length(), pIV);
-    return aes.decrypt(pStreamSrc, pStreamDest);
+    return aes.decrypt(pStreamSrc, pStreamDest, nSrcLen);
 }
 
-bool simpleAESEncrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest)
+bool simpleAESEncrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen /*= -1*/)
 {
     Q_ASSERT(pStreamSrc->device()->isOpen());
     Q_ASSERT(pStreamDest->device()->isOpen());
 
     const unsigned char* lpszIV = (const unsigned char*)"0123456789abcdef";
-    return encryptAES256CbcPkcs5(lpszKey, (int)strlen((const char*)lpszKey), lpszIV, 16, pStreamSrc, pStreamDest);
+    return encryptAES256CbcPkcs5(lpszKey, (int)strlen((const char*)lpszKey), lpszIV, 16, pStreamSrc, pStreamDest, nSrcLen);
 }
 
-bool simpleAESDecrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest)
+bool simpleAESDecrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen /*= -1*/)
 {
     Q_ASSERT(pStreamSrc->device()->isOpen());
     Q_ASSERT(pStreamDest->device()->isOpen());
 
     const unsigned char* lpszIV = (const unsigned char*)"0123456789abcdef";
-    return decryptAES256CbcPkcs5(lpszKey, (int)strlen((const char*)lpszKey), lpszIV, 16, pStreamSrc, pStreamDest);
+    return decryptAES256CbcPkcs5(lpszKey, (int)strlen((const char*)lpszKey), lpszIV, 16, pStreamSrc, pStreamDest, nSrcLen);
 }
 
 bool WizAESEncryptToString(const unsigned char* cipher, \
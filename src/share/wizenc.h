@@ -18,11 +18,14 @@ public:
 
     void init(const char* key, int len, const unsigned char* iv);
 
+    // nSrcLen < 0: process whole source device from beginning, otherwise
+    // nSrcLen bytes from current position of source, written at current
+    // position of dest, so that data can be streamed after a file header
     int getCipherLen(int len);
-    bool encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest);
+    bool encrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen = -1);
 
     int getPlainLen(int len);
-    bool decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest);
+    bool decrypt(QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen = -1);
 
 private:
     CryptoPP::CBC_Mode<CryptoPP::AES>::Encryption enc;   // cryptopp implement aes CBC encryptor.
@@ -35,14 +38,14 @@ bool processKeyAESCbc(const unsigned char* lpszKey, int nKeyLen, std::string& st
 
 bool encryptAES256CbcPkcs5(const unsigned char* lpszKey, int nKeyLen, \
                            const unsigned char* pIV, int nIVLen, \
-                           QDataStream* pStreamSrc, QDataStream* pStreamDest);
+                           QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen = -1);
 
 bool decryptAES256CbcPkcs5(const unsigned char* lpszKey, int nKeyLen, \
                            const unsigned char* pIV, int nIVLen, \
-                           QDataStream* pStreamSrc, QDataStream* pStreamDest);
+                           QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen = -1);
 
-bool simpleAESEncrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest);
-bool simpleAESDecrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest);
+bool simpleAESEncrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen = -1);
+bool simpleAESDecrypt(const unsigned char* lpszKey, QDataStream* pStreamSrc, QDataStream* pStreamDest, qint64 nSrcLen = -1);
 
 // AES decryption call
 bool WizAESEncryptToString(const unsigned char* cipher, \
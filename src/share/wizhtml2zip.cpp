@@ -5,15 +5,149 @@
 #include "../share/wizzip.h"
 
 #include "wizmisc.h"
+#include "wizmd5.h"
 #include "utils/pathresolve.h"
 #include <QDir>
+#include <QFile>
 
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentMap>
+#endif
 
+// max bytes of resources loaded but not written into zip yet
+#define WIZHTML2ZIP_BUFFERED_MAX (32 * 1024 * 1024)
+
+struct WIZHTML2ZIPRESOURCE
+{
+    QString strFileName;
+    qint64 nSize;
+    QByteArray deflated;
+    quint32 crc;
+    QString strMD5;
+    bool bLoaded;
+
+    WIZHTML2ZIPRESOURCE() : nSize(0), crc(0), bLoaded(false) {}
+};
+
+// zip file written to disk and hashed at the same time. zip seeks back to
+// patch local header of an entry after its data, so only bytes of current
+// entry are kept until it is patched, earlier ones are hashed already
+class CWizZipWriteDevice : public QIODevice
+{
+public:
+    CWizZipWriteDevice(const QString& strFileName)
+        : m_file(strFileName)
+        , m_nSize(0)
+        , m_nHashed(0)
+        , m_bPatched(false)
+        , m_bFailed(false)
+    {
+    }
+
+    virtual bool open(OpenMode mode)
+    {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+
+        return QIODevice::open(mode | QIODevice::Unbuffered);
+    }
+
+    virtual void close()
+    {
+        flushPending();
+        m_file.close();
+        QIODevice::close();
+    }
+
+    virtual bool isSequential() const { return false; }
+    virtual qint64 size() const { return m_nSize; }
+
+    virtual bool seek(qint64 pos)
+    {
+        return m_file.seek(pos) && QIODevice::seek(pos);
+    }
+
+    bool failed() const { return m_bFailed || m_file.error() != QFile::NoError; }
+    CString dataMD5() { return m_md5.resultStringNoSpace(); }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxlen)
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(maxlen);
+
+        return -1;
+    }
+
+    virtual qint64 writeData(const char* data, qint64 len)
+    {
+        qint64 nPos = pos();
+        if (nPos < m_nHashed || nPos > m_nSize) {
+            // patched bytes were hashed already, or gap in file
+            m_bFailed = true;
+            return -1;
+        }
+
+        if (nPos < m_nSize) {
+            qint64 nOffset = nPos - m_nHashed;
+            qint64 nLen = qMin(len, m_nSize - nPos);
+            m_pending.replace(nOffset, nLen, data, nLen);
+            m_bPatched = true;
+        } else if (m_bPatched) {
+            flushPending();
+        }
+
+        if (nPos + len > m_nSize) {
+            qint64 nAppend = nPos + len - qMax(nPos, m_nSize);
+            m_pending.append(data + len - nAppend, nAppend);
+            m_nSize = nPos + len;
+        }
+
+        return m_file.write(data, len);
+    }
+
+private:
+    QFile m_file;
+    CWizMd5 m_md5;
+    QByteArray m_pending;
+    qint64 m_nSize;
+    qint64 m_nHashed;
+    bool m_bPatched;
+    bool m_bFailed;
+
+    void flushPending()
+    {
+        m_md5.update(m_pending.constData(), m_pending.size());
+        m_nHashed += m_pending.size();
+        m_pending.clear();
+        m_bPatched = false;
+    }
+};
+
+// run by thread pool, read and deflate resource
+static void WizHtml2ZipLoadResource(WIZHTML2ZIPRESOURCE& res)
+{
+    QFile file(res.strFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QByteArray data = file.readAll();
+    res.nSize = data.size();
+    res.bLoaded = CWizZipFile::deflateData(data, res.deflated, res.crc);
+
+    // for blob store, data is in memory anyway
+    CWizMd5 md5;
+    md5.update(data.constData(), data.size());
+    res.strMD5 = md5.resultStringNoSpace();
+}
 
 
 bool WizHtml2Zip(const QString& strUrl, const QString& strHtml, \
                  const QString& strResourcePath, long flags, \
-                 const QString& strMetaText, const QString& strZipFileName)
+                 const QString& strMetaText, const QString& strZipFileName, \
+                 WIZHTML2ZIPRESULT* pResult /*= NULL*/)
 {
     Q_UNUSED(flags);
 
@@ -27,46 +161,79 @@ bool WizHtml2Zip(const QString& strUrl, const QString& strHtml, \
         return false;
     }
 
-    return collector.Html2Zip(strResourcePath, strMetaText, strZipFileName);
+    return collector.Html2Zip(strResourcePath, strMetaText, strZipFileName, pResult);
 }
 
 bool WizHtml2Zip(const QString& strHtml, const CWizStdStringArray& arrayResource, \
-                 const QString& strMetaText, const QString& strZipFileName)
+                 const QString& strMetaText, const QString& strZipFileName, \
+                 WIZHTML2ZIPRESULT* pResult /*= NULL*/)
 {
+    // written to disk directly, md5 is calculated while writing
+    QDir().mkpath(WizExtractFilePath(strZipFileName));
+    CWizZipWriteDevice device(strZipFileName);
     CWizZipFile zip;
-    if (!zip.open(strZipFileName))
-        return false;
-
-    CString strIndexFileName = Utils::PathResolve::tempPath() + WizIntToStr(GetTickCount()) + ".html";
-    //if (!::WizSaveUnicodeTextToUnicodeFile(strIndexFileName, strHtml))
-    if (!::WizSaveUnicodeTextToUtf8File(strIndexFileName, strHtml))
-        return false;
-
-    CString strMetaFileName = Utils::PathResolve::tempPath() + WizIntToStr(GetTickCount()) + ".xml";
-    if (!::WizSaveUnicodeTextToUtf8File(strMetaFileName, strMetaText))
+    if (!zip.open(&device))
         return false;
 
-    if (!zip.compressFile(strIndexFileName, "index.html"))
+    // utf-8 with bom, same as WizSaveUnicodeTextToUtf8File
+    QByteArray bom("\xEF\xBB\xBF");
+    if (!zip.compressData(bom + strHtml.toUtf8(), "index.html"))
         return false;
 
     int failed = 0;
 
-    if (!zip.compressFile(strMetaFileName, "meta.xml"))
+    if (!zip.compressData(bom + strMetaText.toUtf8(), "meta.xml"))
         failed++;
 
-    for (CWizStdStringArray::const_iterator it = arrayResource.begin();
-        it != arrayResource.end();
-        it++)
+    CWizStdStringArray arrayResourceMD5;
+
+    // resources are loaded and deflated by thread pool, window by window,
+    // and written into zip in order
+    CWizStdStringArray::const_iterator it = arrayResource.begin();
+    while (it != arrayResource.end())
     {
-        CString strFileName = *it;
-        CString strNameInZip = "index_files/" + WizExtractFileName(strFileName);
-        if (!zip.compressFile(strFileName, strNameInZip))
+        QVector<WIZHTML2ZIPRESOURCE> window;
+        qint64 nBuffered = 0;
+        for (; it != arrayResource.end(); it++)
         {
-            failed++;
+            qint64 nSize = QFileInfo(*it).size();
+            if (!window.isEmpty() && nBuffered + nSize > WIZHTML2ZIP_BUFFERED_MAX)
+                break;
+
+            WIZHTML2ZIPRESOURCE res;
+            res.strFileName = *it;
+            window.push_back(res);
+            nBuffered += nSize;
+        }
+
+        QtConcurrent::blockingMap(window, WizHtml2ZipLoadResource);
+
+        for (int i = 0; i < window.size(); i++)
+        {
+            const WIZHTML2ZIPRESOURCE& res = window.at(i);
+            CString strNameInZip = "index_files/" + WizExtractFileName(res.strFileName);
+            if (!res.bLoaded || !zip.compressRawData(res.deflated, res.crc, res.nSize, strNameInZip))
+            {
+                failed++;
+                arrayResourceMD5.push_back(QString());
+                continue;
+            }
+
+            arrayResourceMD5.push_back(res.strMD5);
         }
     }
 
-    return zip.close();
+    if (!zip.close() || device.failed())
+        return false;
+
+    if (pResult) {
+        pResult->strHtml = strHtml;
+        pResult->arrayResource = arrayResource;
+        pResult->arrayResourceMD5 = arrayResourceMD5;
+        pResult->strDataMD5 = device.dataMD5();
+    }
+
+    return true;
 }
 
 
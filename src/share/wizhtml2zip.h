@@ -3,12 +3,24 @@
 
 #include "wizmisc.h"
 
+// what has been written into zip, so that caller needn't read it back
+struct WIZHTML2ZIPRESULT
+{
+    QString strHtml;
+    CWizStdStringArray arrayResource;
+    // md5 of resource content, empty if not written
+    CWizStdStringArray arrayResourceMD5;
+    QString strDataMD5;
+};
+
 bool WizHtml2Zip(const QString& strUrl, const QString& strHtml, \
                  const QString& strResourcePath, long flags, \
-                 const QString& strMetaText, const QString& strZipFileName);
+                 const QString& strMetaText, const QString& strZipFileName, \
+                 WIZHTML2ZIPRESULT* pResult = NULL);
 
 bool WizHtml2Zip(const QString &strHtml, const CWizStdStringArray& arrayResource, \
-                 const QString &strMetaText, const QString &strZipFileName);
+                 const QString &strMetaText, const QString &strZipFileName, \
+                 WIZHTML2ZIPRESULT* pResult = NULL);
 
 //should make sure the folder contains index file   \
 //and all resource files placed in a child resource folder  before use this func
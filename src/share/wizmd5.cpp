@@ -620,17 +620,20 @@ CString WizMd5StringNoSpaceJava(const QByteArray& arr)
 
 CString WizMd5FileStringNoSpaceJava(const CString& strFileName)
 {
-    QFile file(strFileName);
-
-    if (!file.open(QIODevice::ReadOnly)) {
+    BYTE szBuffer[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    //
+    // streamed, large attachments are not loaded into memory
+    if (!WizMd5File(strFileName, szBuffer))
         return CString();
-    }
-
-    CString ret = WizMd5StringNoSpaceJava(file.readAll());
-
-    file.close();
-
-    return ret;
+    //
+    CString str;
+    str.Format(_T("%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"),
+               szBuffer[0], szBuffer[1], szBuffer[2], szBuffer[3],
+               szBuffer[4], szBuffer[5], szBuffer[6], szBuffer[7],
+               szBuffer[8], szBuffer[9], szBuffer[10], szBuffer[11],
+               szBuffer[12], szBuffer[13], szBuffer[14], szBuffer[15]);
+    //
+    return str;
 }
 
 BOOL WizMd5File(const CString& strFileName, BYTE* pResult)
@@ -648,7 +651,7 @@ BOOL WizMd5File(const CString& strFileName, BYTE* pResult)
     //
     wizmd5::MD5Init (&context);
     //
-    const UINT BUFFER_SIZE = 1024;
+    const UINT BUFFER_SIZE = 256 * 1024;
     //
     BOOL bRet = FALSE;
     //
@@ -703,6 +706,45 @@ CString WizMd5FileString(const CString& strFileName)
 }
 
 
+CWizMd5::CWizMd5()
+    : m_context(new wizmd5::MD5Context)
+    , m_nLen(0)
+{
+    wizmd5::MD5Init(m_context);
+}
+
+CWizMd5::~CWizMd5()
+{
+    delete m_context;
+}
+
+void CWizMd5::update(const char* data, qint64 len)
+{
+    const qint64 BUFFER_SIZE = 256 * 1024;
+    while (len > 0)
+    {
+        unsigned nLen = (unsigned)qMin(len, BUFFER_SIZE);
+        wizmd5::MD5Update(m_context, (const unsigned char *)data, nLen);
+        data += nLen;
+        len -= nLen;
+        m_nLen += nLen;
+    }
+}
+
+CString CWizMd5::resultStringNoSpace()
+{
+    if (0 == m_nLen)
+        return CString();
+    //
+    DWORD arrayMd5[4] = {0, 0, 0, 0};
+    wizmd5::MD5Final(m_context, (unsigned char *)arrayMd5);
+    //
+    CString str;
+    str.Format(_T("%08x%08x%08x%08x"), arrayMd5[0], arrayMd5[1], arrayMd5[2], arrayMd5[3]);
+    return str;
+}
+
+
 CString WizPasswordToMd5StringNoSpace(const CString& strPassword)
 {
     if (strPassword.IsEmpty())
@@ -8,8 +8,26 @@ CString WizMd5StringNoSpace(const unsigned char* pBuffer, DWORD dwLen);
 CString WizMd5StringNoSpaceJava(const unsigned char* pBuffer, DWORD dwLen);
 CString WizMd5StringNoSpaceJava(const QByteArray& arr);
 
+BOOL WizMd5File(const CString& strFileName, BYTE* pResult);
 CString WizMd5FileStringNoSpaceJava(const CString& strFileName);
 CString WizMd5FileString(const CString& strFileName);
 CString WizMd5StringNoSpace(const CString& str);
 
+namespace wizmd5 { struct MD5Context; }
+
+// md5 of data given in pieces, same result string as WizMd5FileString
+class CWizMd5
+{
+public:
+    CWizMd5();
+    ~CWizMd5();
+
+    void update(const char* data, qint64 len);
+    CString resultStringNoSpace();
+
+private:
+    wizmd5::MD5Context* m_context;
+    qint64 m_nLen;
+};
+
 #endif // WIZMD5_H
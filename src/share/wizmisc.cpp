@@ -1177,6 +1177,14 @@ bool WizLoadUtf8TextFromFile(const QString& strFileName, QString& strText)
     return true;
 }
 
+bool WizLoadUnicodeTextFromBuffer(const QByteArray& data, QString& strText)
+{
+    QTextStream stream(data, QIODevice::ReadOnly | QIODevice::Text);
+    strText = stream.readAll();
+
+    return true;
+}
+
 bool WizSaveUnicodeTextToUtf16File(const CString& strFileName, const CString& strText)
 {
     QFile file(strFileName);
@@ -2112,6 +2120,11 @@ class SleepThread : public QThread
      }
 };
 
+void WizMSleep(long nMilliseconds)
+{
+    SleepThread::msleep(nMilliseconds);
+}
+
 void WizWaitForThread(QThread* pThread)
 {
     pThread->disconnect();
@@ -97,6 +97,7 @@ QString WizDecryptPassword(const QString& strEncryptedText);
 
 bool WizLoadUnicodeTextFromFile(const QString& strFileName, QString& steText);
 bool WizLoadUtf8TextFromFile(const QString& strFileName, QString& strText);
+bool WizLoadUnicodeTextFromBuffer(const QByteArray& data, QString& strText);
 bool WizSaveUnicodeTextToUtf16File(const QString& strFileName, const QString& strText);
 bool WizSaveUnicodeTextToUtf8File(const QString& strFileName, const QString& strText);
 bool WizSaveUnicodeTextToUtf8File(const QString& strFileName, const QByteArray& strText);
@@ -186,5 +187,6 @@ public:
 
 class QThread;
 void WizWaitForThread(QThread* pThread);
+void WizMSleep(long nMilliseconds);
 
 #endif // WIZMISC_H
@@ -136,6 +136,29 @@ void CWizSettings::SetProxyStatus(bool val)
     SetBool("Sync", "ProxyStatus", val);
 }
 
+WIZSQLITEOPTIONS CWizSettings::GetDatabaseOptions()
+{
+    WIZSQLITEOPTIONS options;
+    options.bWAL = GetBool("Database", "WAL", options.bWAL);
+    options.nSynchronous = GetInt("Database", "Synchronous", options.nSynchronous);
+    options.nCacheSize = GetInt("Database", "CacheSize", options.nCacheSize);
+    options.nMmapSize = (sqlite_int64)GetInt("Database", "MmapSize", int(options.nMmapSize / 1024 / 1024)) * 1024 * 1024;
+    options.bTempStoreMemory = GetBool("Database", "TempStoreMemory", options.bTempStoreMemory);
+    options.nBusyTimeout = GetInt("Database", "BusyTimeout", options.nBusyTimeout);
+
+    return options;
+}
+
+void CWizSettings::SetDatabaseOptions(const WIZSQLITEOPTIONS& options)
+{
+    SetBool("Database", "WAL", options.bWAL);
+    SetInt("Database", "Synchronous", options.nSynchronous);
+    SetInt("Database", "CacheSize", options.nCacheSize);
+    SetInt("Database", "MmapSize", int(options.nMmapSize / 1024 / 1024));
+    SetBool("Database", "TempStoreMemory", options.bTempStoreMemory);
+    SetInt("Database", "BusyTimeout", options.nBusyTimeout);
+}
+
 
 CString WizGetShortcut(const CString& strName, const CString& strDef /*= ""*/)
 {
@@ -306,6 +329,21 @@ void CWizUserSettings::setShowSystemTrayIcon(bool bShowTrayIcon)
     set("ShowSystemTrayIcon", bShowTrayIcon ? "1" : "0");
 }
 
+bool CWizUserSettings::useBlobStore() const
+{
+    QString strUseBlobStore = get("UseBlobStore");
+    if (!strUseBlobStore.isEmpty()) {
+        return strUseBlobStore.toInt() ? true : false;
+    }
+
+    return true;
+}
+
+void CWizUserSettings::setUseBlobStore(bool bUseBlobStore)
+{
+    set("UseBlobStore", bUseBlobStore ? "1" : "0");
+}
+
 QString CWizUserSettings::skin()
 {
     // just return because no skin selection from v1.4
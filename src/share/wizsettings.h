@@ -42,6 +42,9 @@ public:
     bool GetProxyStatus();
     void SetProxyStatus(bool val);
 
+    // sqlite open profile, applied to index and thumb databases
+    WIZSQLITEOPTIONS GetDatabaseOptions();
+    void SetDatabaseOptions(const WIZSQLITEOPTIONS& options);
 };
 
 
@@ -102,6 +105,10 @@ public:
     bool showSystemTrayIcon() const;
     void setShowSystemTrayIcon(bool bShowTrayIcon);
 
+    // keep resources and attachments in local blob store
+    bool useBlobStore() const;
+    void setUseBlobStore(bool bUseBlobStore);
+
     QString locale();
     void setLocale(const QString& strLocale);
 
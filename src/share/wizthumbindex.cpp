@@ -168,6 +168,59 @@ bool CThumbIndex::AbstractFromGUID(const CString& guid, WIZABSTRACT &abstract,co
 	}
 }
 
+bool CThumbIndex::PadAbstractsFromGUID(const CWizStdStringArray& arrayGUID, std::map<CString, WIZABSTRACT>& mapAbstract)
+{
+    return AbstractsFromGUID(arrayGUID, mapAbstract, PAD_TYPE);
+}
+
+bool CThumbIndex::AbstractsFromGUID(const CWizStdStringArray& arrayGUID, std::map<CString, WIZABSTRACT>& mapAbstract, const CString& type)
+{
+    if(!m_dbThumb.IsOpened())
+        return false;
+
+    if (arrayGUID.empty())
+        return true;
+
+    CWizStdStringArray arrayValue;
+    for (CWizStdStringArray::const_iterator it = arrayGUID.begin(); it != arrayGUID.end(); it++) {
+        arrayValue.push_back(STR2SQL(*it));
+    }
+
+    CString strValues;
+    ::WizStringArrayToText(arrayValue, strValues, ", ");
+
+    CString sql = CString("select ") + FIELD_LIST_ABSTRACT + " from " + TABLE_NAME_ABSTRACT
+                    + " where ABSTRACT_TYPE=" + STR2SQL(type)
+                    + " AND ABSTRACT_GUID in (" + strValues + ");";
+    try
+    {
+        CppSQLite3Query query = m_dbThumb.execQuery(sql);
+
+        while (!query.eof())
+        {
+            WIZABSTRACT abstract;
+            abstract.guid = query.getStringField(0);
+            abstract.text = query.getStringField(2);
+            int length;
+            const unsigned char * imageData = query.getBlobField(3, length);
+            if (imageData && length)
+            {
+                abstract.image.loadFromData(imageData, length);
+            }
+
+            mapAbstract[abstract.guid] = abstract;
+            query.nextRow();
+        }
+        return true;
+    }
+    catch (const CppSQLite3Exception& e)
+    {
+        TOLOG(e.errorMessage());
+        TOLOG(sql);
+        return false;
+    }
+}
+
 bool CThumbIndex::UpdatePadAbstract(const WIZABSTRACT &abstract)
 {
     return UpdateAbstract(abstract, PAD_TYPE);
@@ -2,6 +2,7 @@
 #define WIZTHUMBINDEX_H
 
 #include <QImage>
+#include <map>
 
 #include "cppsqlite3.h"
 #include "wizobject.h"
@@ -20,6 +21,7 @@ private:
     bool checkThumbTable(const CString& strTableName, const CString& strTableSQL);
     bool UpdateAbstract(const WIZABSTRACT& abstract, const CString& type);
     bool AbstractFromGUID(const CString& guid, WIZABSTRACT& lpszAbstract,const CString& type);
+    bool AbstractsFromGUID(const CWizStdStringArray& arrayGUID, std::map<CString, WIZABSTRACT>& mapAbstract, const CString& type);
     bool AbstractIsExist(const CString& guid,const CString& type);
 
 public:
@@ -30,6 +32,8 @@ public:
     bool UpdateIphoneAbstract(const WIZABSTRACT &lpszAbstract);
     bool PhoneAbstractFromGUID(const CString& guid, WIZABSTRACT& lpszAbstract);
     bool PadAbstractFromGUID(const CString& guid, WIZABSTRACT& lpszAbstract);
+    // read abstracts of many notes in one query, guid => abstract
+    bool PadAbstractsFromGUID(const CWizStdStringArray& arrayGUID, std::map<CString, WIZABSTRACT>& mapAbstract);
     bool DeleteAbstractByGUID(const CString& guid);
     bool PhoneAbstractExist(const CString& guid);
     bool PadAbstractExist(const CString& guid);
@@ -134,6 +134,278 @@ bool WizXmlRpcResultFromXml(CWizXMLDocument& doc, CWizXmlRpcValue** ppRet)
 }
 
 
+/* ------------------------- CWizXmlRpcResultReader ------------------------- */
+CWizXmlRpcResultReader::CWizXmlRpcResultReader()
+    : m_pValue(NULL)
+    , m_pResult(NULL)
+    , m_bFinished(false)
+    , m_bError(false)
+{
+    // ex:nil, ex:i8 are used without namespace declaration
+    m_reader.setNamespaceProcessing(false);
+}
+
+CWizXmlRpcResultReader::~CWizXmlRpcResultReader()
+{
+    std::vector<WIZXMLRPCREADERFRAME>::const_iterator it;
+    for (it = m_stack.begin(); it != m_stack.end(); it++) {
+        delete it->pContainer;
+    }
+
+    delete m_pValue;
+    delete m_pResult;
+}
+
+bool CWizXmlRpcResultReader::addData(const QByteArray& data)
+{
+    if (m_bError)
+        return false;
+
+    m_reader.addData(data);
+    return parse();
+}
+
+CWizXmlRpcValue* CWizXmlRpcResultReader::takeResult()
+{
+    if (!m_bFinished || m_bError)
+        return NULL;
+
+    CWizXmlRpcValue* pRet = m_pResult;
+    m_pResult = NULL;
+    return pRet;
+}
+
+bool CWizXmlRpcResultReader::parse()
+{
+    while (!m_reader.atEnd()) {
+        switch (m_reader.readNext()) {
+        case QXmlStreamReader::StartElement:
+            if (!startElement(m_reader.qualifiedName().toString()))
+                return false;
+            break;
+        case QXmlStreamReader::EndElement:
+            if (!endElement(m_reader.qualifiedName().toString()))
+                return false;
+            break;
+        case QXmlStreamReader::Characters:
+            characters(m_reader.text());
+            break;
+        case QXmlStreamReader::EndDocument:
+            if (!m_pResult)
+                return setError("Failed to get methodResponse value!");
+
+            m_bFinished = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // wait for more data
+    if (m_reader.error() == QXmlStreamReader::PrematureEndOfDocumentError)
+        return true;
+
+    if (m_reader.hasError())
+        return setError(m_reader.errorString());
+
+    return true;
+}
+
+bool CWizXmlRpcResultReader::startElement(const QString& strName)
+{
+    m_strText.clear();
+
+    if (0 == strName.compare("value", Qt::CaseInsensitive))
+    {
+        m_strType.clear();
+        delete m_pValue;
+        m_pValue = NULL;
+    }
+    else if (0 == strName.compare("struct", Qt::CaseInsensitive)
+             || 0 == strName.compare("array", Qt::CaseInsensitive))
+    {
+        WIZXMLRPCREADERFRAME frame;
+        if (0 == strName.compare("struct", Qt::CaseInsensitive))
+            frame.pContainer = new CWizXmlRpcStructValue();
+        else
+            frame.pContainer = new CWizXmlRpcArrayValue();
+
+        m_stack.push_back(frame);
+    }
+    else if (0 == strName.compare("methodResponse", Qt::CaseInsensitive)
+             || 0 == strName.compare("fault", Qt::CaseInsensitive)
+             || 0 == strName.compare("name", Qt::CaseInsensitive)
+             || 0 == strName.compare("params", Qt::CaseInsensitive)
+             || 0 == strName.compare("param", Qt::CaseInsensitive)
+             || 0 == strName.compare("member", Qt::CaseInsensitive)
+             || 0 == strName.compare("data", Qt::CaseInsensitive))
+    {
+    }
+    else
+    {
+        // scalar type element
+        m_strType = strName;
+        m_base64.clear();
+        m_data.clear();
+    }
+
+    return true;
+}
+
+bool CWizXmlRpcResultReader::endElement(const QString& strName)
+{
+    if (0 == strName.compare("name", Qt::CaseInsensitive))
+    {
+        if (m_stack.empty())
+            return setError("Failed to get struct of member name!");
+
+        m_stack.back().strMemberName = m_strText;
+    }
+    else if (0 == strName.compare("struct", Qt::CaseInsensitive)
+             || 0 == strName.compare("array", Qt::CaseInsensitive))
+    {
+        Q_ASSERT(!m_stack.empty());
+
+        delete m_pValue;
+        m_pValue = m_stack.back().pContainer;
+        m_stack.pop_back();
+    }
+    else if (0 == strName.compare("value", Qt::CaseInsensitive))
+    {
+        // <value>text</value> is string
+        if (!m_pValue)
+        {
+            if (!scalarValue(&m_pValue))
+                return false;
+        }
+
+        CWizXmlRpcValue* pValue = m_pValue;
+        m_pValue = NULL;
+
+        if (m_stack.empty())
+        {
+            delete m_pResult;
+            m_pResult = pValue;
+        }
+        else if (CWizXmlRpcStructValue* pStruct = dynamic_cast<CWizXmlRpcStructValue*>(m_stack.back().pContainer))
+        {
+            pStruct->AddValue(m_stack.back().strMemberName, pValue);
+        }
+        else if (CWizXmlRpcArrayValue* pArray = dynamic_cast<CWizXmlRpcArrayValue*>(m_stack.back().pContainer))
+        {
+            pArray->Add(pValue);
+        }
+    }
+    else if (0 == strName.compare("fault", Qt::CaseInsensitive))
+    {
+        CWizXmlRpcStructValue* pStruct = dynamic_cast<CWizXmlRpcStructValue*>(m_pResult);
+        if (!pStruct)
+            return setError("Failed to get fault value node!");
+
+        CWizXmlRpcFaultValue* pFault = new CWizXmlRpcFaultValue();
+        pFault->m_val.m_map.swap(pStruct->m_map);
+
+        delete m_pResult;
+        m_pResult = pFault;
+    }
+    else if (!m_strType.isEmpty() && 0 == strName.compare(m_strType, Qt::CaseInsensitive))
+    {
+        delete m_pValue;
+        m_pValue = NULL;
+
+        if (!scalarValue(&m_pValue))
+            return false;
+
+        m_strType.clear();
+    }
+
+    return true;
+}
+
+void CWizXmlRpcResultReader::characters(const QStringRef& text)
+{
+    if (0 == m_strType.compare("base64", Qt::CaseInsensitive))
+    {
+        m_base64.append(text.toLatin1());
+        decodeBase64(false);
+        return;
+    }
+
+    m_strText.append(text);
+}
+
+void CWizXmlRpcResultReader::decodeBase64(bool bFinal)
+{
+    // strip line breaks, so that every 4 chars could be decoded
+    m_base64.replace('\r', "");
+    m_base64.replace('\n', "");
+    m_base64.replace(' ', "");
+
+    int nLen = bFinal ? m_base64.size() : m_base64.size() / 4 * 4;
+    if (nLen <= 0)
+        return;
+
+    m_data.append(QByteArray::fromBase64(m_base64.left(nLen)));
+    m_base64.remove(0, nLen);
+}
+
+bool CWizXmlRpcResultReader::scalarValue(CWizXmlRpcValue** ppRet)
+{
+    *ppRet = NULL;
+
+    if (m_strType.isEmpty()
+        || 0 == m_strType.compare("string", Qt::CaseInsensitive)
+        || 0 == m_strType.compare("ex:nil", Qt::CaseInsensitive)
+        || 0 == m_strType.compare("ex:i8", Qt::CaseInsensitive)
+        || 0 == m_strType.compare("nil", Qt::CaseInsensitive)
+        || 0 == m_strType.compare("i8", Qt::CaseInsensitive))
+    {
+        *ppRet = new CWizXmlRpcStringValue(m_strText);
+    }
+    else if (0 == m_strType.compare("int", Qt::CaseInsensitive)
+        || 0 == m_strType.compare("i4", Qt::CaseInsensitive))
+    {
+        *ppRet = new CWizXmlRpcIntValue(m_strText.toInt());
+    }
+    else if (0 == m_strType.compare("boolean", Qt::CaseInsensitive)
+        || 0 == m_strType.compare("bool", Qt::CaseInsensitive))
+    {
+        *ppRet = new CWizXmlRpcBoolValue(m_strText == "1" || 0 == m_strText.compare("true", Qt::CaseInsensitive));
+    }
+    else if (0 == m_strType.compare("dateTime.iso8601", Qt::CaseInsensitive))
+    {
+        COleDateTime t;
+        CString strError;
+        if (!WizIso8601StringToDateTime(m_strText, t, strError))
+            return setError(strError);
+
+        *ppRet = new CWizXmlRpcTimeValue(t);
+    }
+    else if (0 == m_strType.compare("base64", Qt::CaseInsensitive))
+    {
+        decodeBase64(true);
+        *ppRet = new CWizXmlRpcBase64Value(m_data);
+        m_data.clear();
+    }
+    else
+    {
+        return setError(WizFormatString1("Unknown xmlrpc value type:%1", m_strType));
+    }
+
+    m_strText.clear();
+    return true;
+}
+
+bool CWizXmlRpcResultReader::setError(const QString& strError)
+{
+    TOLOG(strError);
+
+    m_bError = true;
+    m_strError = strError;
+    return false;
+}
+
+
 /* ------------------------- CWizXmlRpcIntValue ------------------------- */
 CWizXmlRpcRequest::CWizXmlRpcRequest(const QString& strMethodName)
 {
@@ -1,6 +1,8 @@
 #ifndef WIZXMLRPC_H
 #define WIZXMLRPC_H
 
+#include <QXmlStreamReader>
+
 #include "wizxml.h"
 
 
@@ -201,6 +203,8 @@ public:
 private:
     std::map<QString, CWizXmlRpcValue*> m_map;
 
+    friend class CWizXmlRpcResultReader;
+
     // map management methods
     void Clear();
     void RemoveValue(const QString& strName);
@@ -228,6 +232,8 @@ public:
 
 private:
     CWizXmlRpcStructValue m_val;
+
+    friend class CWizXmlRpcResultReader;
 };
 
 
@@ -249,6 +255,53 @@ protected:
 bool WizXmlRpcResultFromXml(CWizXMLDocument& doc, CWizXmlRpcValue** ppRet);
 
 
+/* ------------------------- CWizXmlRpcResultReader ------------------------- */
+// build the result value while response data arriving, without xml text and
+// dom tree, base64 data is decoded directly.
+class CWizXmlRpcResultReader
+{
+public:
+    CWizXmlRpcResultReader();
+    ~CWizXmlRpcResultReader();
+
+    // parse tokens of data added so far, false if response is invalid
+    bool addData(const QByteArray& data);
+    bool isFinished() const { return m_bFinished; }
+    bool hasError() const { return m_bError; }
+    QString errorString() const { return m_strError; }
+
+    // caller should delete returned value
+    CWizXmlRpcValue* takeResult();
+
+private:
+    struct WIZXMLRPCREADERFRAME
+    {
+        CWizXmlRpcValue* pContainer;
+        QString strMemberName;
+    };
+
+    QXmlStreamReader m_reader;
+    std::vector<WIZXMLRPCREADERFRAME> m_stack;
+    CWizXmlRpcValue* m_pValue;
+    CWizXmlRpcValue* m_pResult;
+    QString m_strType;
+    QString m_strText;
+    QByteArray m_base64;
+    QByteArray m_data;
+    bool m_bFinished;
+    bool m_bError;
+    QString m_strError;
+
+    bool parse();
+    bool startElement(const QString& strName);
+    bool endElement(const QString& strName);
+    void characters(const QStringRef& text);
+    bool scalarValue(CWizXmlRpcValue** ppRet);
+    void decodeBase64(bool bFinal);
+    bool setError(const QString& strError);
+};
+
+
 // template methods
 
 template <class TData>
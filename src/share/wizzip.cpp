@@ -8,6 +8,13 @@
 #include "quazip/quazip.h"
 #include "quazip/quazipfile.h"
 #include "quazip/quazipfileinfo.h"
+#include "quazip/unzip.h"
+
+#include <QBuffer>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
 
 
 class JlCompress {
@@ -575,7 +582,12 @@ bool CWizZipFile::open(const CString& strFileName)
     close();
     //
     m_zip = JlCompress::openWriteonlyZip(strFileName);
-    return m_zip ? true : false;
+    if (!m_zip)
+        return false;
+    //
+    m_strFileName = strFileName;
+    CWizUnzipFile::invalidateDirectoryCache(m_strFileName);
+    return true;
 }
 
 bool CWizZipFile::compressFile(const CString& strFileName, const CString& strNameInZip)
@@ -586,6 +598,83 @@ bool CWizZipFile::compressFile(const CString& strFileName, const CString& strNam
     return JlCompress::compressFile(m_zip, strFileName, strNameInZip);
 }
 
+bool CWizZipFile::open(QIODevice* device)
+{
+    close();
+    //
+    m_zip = new QuaZip(device);
+    if (!m_zip->open(QuaZip::mdCreate)) {
+        delete m_zip;
+        m_zip = NULL;
+        return false;
+    }
+    //
+    return true;
+}
+
+bool CWizZipFile::compressData(const QByteArray& data, const CString& strNameInZip)
+{
+    if (!m_zip)
+        return false;
+    //
+    QuaZipFile outFile(m_zip);
+    if (!outFile.open(QIODevice::WriteOnly, QuaZipNewInfo(strNameInZip)))
+        return false;
+    //
+    if (outFile.write(data) != data.size() || outFile.getZipError() != UNZ_OK)
+        return false;
+    //
+    outFile.close();
+    //
+    return outFile.getZipError() == UNZ_OK;
+}
+
+bool CWizZipFile::compressRawData(const QByteArray& deflated, quint32 crc, qint64 nSize, const CString& strNameInZip)
+{
+    if (!m_zip)
+        return false;
+    //
+    QuaZipNewInfo info(strNameInZip);
+    info.uncompressedSize = nSize;
+    //
+    QuaZipFile outFile(m_zip);
+    if (!outFile.open(QIODevice::WriteOnly, info, NULL, crc, Z_DEFLATED, Z_DEFAULT_COMPRESSION, true))
+        return false;
+    //
+    if (outFile.write(deflated) != deflated.size() || outFile.getZipError() != UNZ_OK)
+        return false;
+    //
+    outFile.close();
+    //
+    return outFile.getZipError() == UNZ_OK;
+}
+
+bool CWizZipFile::deflateData(const QByteArray& data, QByteArray& deflated, quint32& crc)
+{
+    // raw deflate stream, same as QuaZipFile writes
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    //
+    deflated.resize(deflateBound(&stream, data.size()));
+    stream.next_in = (Bytef *)data.constData();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef *)deflated.data();
+    stream.avail_out = deflated.size();
+    //
+    int ret = deflate(&stream, Z_FINISH);
+    deflated.resize(stream.total_out);
+    deflateEnd(&stream);
+    //
+    if (ret != Z_STREAM_END)
+        return false;
+    //
+    crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)data.constData(), data.size());
+    //
+    return true;
+}
+
 bool CWizZipFile::close()
 {
     if (!m_zip)
@@ -595,6 +684,12 @@ bool CWizZipFile::close()
     //
     m_zip = NULL;
     //
+    // readers may have cached the directory while file was being written
+    if (!m_strFileName.isEmpty()) {
+        CWizUnzipFile::invalidateDirectoryCache(m_strFileName);
+        m_strFileName.clear();
+    }
+    //
     return ret;
 }
 
@@ -611,14 +706,106 @@ CWizUnzipFile::~CWizUnzipFile()
     close();
 }
 
+// central directory of recently opened zip files, so that entries can be
+// located without reading the whole directory again
+struct WIZUNZIPDIRECTORY
+{
+    QStringList names;
+    QHash<QString, unz_file_pos> positions;
+};
+
+#define WIZUNZIP_DIRECTORY_CACHE_MAX    32
+
+static QMutex g_mutexDirectoryCache;
+static QList<QPair<QString, WIZUNZIPDIRECTORYPTR> > g_directoryCache;   // most recent first
+
+// file may be changed in place, so size and time are part of the key. time
+// resolution is coarse, writers of zip files invalidate entries as well
+static QString WizUnzipDirectoryKey(const CString& strFileName)
+{
+    QFileInfo info(strFileName);
+    return info.absoluteFilePath()
+            + "|" + QString::number(info.size())
+            + "|" + QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+void CWizUnzipFile::invalidateDirectoryCache(const CString& strFileName)
+{
+    QString strPrefix = QFileInfo(strFileName).absoluteFilePath() + "|";
+    //
+    QMutexLocker locker(&g_mutexDirectoryCache);
+    for (int i = g_directoryCache.size() - 1; i >= 0; i--) {
+        if (g_directoryCache.at(i).first.startsWith(strPrefix))
+            g_directoryCache.removeAt(i);
+    }
+}
+
+static WIZUNZIPDIRECTORYPTR WizUnzipLoadDirectory(QuaZip* zip)
+{
+    WIZUNZIPDIRECTORYPTR directory(new WIZUNZIPDIRECTORY());
+    for (bool more = zip->goToFirstFile(); more; more = zip->goToNextFile()) {
+        unz_file_pos pos;
+        if (unzGetFilePos(zip->getUnzFile(), &pos) != UNZ_OK)
+            continue;
+        //
+        QString strName = zip->getCurrentFileName();
+        directory->names.append(strName);
+        directory->positions[strName] = pos;
+    }
+    //
+    return directory;
+}
+
 bool CWizUnzipFile::open(const CString& strFileName)
 {
     close();
     //
-    m_zip = ::JlCompress::openReadonlyZip(strFileName);
-    m_names = m_zip->getFileNameList();
+    // not JlCompress::openReadonlyZip, which removes file if failed to open
+    m_zip = new QuaZip(QFileInfo(strFileName).absoluteFilePath());
+    if (!m_zip->open(QuaZip::mdUnzip)) {
+        delete m_zip;
+        m_zip = NULL;
+        return false;
+    }
+    //
+    QString strKey = WizUnzipDirectoryKey(strFileName);
+    //
+    QMutexLocker locker(&g_mutexDirectoryCache);
+    for (int i = 0; i < g_directoryCache.size(); i++) {
+        if (g_directoryCache.at(i).first == strKey) {
+            m_directory = g_directoryCache.at(i).second;
+            g_directoryCache.move(i, 0);
+            break;
+        }
+    }
+    //
+    if (!m_directory) {
+        m_directory = WizUnzipLoadDirectory(m_zip);
+        g_directoryCache.prepend(qMakePair(strKey, m_directory));
+        while (g_directoryCache.size() > WIZUNZIP_DIRECTORY_CACHE_MAX)
+            g_directoryCache.removeLast();
+    }
+    //
+    m_names = m_directory->names;
+    //
+    return true;
+}
+
+bool CWizUnzipFile::open(QIODevice* device)
+{
+    close();
+    //
+    m_zip = new QuaZip(device);
+    if (!m_zip->open(QuaZip::mdUnzip)) {
+        delete m_zip;
+        m_zip = NULL;
+        return false;
+    }
+    //
+    m_directory = WizUnzipLoadDirectory(m_zip);
+    m_names = m_directory->names;
     //
-    return m_zip ? true : false;
+    return true;
 }
 
 int CWizUnzipFile::count()
@@ -647,6 +834,28 @@ int CWizUnzipFile::fileNameToIndex(const CString& strNameInZip)
     return m_names.indexOf(strNameInZip);
 }
 
+bool CWizUnzipFile::contains(const CString& strNameInZip)
+{
+    if (!m_zip)
+        return false;
+    //
+    return m_directory->positions.contains(strNameInZip);
+}
+
+bool CWizUnzipFile::locateFile(const CString& strNameInZip)
+{
+    QHash<QString, unz_file_pos>::const_iterator it = m_directory->positions.find(strNameInZip);
+    if (it == m_directory->positions.end())
+        return false;
+    //
+    // QuaZip only knows there is a current file after goToFirstFile
+    if (!m_zip->hasCurrentFile() && !m_zip->goToFirstFile())
+        return false;
+    //
+    unz_file_pos pos = it.value();
+    return unzGoToFilePos(m_zip->getUnzFile(), &pos) == UNZ_OK;
+}
+
 bool CWizUnzipFile::extractFile(int index, const CString& strFileName)
 {
     if (!m_zip)
@@ -655,7 +864,7 @@ bool CWizUnzipFile::extractFile(int index, const CString& strFileName)
     if (index < 0 || index >= count())
         return false;
     //
-    return JlCompress::extractFile(m_zip, fileName(index), strFileName);
+    return extractFile(fileName(index), strFileName);
 }
 
 bool CWizUnzipFile::extractFile(const CString& strNameInZip, const CString& strFileName)
@@ -663,9 +872,55 @@ bool CWizUnzipFile::extractFile(const CString& strNameInZip, const CString& strF
     if (!m_zip)
         return false;
     //
-    return JlCompress::extractFile(m_zip, strNameInZip, strFileName);
+    if (!contains(strNameInZip))
+        return false;
+    //
+    QDir().mkpath(QFileInfo(strFileName).absolutePath());
+    //
+    QFile file(strFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    //
+    if (!extractFile(strNameInZip, &file)) {
+        file.remove();
+        return false;
+    }
+    //
+    return true;
+}
+
+bool CWizUnzipFile::extractFile(const CString& strNameInZip, QByteArray& data)
+{
+    if (!m_zip)
+        return false;
+    //
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    //
+    return extractFile(strNameInZip, &buffer);
+}
+
+bool CWizUnzipFile::extractFile(const CString& strNameInZip, QIODevice* device)
+{
+    if (!m_zip)
+        return false;
+    //
+    if (!locateFile(strNameInZip))
+        return false;
+    //
+    QuaZipFile file(m_zip);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    //
+    if (!copyData(file, *device) || file.getZipError() != UNZ_OK)
+        return false;
+    //
+    file.close();
+    //
+    return file.getZipError() == UNZ_OK;
 }
-bool CWizUnzipFile::extractAll(const CString& strDestPath)
+
+bool CWizUnzipFile::extractAll(const CString& strDestPath, bool bOverwrite)
 {
     if (!m_zip)
         return false;
@@ -675,7 +930,12 @@ bool CWizUnzipFile::extractAll(const CString& strDestPath)
     QDir directory(strDestPath);
     for (int i = 0; i < m_names.count(); i++) {
         QString absFilePath = directory.absoluteFilePath(m_names.at(i));
-        if (JlCompress::extractFile(m_zip, m_names.at(i), absFilePath)) {
+        if (!bOverwrite && QFile::exists(absFilePath)) {
+            succeeded++;
+            continue;
+        }
+        //
+        if (extractFile(m_names.at(i), absFilePath)) {
             succeeded++;
         }
     }
@@ -688,7 +948,8 @@ bool CWizUnzipFile::close()
     if (!m_zip)
         return false;
     //
-    m_names.clear();;
+    m_names.clear();
+    m_directory.clear();
     //
     bool ret = JlCompress::closeZip(m_zip);
     //
@@ -703,3 +964,16 @@ bool CWizUnzipFile::extractZip(const CString& strZipFileName, const CString& str
     return !sl.empty();
 }
 
+bool CWizUnzipFile::extractZipFile(const CString& strZipFileName, const CString& strNameInZip, QByteArray& data)
+{
+    QFile file(strZipFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    //
+    CWizUnzipFile zip;
+    if (!zip.open(&file))
+        return false;
+    //
+    return zip.extractFile(strNameInZip, data);
+}
+
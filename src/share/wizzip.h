@@ -3,8 +3,13 @@
 
 #include "../share/wizqthelper.h"
 #include <QStringList>
+#include <QSharedPointer>
 
 class QuaZip;
+class QIODevice;
+
+struct WIZUNZIPDIRECTORY;
+typedef QSharedPointer<WIZUNZIPDIRECTORY> WIZUNZIPDIRECTORYPTR;
 
 class CWizZipFile
 {
@@ -13,10 +18,17 @@ public:
     virtual ~CWizZipFile();
 protected:
     QuaZip* m_zip;
+    CString m_strFileName;
 public:
     bool open(const CString& strFileName);
+    bool open(QIODevice* device);
     bool compressFile(const CString& strFileName, const CString& strNameInZip);
+    bool compressData(const QByteArray& data, const CString& strNameInZip);
+    // write data deflated by deflateData, so that deflating can be done in other threads
+    bool compressRawData(const QByteArray& deflated, quint32 crc, qint64 nSize, const CString& strNameInZip);
     bool close();
+    //
+    static bool deflateData(const QByteArray& data, QByteArray& deflated, quint32& crc);
 };
 
 
@@ -28,18 +40,30 @@ public:
 protected:
     QuaZip* m_zip;
     QStringList m_names;
+    WIZUNZIPDIRECTORYPTR m_directory;
+    //
+    bool locateFile(const CString& strNameInZip);
 public:
+    // central directory of file is cached, entries are located directly
     bool open(const CString& strFileName);
+    bool open(QIODevice* device);
     int count();
     CString fileName(int index);
     int fileNameToIndex(const CString& strNameInZip);
+    bool contains(const CString& strNameInZip);
     bool extractFile(int index, const CString& strFileName);
     bool extractFile(const CString& strNameInZip, const CString& strFileName);
-    bool extractAll(const CString& strDestPath);
+    bool extractFile(const CString& strNameInZip, QByteArray& data);
+    bool extractFile(const CString& strNameInZip, QIODevice* device);
+    // if !bOverwrite, only entries not on disk are extracted
+    bool extractAll(const CString& strDestPath, bool bOverwrite = true);
     bool close();
 
 public:
     static bool extractZip(const CString& strZipFileName, const CString& strDestPath);
+    static bool extractZipFile(const CString& strZipFileName, const CString& strNameInZip, QByteArray& data);
+    // call after file is written in place, size and time may not change
+    static void invalidateDirectoryCache(const CString& strFileName);
 };
 
 
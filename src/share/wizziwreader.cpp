@@ -2,17 +2,280 @@
 
 #include <QDataStream>
 #include <QFile>
+#include <QTimer>
+#include <QCryptographicHash>
 
 #include "wizmisc.h"
 #include "wizenc.h"
 #include "utils/logger.h"
 
+#include <vector>
+
+
+// same as simpleAESEncrypt and simpleAESDecrypt
+static const unsigned char* WIZZIW_AES_IV = (const unsigned char*)"0123456789abcdef";
+
+CWizZiwDecryptDevice::CWizZiwDecryptDevice(const QString& strFileName, const QByteArray& ziwCipher, QObject* parent)
+    : QIODevice(parent)
+    , m_file(strFileName)
+    , m_nCipherSize(0)
+    , m_nSize(0)
+{
+    std::string strKey;
+    const char* lpszKey = ziwCipher.constData();
+    if (processKeyAESCbc((const unsigned char*)lpszKey, (int)strlen(lpszKey), strKey)) {
+        m_key = QByteArray(strKey.c_str(), (int)strKey.length());
+    }
+}
+
+CWizZiwDecryptDevice::~CWizZiwDecryptDevice()
+{
+    close();
+    m_key.fill(0);
+}
+
+bool CWizZiwDecryptDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || m_key.isEmpty()) {
+        return false;
+    }
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        TOLOG("Can't open file for reading while decrypt data");
+        return false;
+    }
+
+    m_nCipherSize = m_file.size() - sizeof(WIZZIWHEADER);
+    if (m_nCipherSize < 16 || m_nCipherSize % 16 != 0) {
+        TOLOG("Invalid size of encrypted data");
+        m_file.close();
+        return false;
+    }
+
+    // size of plain data is known by padding of last block, and the cipher is
+    // checked at the same time
+    unsigned char padding[16];
+    if (!decryptBlocks(m_nCipherSize / 16 - 1, 1, padding)) {
+        m_file.close();
+        return false;
+    }
+
+    int pad = padding[15];
+    bool bPadding = pad >= 1 && pad <= 16;
+    for (int i = 0; bPadding && i < pad; i++) {
+        bPadding = padding[15 - i] == pad;
+    }
+
+    if (!bPadding) {
+        TOLOG("Padding error! Invalid password?");
+        m_file.close();
+        return false;
+    }
+
+    m_nSize = m_nCipherSize - pad;
+
+    // position is tracked by QIODevice, like QBuffer
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void CWizZiwDecryptDevice::close()
+{
+    QIODevice::close();
+    m_file.close();
+}
+
+bool CWizZiwDecryptDevice::decryptBlocks(qint64 nBlock, int nBlockCount, unsigned char* pOut)
+{
+    unsigned char iv[16];
+    qint64 nOffset = sizeof(WIZZIWHEADER) + nBlock * 16;
+    if (nBlock == 0) {
+        memcpy(iv, WIZZIW_AES_IV, 16);
+    } else if (!m_file.seek(nOffset - 16) || m_file.read((char *)iv, 16) != 16) {
+        TOLOG("Failed to read data while decrypt data");
+        return false;
+    }
+
+    int nLen = nBlockCount * 16;
+    std::vector<unsigned char> buffer(nLen);
+    if (!m_file.seek(nOffset) || m_file.read((char *)&buffer[0], nLen) != nLen) {
+        TOLOG("Failed to read data while decrypt data");
+        return false;
+    }
+
+    try
+    {
+        CryptoPP::CBC_Mode<CryptoPP::AES>::Decryption dec;
+        dec.SetKeyWithIV((const unsigned char *)m_key.constData(), m_key.size(), iv);
+        dec.ProcessData(pOut, &buffer[0], nLen);
+    }
+    catch (const std::exception& err)
+    {
+        TOLOG(err.what());
+        return false;
+    }
+
+    return true;
+}
+
+qint64 CWizZiwDecryptDevice::readData(char* data, qint64 maxlen)
+{
+    const int BLOCK_COUNT = 1024;
+
+    qint64 nPos = pos();
+    qint64 nLen = qMin(maxlen, m_nSize - nPos);
+    if (nLen <= 0) {
+        return 0;
+    }
+
+    std::vector<unsigned char> plain(BLOCK_COUNT * 16);
+    qint64 nRead = 0;
+    while (nRead < nLen) {
+        qint64 nCurrent = nPos + nRead;
+        int nSkip = int(nCurrent % 16);
+        int nBlockCount = int(qMin<qint64>(BLOCK_COUNT, (nSkip + nLen - nRead + 15) / 16));
+        if (!decryptBlocks(nCurrent / 16, nBlockCount, &plain[0])) {
+            break;
+        }
+
+        int nCopy = int(qMin<qint64>(nBlockCount * 16 - nSkip, nLen - nRead));
+        memcpy(data + nRead, &plain[nSkip], nCopy);
+        nRead += nCopy;
+    }
+
+    std::fill(plain.begin(), plain.end(), 0);
+
+    return nRead > 0 ? nRead : -1;
+}
+
+qint64 CWizZiwDecryptDevice::writeData(const char* data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+
+    return -1;
+}
+
 
 CWizZiwReader::CWizZiwReader(QObject *parent)
     : QObject(parent)
     , m_bSaveUserCipher(false)
+    , m_keyCacheSalt(WizGenGUIDLowerCaseLetterOnly().toUtf8())
 {
     memset(&m_header, 0, sizeof(m_header));
+
+    m_timerKeyCache = new QTimer(this);
+    m_timerKeyCache->setInterval(60 * 1000);
+    connect(m_timerKeyCache, SIGNAL(timeout()), SLOT(on_keyCache_timeout()));
+    m_timerKeyCache->start();
+}
+
+CWizZiwReader::~CWizZiwReader()
+{
+    clearKeyCache();
+}
+
+// only a buffer not shared is wiped, fill() or data() of a shared one
+// detaches and wipes a copy. keys in cache are never shared, see below
+void CWizZiwReader::zeroize(QByteArray& data)
+{
+    if (!data.isEmpty() && data.isDetached()) {
+        memset(data.data(), 0, data.size());
+    }
+
+    data.clear();
+}
+
+void CWizZiwReader::zeroize(QString& str)
+{
+    if (!str.isEmpty() && str.isDetached()) {
+        memset(str.data(), 0, str.size() * sizeof(QChar));
+    }
+
+    str.clear();
+}
+
+QByteArray CWizZiwReader::userCipherDigest() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_keyCacheSalt);
+    hash.addData(m_userCipher.toUtf8());
+    return hash.result();
+}
+
+void CWizZiwReader::clearKeyCache()
+{
+    QMutexLocker locker(&m_mutexKeyCache);
+    clearKeyCacheLocked();
+}
+
+void CWizZiwReader::clearKeyCacheLocked()
+{
+    zeroize(m_d);
+    zeroize(m_strZiwCipher);
+
+    for (int i = 0; i < m_keyCache.size(); i++) {
+        zeroize(m_keyCache[i].second);
+    }
+
+    m_keyCache.clear();
+    m_keyCacheDigest.clear();
+    m_keyCacheUsed.invalidate();
+}
+
+void CWizZiwReader::on_keyCache_timeout()
+{
+    QMutexLocker locker(&m_mutexKeyCache);
+    if (m_keyCacheUsed.isValid() && m_keyCacheUsed.hasExpired(WIZZIW_KEY_CACHE_TIMEOUT)) {
+        clearKeyCacheLocked();
+    }
+}
+
+bool CWizZiwReader::decryptZiwCipherCached(QByteArray& ziwCipher)
+{
+    QByteArray encryptedZiwCipher((const char *)m_header.szEncryptedKey, WIZZIWFILE_KEY_LENGTH);
+
+    QMutexLocker locker(&m_mutexKeyCache);
+
+    // keys of other user cipher or idle for too long
+    QByteArray digest = userCipherDigest();
+    if (m_keyCacheDigest != digest
+            || (m_keyCacheUsed.isValid() && m_keyCacheUsed.hasExpired(WIZZIW_KEY_CACHE_TIMEOUT))) {
+        clearKeyCacheLocked();
+    }
+
+    for (int i = 0; i < m_keyCache.size(); i++) {
+        if (m_keyCache[i].first == encryptedZiwCipher) {
+            m_keyCache.move(i, 0);
+            // deep copy, so that cached key can be wiped
+            const QByteArray& cached = m_keyCache[0].second;
+            ziwCipher = QByteArray(cached.constData(), cached.size());
+            zeroize(m_strZiwCipher);
+            m_strZiwCipher = ziwCipher;
+            m_keyCacheUsed.start();
+            return true;
+        }
+    }
+
+    if (m_d.isEmpty()) {
+        if (!decryptRSAdPart(m_d)) {
+            zeroize(m_d);
+            return false;
+        }
+    }
+
+    if (!decryptZiwCipher(ziwCipher)) {
+        return false;
+    }
+
+    m_keyCacheDigest = digest;
+    m_keyCache.prepend(qMakePair(encryptedZiwCipher, QByteArray(ziwCipher.constData(), ziwCipher.size())));
+    while (m_keyCache.size() > WIZZIW_KEY_CACHE_MAX) {
+        zeroize(m_keyCache.last().second);
+        m_keyCache.removeLast();
+    }
+
+    m_keyCacheUsed.start();
+    return true;
 }
 
 bool CWizZiwReader::setFile(const QString& strFileName)
@@ -23,7 +286,7 @@ bool CWizZiwReader::setFile(const QString& strFileName)
         return false;
     }
 
-    m_strZiwCipher.clear();
+    zeroize(m_strZiwCipher);
     m_strFileName = strFileName;
     memcpy(&m_header, &header, sizeof(WIZZIWHEADER));
     return true;
@@ -73,23 +336,6 @@ bool CWizZiwReader::loadZiwHeader(const QString& strFileName, WIZZIWHEADER& head
     return true;
 }
 
-bool CWizZiwReader::loadZiwData(const QString& strFileName, QByteArray& strData)
-{
-    QFile file(strFileName);
-
-    if (!file.open(QIODevice::ReadOnly)) {
-        TOLOG("Can't open file for reading while load data");
-        return false;
-    }
-
-    file.seek(sizeof(WIZZIWHEADER));
-    strData.clear();
-    strData.append(file.readAll());
-    file.close();
-
-    return true;
-}
-
 ZiwEncryptType CWizZiwReader::encryptType()
 {
     if (!QString("ZIWR").compare(m_header.szSign, Qt::CaseSensitive)) {
@@ -107,21 +353,15 @@ bool CWizZiwReader::isFileAccessible(const QString& encryptedFile)
         return false;
     }
 
-    if (!decryptRSAdPart(m_d)) {
-        return false;
-    }
-
     QByteArray ziwCipher;
-    if(!decryptZiwCipher(ziwCipher)) {
+    if (!decryptZiwCipherCached(ziwCipher)) {
         return false;
     }
 
-    QByteArray encryptedData, rawData;
-    if (!loadZiwData(encryptedFile, encryptedData)) {
-       return false;
-    }
-
-    if (!WizAESDecryptToString((const unsigned char *)(ziwCipher.constData()), encryptedData, rawData)) {
+    // padding of last block is checked when opening
+    CWizZiwDecryptDevice device(encryptedFile, ziwCipher);
+    zeroize(ziwCipher);
+    if (!device.open(QIODevice::ReadOnly)) {
         return false;
     }
 
@@ -133,6 +373,10 @@ void CWizZiwReader::setRSAKeys(const QByteArray& strN, \
                                const QByteArray& str_encrypted_d, \
                                const QString& strHint)
 {
+    if (m_N != strN || m_e != stre || m_encrypted_d != str_encrypted_d) {
+        clearKeyCache();
+    }
+
     m_N = strN;
     m_e = stre;
     m_encrypted_d = str_encrypted_d;
@@ -210,6 +454,7 @@ bool CWizZiwReader::decryptZiwCipher(QByteArray& ziwCipher)
         return false;
     }
 
+    zeroize(m_strZiwCipher);
     m_strZiwCipher = ziwCipher;
     return true;
 }
@@ -235,6 +480,16 @@ bool CWizZiwReader::decryptZiwCipher(const QByteArray& encryptedZiwCipher, QByte
 bool CWizZiwReader::encryptDataToTempFile(const QString& sourceFileName, \
                                           const QString& destFileName)
 {
+    // wiped with key cache, decrypt it from header of current file again
+    if (m_strZiwCipher.isEmpty()) {
+        QByteArray ziwCipher;
+        bool bRet = decryptZiwCipherCached(ziwCipher);
+        zeroize(ziwCipher);
+        if (!bRet) {
+            return false;
+        }
+    }
+
     Q_ASSERT(!m_strZiwCipher.isEmpty());
 
     return encryptDataToTempFile(sourceFileName, destFileName, m_strZiwCipher);
@@ -250,13 +505,6 @@ bool CWizZiwReader::encryptDataToTempFile(const QString& sourceFileName, \
         return false;
     }
 
-    // encrypt data
-    QByteArray inBytes(sourceFile.readAll());
-    QByteArray outBytes;
-    if (!WizAESEncryptToString((const unsigned char *)(strZiwCipher.toUtf8().constData()), inBytes, outBytes)) {
-        return false;
-    }
-
     // encrypt ziw cipher
     QByteArray encryptedZiwCipher;
     if (!encryptZiwCipher(strZiwCipher.toUtf8(), encryptedZiwCipher)) {
@@ -288,7 +536,10 @@ bool CWizZiwReader::encryptDataToTempFile(const QString& sourceFileName, \
         return false;
     }
 
-    if (outBytes.length() != out.writeRawData(outBytes.constData(), outBytes.length())) {
+    // encrypt data after header, in fixed size blocks
+    QDataStream in(&sourceFile);
+    QByteArray ziwCipher = strZiwCipher.toUtf8();
+    if (!simpleAESEncrypt((const unsigned char *)ziwCipher.constData(), &in, &out, sourceFile.size())) {
         TOLOG("Write data failed while encrypt to temp file");
         destFile.remove();
         return false;
@@ -308,26 +559,21 @@ bool CWizZiwReader::decryptDataToTempFile(const QString& tempFileName)
         return false;
     }
 
-    if (!decryptRSAdPart(m_d)) {
-        return false;
-    }
-
     QByteArray ziwCipher;
-    if(!decryptZiwCipher(ziwCipher)) {
+    if (!decryptZiwCipherCached(ziwCipher)) {
         return false;
     }
 
-    QByteArray encryptedData, rawData;
-    if (!loadZiwData(m_strFileName, encryptedData)) {
-       return false;
-    }
-
-    if (!WizAESDecryptToString((const unsigned char *)(ziwCipher.constData()), encryptedData, rawData)) {
+    QFile sourceFile(m_strFileName);
+    if (!sourceFile.open(QIODevice::ReadOnly) || !sourceFile.seek(sizeof(WIZZIWHEADER))) {
+        TOLOG("Can't open file for reading while decrypt to temp file");
         return false;
     }
 
-    QDataStream out(&file);
-    if (rawData.length() != out.writeRawData(rawData.constData(), rawData.length())) {
+    // decrypt data after header, in fixed size blocks
+    QDataStream in(&sourceFile), out(&file);
+    qint64 nSize = sourceFile.size() - sizeof(WIZZIWHEADER);
+    if (!simpleAESDecrypt((const unsigned char *)ziwCipher.constData(), &in, &out, nSize)) {
         TOLOG("write data failed while decrypt to temp file");
         file.remove();
         return false;
@@ -343,6 +589,42 @@ bool CWizZiwReader::decryptDataToTempFile(const QString& tempFileName)
     return true;
 }
 
+bool CWizZiwReader::decryptDataToBuffer(QByteArray& rawData)
+{
+    QIODevice* device = decryptDataToDevice();
+    if (!device) {
+        return false;
+    }
+
+    rawData = device->readAll();
+    delete device;
+
+    return true;
+}
+
+QIODevice* CWizZiwReader::decryptDataToDevice()
+{
+    QByteArray ziwCipher;
+    if (!decryptZiwCipherCached(ziwCipher)) {
+        return NULL;
+    }
+
+    // device keeps its own expanded key
+    CWizZiwDecryptDevice* device = new CWizZiwDecryptDevice(m_strFileName, ziwCipher);
+    zeroize(ziwCipher);
+    if (!device->open(QIODevice::ReadOnly)) {
+        delete device;
+        return NULL;
+    }
+
+    // clean user cipher when done
+    if (!m_bSaveUserCipher) {
+        m_userCipher.clear();
+    }
+
+    return device;
+}
+
 
 void CWizZiwReader::debugPrintHeader()
 {
@@ -3,11 +3,23 @@
 
 #include <QPointer>
 #include <QBuffer>
+#include <QFile>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+
+class QTimer;
 
 #define WIZZIWFILE_SIGN_LENGTH      4
 #define WIZZIWFILE_KEY_LENGTH       128
 #define WIZZIWFILE_RESERVED_LENGTH  16
 
+// decrypted rsa private key and note ciphers are kept for a while, so that
+// opening protected notes needn't rsa decrypting every time
+#define WIZZIW_KEY_CACHE_TIMEOUT    (5 * 60 * 1000)
+#define WIZZIW_KEY_CACHE_MAX        64
+
 // ZiwR: RSA and AES mixed encrypt method
 // ZiwA: not supported currently
 enum ZiwEncryptType { ZiwR, ZiwA, ZiwUnknown };
@@ -21,12 +33,40 @@ struct WIZZIWHEADER
     unsigned char szReserved[WIZZIWFILE_RESERVED_LENGTH];
 };
 
+// read only view of decrypted data of ziw file. block of aes cbc only depends
+// on itself and previous cipher block, so data is decrypted at any position
+// when read, eg: by unzip, without decrypting whole file into memory
+class CWizZiwDecryptDevice : public QIODevice
+{
+public:
+    CWizZiwDecryptDevice(const QString& strFileName, const QByteArray& ziwCipher, QObject* parent = 0);
+    ~CWizZiwDecryptDevice();
+
+    virtual bool open(OpenMode mode);
+    virtual void close();
+    virtual bool isSequential() const { return false; }
+    virtual qint64 size() const { return m_nSize; }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxlen);
+    virtual qint64 writeData(const char* data, qint64 len);
+
+private:
+    QFile m_file;
+    QByteArray m_key;
+    qint64 m_nCipherSize;
+    qint64 m_nSize;
+
+    bool decryptBlocks(qint64 nBlock, int nBlockCount, unsigned char* pOut);
+};
+
 class CWizZiwReader : public QObject
 {
     Q_OBJECT
 
 public:
     explicit CWizZiwReader(QObject *parent = 0);
+    ~CWizZiwReader();
 
     const QString& userCipher() const { return m_userCipher; }
     void setUserCipher(const QString& strCipher) { m_userCipher = strCipher; }
@@ -53,12 +93,21 @@ public:
 
     // call setUserCipher and setRSAKeys before use this
     bool decryptDataToTempFile(const QString& tempFileName);
+    bool decryptDataToBuffer(QByteArray& rawData);
+    // caller should delete returned device, NULL if failed
+    QIODevice* decryptDataToDevice();
 
     ZiwEncryptType encryptType();
 
     //call setUserCipher and setRSAKeys before use this
     bool isFileAccessible(const QString& encryptedFile);
 
+    // wipe cached keys, eg: user logout
+    void clearKeyCache();
+
+private Q_SLOTS:
+    void on_keyCache_timeout();
+
 private:
     QString m_strFileName;
     WIZZIWHEADER m_header;
@@ -72,8 +121,22 @@ private:
     QByteArray m_encrypted_d;
     QString m_strHint;
 
+    // m_d and note ciphers are only valid for the user cipher of this digest
+    QMutex m_mutexKeyCache;
+    QByteArray m_keyCacheSalt;
+    QByteArray m_keyCacheDigest;
+    QElapsedTimer m_keyCacheUsed;
+    // encrypted ziw cipher in header => ziw cipher, most recently used first
+    QList<QPair<QByteArray, QByteArray> > m_keyCache;
+    QTimer* m_timerKeyCache;
+
+    QByteArray userCipherDigest() const;
+    void clearKeyCacheLocked();
+    bool decryptZiwCipherCached(QByteArray& ziwCipher);
+    static void zeroize(QByteArray& data);
+    static void zeroize(QString& str);
+
     bool loadZiwHeader(const QString& strFileName, WIZZIWHEADER& header);
-    bool loadZiwData(const QString& strFileName, QByteArray& strData);
 
     bool encryptZiwCipher(QByteArray& encryptedZiwCipher);
     bool encryptZiwCipher(const QByteArray& ziwCipher, QByteArray& encryptedZiwCipher);
@@ -1217,6 +1217,9 @@ bool CWizKMSync::UploadAttachmentList()
             return TRUE;
     }
     //
+    // files may be edited again since last change was recorded
+    m_pDatabase->RefreshModifiedAttachments();
+    //
     return UploadList<WIZDOCUMENTATTACHMENTDATAEX, false>(m_kbInfo, m_pEvents, m_pDatabase, m_server, _T("attachment"), syncUploadAttachmentList);
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////
@@ -1260,6 +1263,8 @@ bool CWizKMSync::DownloadFullDocumentList()
     //
     std::map<QString, int> mapDocumentPart;
     //
+    std::deque<WIZDOCUMENTDATAEX_XMLRPC_SIMPLE> arrayDataModified;
+    //
     for (std::deque<WIZDOCUMENTDATAEX_XMLRPC_SIMPLE>::const_iterator itNeedToBeDownloaded = m_arrayDocumentNeedToBeDownloaded.begin();
         itNeedToBeDownloaded != m_arrayDocumentNeedToBeDownloaded.end();
         itNeedToBeDownloaded++)
@@ -1274,9 +1279,7 @@ bool CWizKMSync::DownloadFullDocumentList()
         {
             part &= ~WIZKM_XMLRPC_OBJECT_PART_DATA;
             //
-            m_pDatabase->SetObjectDataDownloaded(simple.strGUID, strObjectType, false);	//////设置为未下载//////
-            m_pDatabase->SetObjectServerDataInfo(simple.strGUID, strObjectType, simple.tDataModified, simple.strDataMD5);	//////设置成服务器的修改时间和md5，等待下载//////
-            m_pDatabase->SetObjectLocalServerVersion(simple.strGUID, strObjectType, simple.nVersion);		//////设置为服务器的版本号//////
+            arrayDataModified.push_back(simple);
         }
         //
         if (0 != part)
@@ -1289,32 +1292,74 @@ bool CWizKMSync::DownloadFullDocumentList()
         if (arrayDocumentGUID.size() >= 30
             || itNeedToBeDownloaded == (m_arrayDocumentNeedToBeDownloaded.end() - 1))
         {
+            std::deque<WIZDOCUMENTDATAEX> arrayDocument;
             if (!arrayDocumentGUID.empty())
             {
                 m_pEvents->OnStatus(_TR(_T("Query notes information")));
                 //
-                std::deque<WIZDOCUMENTDATAEX> arrayDocument;
                 if (!m_server.document_downloadFullList(arrayDocumentGUID, arrayDocument))
                 {
                     TOLOG(_T("Can't download note info list!"));
                     return FALSE;
                 }
+            }
+            //
+            //////整批写入一个事务，网络请求不在事务内//////
+            if (!m_pDatabase->BeginTransaction())
+            {
+                m_pEvents->OnError(_T("Cannot begin transaction to update notes information"));
+                return FALSE;
+            }
+            //
+            for (std::deque<WIZDOCUMENTDATAEX_XMLRPC_SIMPLE>::iterator itModified = arrayDataModified.begin();
+                itModified != arrayDataModified.end();
+                itModified++)
+            {
+                m_pDatabase->SetObjectDataDownloaded(itModified->strGUID, strObjectType, false);	//////设置为未下载//////
+                m_pDatabase->SetObjectServerDataInfo(itModified->strGUID, strObjectType, itModified->tDataModified, itModified->strDataMD5);	//////设置成服务器的修改时间和md5，等待下载//////
+                m_pDatabase->SetObjectLocalServerVersion(itModified->strGUID, strObjectType, itModified->nVersion);		//////设置为服务器的版本号//////
+            }
+            //
+            for (std::deque<WIZDOCUMENTDATAEX>::const_iterator itDocument = arrayDocument.begin();
+                itDocument != arrayDocument.end();
+                itDocument++)
+            {
+                m_pEvents->OnStatus(WizFormatString1(_T("Update note information: %1"), itDocument->strTitle));
+                //
+                //////每篇笔记一个savepoint，失败时只撤销这一篇，之前的照常提交//////
+                if (!m_pDatabase->BeginTransaction())
+                {
+                    m_pDatabase->RollbackTransaction();
+                    //
+                    m_pEvents->OnError(WizFormatString1(_T("Cannot update note information: %1"), itDocument->strTitle));
+                    return FALSE;
+                }
                 //
-                for (std::deque<WIZDOCUMENTDATAEX>::const_iterator itDocument = arrayDocument.begin();
-                    itDocument != arrayDocument.end();
-                    itDocument++)
+                int nDocumentPart = mapDocumentPart[itDocument->strGUID];
+                if (!m_pDatabase->OnDownloadDocument(nDocumentPart, *itDocument))
                 {
-                    m_pEvents->OnStatus(WizFormatString1(_T("Update note information: %1"), itDocument->strTitle));
+                    m_pDatabase->RollbackTransaction();
+                    m_pDatabase->CommitTransaction();
                     //
-                    int nDocumentPart = mapDocumentPart[itDocument->strGUID];
-                    if (!m_pDatabase->OnDownloadDocument(nDocumentPart, *itDocument))
-                    {
-                        m_pEvents->OnError(WizFormatString1(_T("Cannot update note information: %1"), itDocument->strTitle));
-                        return FALSE;
-                    }
+                    m_pEvents->OnError(WizFormatString1(_T("Cannot update note information: %1"), itDocument->strTitle));
+                    return FALSE;
+                }
+                //
+                if (!m_pDatabase->CommitTransaction())
+                {
+                    m_pDatabase->RollbackTransaction();
+                    //
+                    m_pEvents->OnError(WizFormatString1(_T("Cannot update note information: %1"), itDocument->strTitle));
+                    return FALSE;
                 }
             }
             //
+            if (!m_pDatabase->CommitTransaction())
+            {
+                m_pEvents->OnError(_T("Cannot save notes information"));
+                return FALSE;
+            }
+            //
             int index = int(itNeedToBeDownloaded - m_arrayDocumentNeedToBeDownloaded.begin());
             //
             double fPos = index / double(total) * size;
@@ -1322,6 +1367,7 @@ bool CWizKMSync::DownloadFullDocumentList()
             //
             arrayDocumentGUID.clear();
             mapDocumentPart.clear();
+            arrayDataModified.clear();
         }
     }
     //
@@ -1370,36 +1416,49 @@ bool CWizKMSync::DownloadObjectData()
     size_t succeeded = 0;
     //
     size_t nCount = arrayObject.size();
-    for (size_t i = 0; i < nCount; i++)
+    for (size_t i = 0; i < nCount; i += WIZKM_DATA_OBJECTS_IN_FLIGHT)
     {
         if (m_pEvents->IsStop())
             return FALSE;
         //
-        WIZOBJECTDATA data = arrayObject[i];
+        // download a group of objects at the same time, small objects don't
+        // wait for each other's round trip
+        CWizObjectDataArray arrayGroup;
+        for (size_t k = i; k < nCount && k < i + WIZKM_DATA_OBJECTS_IN_FLIGHT; k++)
+        {
+            arrayGroup.push_back(arrayObject[k]);
+        }
         //
-        QString strMsgFormat = data.eObjectType == wizobjectDocument ? _TR("Downloading note: %1"): _TR("Downloading attachment: %1");
-        QString strStatus = WizFormatString1(strMsgFormat, data.strDisplayName);
+        const WIZOBJECTDATA& first = arrayGroup.front();
+        QString strMsgFormat = first.eObjectType == wizobjectDocument ? _TR("Downloading note: %1"): _TR("Downloading attachment: %1");
+        QString strStatus = WizFormatString1(strMsgFormat, first.strDisplayName);
         m_pEvents->OnStatus(strStatus);
         //
-        QByteArray stream;
-        if (m_server.data_download(data.strObjectGUID, WIZOBJECTDATA::ObjectTypeToTypeString(data.eObjectType), stream, data.strDisplayName))
+        std::vector<bool> arraySucceeded;
+        m_server.data_downloadList(arrayGroup, arraySucceeded);
+        //
+        for (size_t k = 0; k < arrayGroup.size(); k++)
         {
-            if (m_pDatabase->UpdateObjectData(data.strObjectGUID, WIZOBJECTDATA::ObjectTypeToTypeString(data.eObjectType), stream))
+            const WIZOBJECTDATA& data = arrayGroup[k];
+            if (arraySucceeded[k])
             {
-                succeeded++;
+                if (m_pDatabase->UpdateObjectData(data.strObjectGUID, WIZOBJECTDATA::ObjectTypeToTypeString(data.eObjectType), data.arrayData))
+                {
+                    succeeded++;
+                }
+                else
+                {
+                    m_pEvents->OnError(WizFormatString1(_T("Cannot save object data to local: %1!"), data.strDisplayName));
+                }
             }
             else
             {
-                m_pEvents->OnError(WizFormatString1(_T("Cannot save object data to local: %1!"), data.strDisplayName));
+                m_pEvents->OnError(WizFormatString1(_T("Cannot download object data from server: %1"), data.strDisplayName));
             }
         }
-        else
-        {
-            m_pEvents->OnError(WizFormatString1(_T("Cannot download object data from server: %1"), data.strDisplayName));
-        }
         //
         //
-        int index = (int)i;
+        int index = int(i + arrayGroup.size());
         //
         double fPos = index / double(total) * size;
         m_pEvents->OnSyncProgress(start + int(fPos));
@@ -112,17 +112,29 @@ private:
     template <class TData>
     bool OnDownloadList(const std::deque<WIZDELETEDGUIDDATA>& arrayData)
     {
-        return m_pDatabase->OnDownloadDeletedList(arrayData);
+        if (!m_pDatabase->BeginTransaction())
+            return false;
+        //
+        bool bRet = m_pDatabase->OnDownloadDeletedList(arrayData);
+        return m_pDatabase->CommitTransaction() && bRet;
     }
     template <class TData>
     bool OnDownloadList(const std::deque<WIZTAGDATA>& arrayData)
     {
-        return m_pDatabase->OnDownloadTagList(arrayData);
+        if (!m_pDatabase->BeginTransaction())
+            return false;
+        //
+        bool bRet = m_pDatabase->OnDownloadTagList(arrayData);
+        return m_pDatabase->CommitTransaction() && bRet;
     }
     template <class TData>
     bool OnDownloadList(const std::deque<WIZSTYLEDATA>& arrayData)
     {
-        return m_pDatabase->OnDownloadStyleList(arrayData);
+        if (!m_pDatabase->BeginTransaction())
+            return false;
+        //
+        bool bRet = m_pDatabase->OnDownloadStyleList(arrayData);
+        return m_pDatabase->CommitTransaction() && bRet;
     }
     template <class TData>
     bool OnDownloadList(const std::deque<WIZDOCUMENTDATAEX>& arrayData)
@@ -135,7 +147,11 @@ private:
     template <class TData>
     bool OnDownloadList(const std::deque<WIZDOCUMENTATTACHMENTDATAEX>& arrayData)
     {
-        return m_pDatabase->OnDownloadAttachmentList(arrayData);
+        if (!m_pDatabase->BeginTransaction())
+            return false;
+        //
+        bool bRet = m_pDatabase->OnDownloadAttachmentList(arrayData);
+        return m_pDatabase->CommitTransaction() && bRet;
     }
 };
 
@@ -10,8 +10,10 @@
 CWizXmlRpcEventLoop::CWizXmlRpcEventLoop(QNetworkReply* pReply, QObject *parent /*= 0*/)
     : QEventLoop(parent)
     , m_error(QNetworkReply::NoError)
+    , m_bFinished(false)
 {
     connect(pReply, SIGNAL(finished()), SLOT(on_replyFinished()));
+    connect(pReply, SIGNAL(readyRead()), SLOT(on_replyReadyRead()));
     connect(pReply, SIGNAL(error(QNetworkReply::NetworkError)), SLOT(on_replyError(QNetworkReply::NetworkError)));
 }
 
@@ -32,7 +34,7 @@ void CWizXmlRpcEventLoop::doFinished(QNetworkReply* reply)
         return;
     }
 
-    m_result = QString::fromUtf8(reply->readAll().constData());
+    m_reader.addData(reply->readAll());
 
 }
 
@@ -46,15 +48,31 @@ void CWizXmlRpcEventLoop::on_replyFinished()
     QNetworkReply* reply = qobject_cast<QNetworkReply *>(sender());
     //
     doFinished(reply);
+    m_bFinished = true;
 
     reply->deleteLater();
     //
     quit();
 }
 
+void CWizXmlRpcEventLoop::on_replyReadyRead()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply->error())
+        return;
+
+    // leave it to doFinished() if it is not xml
+    QString strContentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+    if (strContentType != "text/xml;charset=UTF-8")
+        return;
+
+    m_reader.addData(reply->readAll());
+}
+
 void CWizXmlRpcEventLoop::on_replyError(QNetworkReply::NetworkError error)
 {
     doError(error);
+    m_bFinished = true;
     //
     quit();
 }
@@ -98,12 +116,7 @@ bool CWizXmlRpcServerBase::xmlRpcCall(const QString& strMethodName, CWizXmlRpcRe
         data.addParam(pParam4);
     }
 
-    QNetworkRequest request;
-    request.setUrl(QUrl(m_strUrl));
-    request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("text/xml"));
-    //
-
-    QNetworkReply* reply = m_network->post(request, data.toData());
+    QNetworkReply* reply = xmlRpcPost(data);
     CWizXmlRpcEventLoop loop(reply);
     loop.exec();
     //
@@ -114,29 +127,86 @@ bool CWizXmlRpcServerBase::xmlRpcCall(const QString& strMethodName, CWizXmlRpcRe
         return false;
     }
     //
-    QString strXml = loop.result();
+    return xmlRpcResultFromReader(strMethodName, loop.reader(), result);
+}
+
+bool CWizXmlRpcServerBase::xmlRpcCallBatch(const QString& strMethodName, const std::vector<CWizXmlRpcValue*>& arrayParam, std::vector<CWizXmlRpcResult*>& arrayResult)
+{
+    // QNetworkAccessManager open up to 6 connections to the same host
+    std::vector<CWizXmlRpcEventLoop*> arrayLoop;
+    for (size_t i = 0; i < arrayParam.size(); i++)
+    {
+        CWizXmlRpcRequest data(strMethodName);
+        data.addParam(arrayParam[i]);
+        //
+        arrayLoop.push_back(new CWizXmlRpcEventLoop(xmlRpcPost(data)));
+    }
     //
-    CWizXMLDocument doc;
-    if (!doc.LoadXML(strXml)) {
+    bool bRet = true;
+    for (size_t i = 0; i < arrayLoop.size(); i++)
+    {
+        CWizXmlRpcEventLoop* loop = arrayLoop[i];
+        if (!loop->isFinished())
+        {
+            loop->exec();
+        }
+        //
+        CWizXmlRpcResult* pResult = new CWizXmlRpcResult();
+        if (loop->error())
+        {
+            m_nLastErrorCode = loop->error();
+            m_strLastErrorMessage = loop->errorString();
+            delete pResult;
+            pResult = NULL;
+        }
+        else if (!xmlRpcResultFromReader(strMethodName, loop->reader(), *pResult))
+        {
+            delete pResult;
+            pResult = NULL;
+        }
+        //
+        if (!pResult)
+        {
+            bRet = false;
+        }
+        //
+        arrayResult.push_back(pResult);
+        delete loop;
+    }
+    //
+    return bRet;
+}
+
+QNetworkReply* CWizXmlRpcServerBase::xmlRpcPost(CWizXmlRpcRequest& data)
+{
+    QNetworkRequest request;
+    request.setUrl(QUrl(m_strUrl));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("text/xml"));
+    //
+    return m_network->post(request, data.toData());
+}
+
+bool CWizXmlRpcServerBase::xmlRpcResultFromReader(const QString& strMethodName, CWizXmlRpcResultReader& reader, CWizXmlRpcResult& result)
+{
+    if (reader.hasError()) {
         m_nLastErrorCode = -1;
         m_strLastErrorMessage = "Invalid xml";
         return false;
     }
 
-    CWizXmlRpcValue* pRet = NULL;
+    CWizXmlRpcValue* pRet = reader.takeResult();
 
-    if (!WizXmlRpcResultFromXml(doc, &pRet)) {
+    if (!pRet) {
         m_nLastErrorCode = -1;
         m_strLastErrorMessage = "Can not parse xmlrpc";
         return false;
     }
 
-    Q_ASSERT(pRet);
-
     if (CWizXmlRpcFaultValue* pFault = dynamic_cast<CWizXmlRpcFaultValue *>(pRet)) {
         m_nLastErrorCode = pFault->GetFaultCode();
         m_strLastErrorMessage = pFault->GetFaultString();
         TOLOG2(_T("XmlRpcCall failed : %1, %2"), QString::number(m_nLastErrorCode), m_strLastErrorMessage);
+        delete pRet;
         return false;
     }
     //
@@ -6,6 +6,8 @@
 #include <QEventLoop>
 #include <QNetworkReply>
 
+#include <vector>
+
 #include "../share/wizxmlrpc.h"
 #include "../share/wizmisc.h"
 #include "../utils/logger.h"
@@ -18,9 +20,10 @@ class CWizXmlRpcEventLoop : public QEventLoop
 public:
     explicit CWizXmlRpcEventLoop(QNetworkReply* pReply, QObject *parent = 0);
 private:
-    QString m_result;
+    CWizXmlRpcResultReader m_reader;
     QNetworkReply::NetworkError m_error;
     QString m_errorString;
+    bool m_bFinished;
 
 private:
     void doFinished(QNetworkReply* pReply);
@@ -29,10 +32,14 @@ private:
 public:
     QNetworkReply::NetworkError error() { return m_error; }
     QString errorString() { return m_errorString; }
-    QString result() { return m_result; }
+    // response is parsed while downloading
+    CWizXmlRpcResultReader& reader() { return m_reader; }
+    // reply may finished before exec() called, eg: waiting for another one
+    bool isFinished() const { return m_bFinished; }
 
 public Q_SLOTS:
     void on_replyFinished();
+    void on_replyReadyRead();
     void on_replyError(QNetworkReply::NetworkError);
 };
 
@@ -61,6 +68,13 @@ protected:
     BOOL GetReturnValueInStringMap(const QString& strMethodName, std::map<QString, QString>& mapRet, const QString& strName, QString& strValue);
     //
     bool xmlRpcCall(const QString& strMethodName, CWizXmlRpcResult& result, CWizXmlRpcValue* pParam1, CWizXmlRpcValue* pParam2 = NULL, CWizXmlRpcValue* pParam3 = NULL, CWizXmlRpcValue* pParam4 = NULL);
+    // post one call per param at once and wait for all replies, so round
+    // trips are overlapped. results are filled by index, NULL if that call
+    // failed, caller should delete them
+    bool xmlRpcCallBatch(const QString& strMethodName, const std::vector<CWizXmlRpcValue*>& arrayParam, std::vector<CWizXmlRpcResult*>& arrayResult);
+    //
+    QNetworkReply* xmlRpcPost(CWizXmlRpcRequest& data);
+    bool xmlRpcResultFromReader(const QString& strMethodName, CWizXmlRpcResultReader& reader, CWizXmlRpcResult& result);
     BOOL Call(const QString& strMethodName, CWizXmlRpcValue* pParam1, CWizXmlRpcValue* pParam2 = NULL, CWizXmlRpcValue* pParam3 = NULL, CWizXmlRpcValue* pParam4 = NULL);
     BOOL Call(const QString& strMethodName, CWizXmlRpcResult& ret, CWizXmlRpcValue* pParam1, CWizXmlRpcValue* pParam2 = NULL, CWizXmlRpcValue* pParam3 = NULL, CWizXmlRpcValue* pParam4 = NULL);
     BOOL Call(const QString& strMethodName, std::map<QString, QString>& mapRet, CWizXmlRpcValue* pParam1, CWizXmlRpcValue* pParam2 = NULL, CWizXmlRpcValue* pParam3 = NULL, CWizXmlRpcValue* pParam4 = NULL);
@@ -1,5 +1,13 @@
 #include "wizkmxmlrpc.h"
 
+#include <QTime>
+
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentMap>
+#endif
+
 #define WIZUSERMESSAGE_AT		0
 #define WIZUSERMESSAGE_EDIT		1
 
@@ -570,6 +578,9 @@ BOOL CWizKMAccountsServer::accounts_getMessages(int nCountPerPage, __int64 nVers
 CWizKMDatabaseServer::CWizKMDatabaseServer(const WIZUSERINFOBASE& kbInfo, QObject* parent)
     : CWizKMXmlRpcServerBase(kbInfo.strDatabaseServer, parent)
     , m_kbInfo(kbInfo)
+    , m_nDownloadPartSize(WIZKM_DATA_PART_SIZE_DEFAULT)
+    , m_nUploadPartSize(WIZKM_DATA_PART_SIZE_DEFAULT)
+    , m_nDownloadPartSizeMax(WIZKM_DATA_PART_SIZE_MAX)
 {
 }
 CWizKMDatabaseServer::~CWizKMDatabaseServer()
@@ -1119,16 +1130,18 @@ BOOL CWizKMDatabaseServer::data_download(const QString& strObjectGUID, const QSt
 struct CWizKMDataUploadParam
     : public CWizKMTokenOnlyParam
 {
-    CWizKMDataUploadParam(const QString& strToken, const QString& strBookGUID, const QString& strObjectGUID, const QString& strObjectType, const QString& strObjectMD5, int allSize, int partCount, int partIndex, const QByteArray& stream)
+    CWizKMDataUploadParam(const QString& strToken, const QString& strBookGUID, const QString& strObjectGUID, const QString& strObjectType, const QString& strObjectMD5, int allSize, int partCount, int partIndex, const QByteArray& stream, const QString& strPartMD5 = QString())
         : CWizKMTokenOnlyParam(strToken, strBookGUID)
     {
+        Q_UNUSED(allSize);
+        //
         AddString(_T("obj_guid"), strObjectGUID);
         AddString(_T("obj_type"), strObjectType);
         AddString(_T("obj_md5"), strObjectMD5);
         AddInt(_T("part_count"), partCount);
         AddInt(_T("part_sn"), partIndex);
         AddInt64(_T("part_size"), stream.size());
-        AddString(_T("part_md5"), ::WizMd5StringNoSpaceJava(stream));
+        AddString(_T("part_md5"), strPartMD5.isEmpty() ? ::WizMd5StringNoSpaceJava(stream) : strPartMD5);
         AddBase64(_T("data"), stream);
     }
 };
@@ -1156,42 +1169,239 @@ BOOL CWizKMDatabaseServer::data_upload(const QString& strObjectGUID, const QStri
 }
 
 
+struct WIZKMDATAPARTTASK
+{
+    int nObjectIndex;
+    int nPos;
+    int nSize;
+    //
+    // download: part returned by server, upload: part to be posted
+    WIZKMDATAPART part;
+    QString strPartMD5;
+    bool bSucceeded;
+    //
+    WIZKMDATAPARTTASK(int index = 0, int pos = 0, int size = 0)
+        : nObjectIndex(index)
+        , nPos(pos)
+        , nSize(size)
+        , bSucceeded(false)
+    {
+    }
+};
+
+// run by thread pool, not by the thread waiting for network
+static void WizKMVerifyDataPart(WIZKMDATAPARTTASK& task)
+{
+    if (!task.bSucceeded)
+        return;
+    //
+    __int64 nStreamSize = task.part.stream.size();
+    if (task.part.nPartSize != nStreamSize)
+    {
+        TOLOG2(_T("part size does not match: stream_size=%1, part_size=%2"), WizInt64ToStr(nStreamSize), WizInt64ToStr(task.part.nPartSize));
+        task.bSucceeded = false;
+        return;
+    }
+    //
+    QString strStreamMD5 = WizMd5StringNoSpaceJava(task.part.stream);
+    if (0 != strStreamMD5.compare(task.part.strPartMD5, Qt::CaseInsensitive))
+    {
+        TOLOG2(_T("part md5 does not match, stream_md5=%1, part_md5=%2"), strStreamMD5, task.part.strPartMD5);
+        task.bSucceeded = false;
+    }
+}
+
+static void WizKMCalDataPartMD5(WIZKMDATAPARTTASK& task)
+{
+    task.strPartMD5 = WizMd5StringNoSpaceJava(task.part.stream);
+}
+
+void CWizKMDatabaseServer::UpdatePartSize(int& nPartSize, int nPartSizeMax, qint64 nBytes, int nMilliseconds)
+{
+    if (nMilliseconds <= 0 || nBytes <= 0)
+        return;
+    //
+    // a window of parts in flight should take about one second
+    qint64 nBytesPerSecond = nBytes * 1000 / nMilliseconds;
+    qint64 nSize = nBytesPerSecond / WIZKM_DATA_PARTS_IN_FLIGHT;
+    //
+    nSize = (nPartSize + nSize) / 2;
+    nPartSize = (int)qBound<qint64>(WIZKM_DATA_PART_SIZE_MIN, nSize, qMax(WIZKM_DATA_PART_SIZE_MIN, nPartSizeMax));
+}
+
 BOOL CWizKMDatabaseServer::data_download(const QString& strObjectGUID, const QString& strObjectType, QByteArray& stream, const QString& strDisplayName)
 {
     stream.clear();
     //
-    int nAllSize = 0;
-    int startPos = 0;
-    while (1)
+    WIZOBJECTDATA data;
+    data.strObjectGUID = strObjectGUID;
+    data.eObjectType = WIZOBJECTDATA::TypeStringToObjectType(strObjectType);
+    data.strDisplayName = strDisplayName;
+    //
+    CWizObjectDataArray arrayObject;
+    arrayObject.push_back(data);
+    //
+    std::vector<bool> arraySucceeded;
+    if (!data_downloadList(arrayObject, arraySucceeded))
+        return FALSE;
+    //
+    stream = arrayObject[0].arrayData;
+    return TRUE;
+}
+
+BOOL CWizKMDatabaseServer::data_downloadList(CWizObjectDataArray& arrayObject, std::vector<bool>& arraySucceeded)
+{
+    int nCount = (int)arrayObject.size();
+    arraySucceeded.assign(nCount, true);
+    //
+    // pos => part data, parts may arrive out of order
+    std::vector<std::map<int, QByteArray> > arrayParts(nCount);
+    std::vector<__int64> arrayAllSize(nCount, 0);
+    std::vector<__int64> arrayDownloaded(nCount, 0);
+    //
+    // first part of every object, the size of object is unknown until then
+    std::deque<WIZKMDATAPARTTASK> queue;
+    for (int i = 0; i < nCount; i++)
+    {
+        arrayObject[i].arrayData.clear();
+        queue.push_back(WIZKMDATAPARTTASK(i, 0, m_nDownloadPartSize));
+    }
+    //
+    while (!queue.empty())
     {
-        int partSize = 500 * 1000;
+        QVector<WIZKMDATAPARTTASK> window;
+        while (!queue.empty() && window.size() < WIZKM_DATA_PARTS_IN_FLIGHT)
+        {
+            WIZKMDATAPARTTASK task = queue.front();
+            queue.pop_front();
+            //
+            if (arraySucceeded[task.nObjectIndex])
+            {
+                window.append(task);
+            }
+        }
+        //
+        if (window.isEmpty())
+            break;
         //
-        BOOL bEOF = FALSE;
-        if (!data_download(strObjectGUID, strObjectType, startPos, partSize, stream, nAllSize, bEOF))
+        std::vector<CWizXmlRpcValue*> arrayParam;
+        for (int i = 0; i < window.size(); i++)
         {
-            TOLOG(WizFormatString1(_T("Failed to download object part data: %1"), strDisplayName));
-            return FALSE;
+            const WIZOBJECTDATA& data = arrayObject[window[i].nObjectIndex];
+            arrayParam.push_back(new CWizKMDataDownloadParam(m_kbInfo.strToken, m_kbInfo.strKbGUID, data.strObjectGUID,
+                                                             WIZOBJECTDATA::ObjectTypeToTypeString(data.eObjectType),
+                                                             window[i].nPos, window[i].nSize));
         }
         //
-        int nDownloadedSize = stream.size();
+        QTime timer;
+        timer.start();
         //
-        if (bEOF)
-            break;
+        std::vector<CWizXmlRpcResult*> arrayResult;
+        xmlRpcCallBatch(_T("data.download"), arrayParam, arrayResult);
         //
-        startPos = nDownloadedSize;
-
-        emit downloadProgress(nAllSize, nDownloadedSize);
+        qint64 nBytes = 0;
+        for (int i = 0; i < window.size(); i++)
+        {
+            CWizXmlRpcValue* pValue = arrayResult[i] ? arrayResult[i]->GetResultValue<CWizXmlRpcValue>() : NULL;
+            window[i].bSucceeded = pValue && pValue->ToData<WIZKMDATAPART>(window[i].part);
+            nBytes += window[i].part.stream.size();
+            //
+            delete arrayParam[i];
+            delete arrayResult[i];
+        }
+        //
+        UpdatePartSize(m_nDownloadPartSize, m_nDownloadPartSizeMax, nBytes, timer.elapsed());
+        //
+        QtConcurrent::blockingMap(window, WizKMVerifyDataPart);
+        //
+        for (int i = 0; i < window.size(); i++)
+        {
+            const WIZKMDATAPARTTASK& task = window[i];
+            int index = task.nObjectIndex;
+            const WIZOBJECTDATA& data = arrayObject[index];
+            if (!task.bSucceeded)
+            {
+                TOLOG(WizFormatString1(_T("Failed to download object part data: %1"), data.strDisplayName));
+                arraySucceeded[index] = false;
+                continue;
+            }
+            //
+            int nPartSize = task.part.stream.size();
+            arrayParts[index][task.nPos] = task.part.stream;
+            arrayDownloaded[index] += nPartSize;
+            //
+            __int64 nAllSize = task.part.nObjectSize;
+            int nEnd = task.nPos + task.nSize;
+            if (task.nPos == 0)
+            {
+                arrayAllSize[index] = nAllSize;
+                nEnd = (int)nAllSize;
+            }
+            //
+            if (task.part.bEOF || task.nPos + nPartSize >= nAllSize)
+                continue;
+            //
+            if (0 == nPartSize)
+            {
+                TOLOG1(_T("Empty part data: %1"), data.strDisplayName);
+                arraySucceeded[index] = false;
+                continue;
+            }
+            //
+            // server limited part size, don't ask more than that
+            if (nPartSize < task.nSize)
+            {
+                m_nDownloadPartSizeMax = qMin(m_nDownloadPartSizeMax, nPartSize);
+                m_nDownloadPartSize = qMin(m_nDownloadPartSize, m_nDownloadPartSizeMax);
+            }
+            //
+            // rest of this part, or the whole object if it's the first part
+            nEnd = qMin<int>(nEnd, (int)nAllSize);
+            for (int pos = task.nPos + nPartSize; pos < nEnd; pos += m_nDownloadPartSize)
+            {
+                queue.push_back(WIZKMDATAPARTTASK(index, pos, qMin(m_nDownloadPartSize, nEnd - pos)));
+            }
+        }
+        //
+        if (nCount == 1)
+        {
+            emit downloadProgress((int)arrayAllSize[0], (int)arrayDownloaded[0]);
+        }
     }
     //
-    __int64 nStreamSize = stream.size();
-    if (nStreamSize != nAllSize)
+    BOOL bRet = TRUE;
+    for (int i = 0; i < nCount; i++)
     {
-        TOLOG3(_T("Failed to download object data: %1, stream_size=%2, object_size=%3"), strDisplayName, WizInt64ToStr(nStreamSize), WizInt64ToStr(nAllSize));
-        return FALSE;
+        WIZOBJECTDATA& data = arrayObject[i];
+        if (arraySucceeded[i])
+        {
+            std::map<int, QByteArray>::const_iterator it;
+            for (it = arrayParts[i].begin(); it != arrayParts[i].end(); it++)
+            {
+                if (it->first != data.arrayData.size())
+                    break;
+                //
+                data.arrayData.append(it->second);
+            }
+            //
+            __int64 nStreamSize = data.arrayData.size();
+            if (nStreamSize != arrayAllSize[i])
+            {
+                TOLOG3(_T("Failed to download object data: %1, stream_size=%2, object_size=%3"), data.strDisplayName, WizInt64ToStr(nStreamSize), WizInt64ToStr(arrayAllSize[i]));
+                arraySucceeded[i] = false;
+            }
+        }
+        //
+        if (!arraySucceeded[i])
+        {
+            data.arrayData.clear();
+            bRet = FALSE;
+        }
     }
     //
-    return TRUE;
+    return bRet;
 }
+
 BOOL CWizKMDatabaseServer::data_upload(const QString& strObjectGUID, const QString& strObjectType, const QByteArray& stream, const QString& strObjMD5, const QString& strDisplayName)
 {
     __int64 nStreamSize = stream.size();
@@ -1203,39 +1413,77 @@ BOOL CWizKMDatabaseServer::data_upload(const QString& strObjectGUID, const QStri
     //
     QString strMD5(strObjMD5);
     //
-    QByteArray spPartStream;
-    //
-    int partSize = 500 * 1000;
+    // part count is posted with every part, so part size is fixed for the
+    // whole object
+    int partSize = m_nUploadPartSize;
     int partCount = int(nStreamSize / partSize);
     if (nStreamSize % partSize != 0)
     {
         partCount++;
     }
     //
+    QVector<WIZKMDATAPARTTASK> arrayPart;
     for (int i = 0; i < partCount; i++)
     {
-        spPartStream.clear();
-
         int start = i * partSize;
         int end = std::min<int>(start + partSize, int(nStreamSize));
         ATLASSERT(end > start);
         //
-        int curPartSize = end - start;
-        ATLASSERT(curPartSize <= partSize);
+        WIZKMDATAPARTTASK task(i, start, end - start);
+        task.part.stream = QByteArray::fromRawData(stream.data() + start, end - start);
+        arrayPart.append(task);
+    }
+    //
+    // md5 of parts computed by thread pool
+    QtConcurrent::blockingMap(arrayPart, WizKMCalDataPartMD5);
+    //
+    // server completes the object once the last part arrived, post it after
+    // all the others succeeded
+    int i = 0;
+    while (i < partCount - 1)
+    {
+        int nWindow = std::min<int>(WIZKM_DATA_PARTS_IN_FLIGHT, partCount - 1 - i);
+        //
+        std::vector<CWizXmlRpcValue*> arrayParam;
+        qint64 nBytes = 0;
+        for (int k = i; k < i + nWindow; k++)
+        {
+            const WIZKMDATAPARTTASK& task = arrayPart[k];
+            arrayParam.push_back(new CWizKMDataUploadParam(m_kbInfo.strToken, m_kbInfo.strKbGUID, strObjectGUID, strObjectType, strMD5,
+                                                           (int)nStreamSize, partCount, k, task.part.stream, task.strPartMD5));
+            nBytes += task.nSize;
+        }
+        //
+        QTime timer;
+        timer.start();
         //
-        const char* begin = stream.data() + start;
-        spPartStream = spPartStream.fromRawData(begin, curPartSize);
+        std::vector<CWizXmlRpcResult*> arrayResult;
+        BOOL bRet = xmlRpcCallBatch(_T("data.upload"), arrayParam, arrayResult);
         //
-        int curPartStreamSize = (int)spPartStream.size();
-        ATLASSERT(curPartStreamSize == curPartSize);
+        for (size_t k = 0; k < arrayParam.size(); k++)
+        {
+            delete arrayParam[k];
+            delete arrayResult[k];
+        }
         //
-        if (!data_upload(strObjectGUID, strObjectType, strMD5, (int)nStreamSize, partCount, i, curPartSize, spPartStream))
+        if (!bRet)
         {
             TOLOG1(_T("Failed to upload part data: %1"), strDisplayName);
             return FALSE;
         }
+        //
+        UpdatePartSize(m_nUploadPartSize, WIZKM_DATA_PART_SIZE_MAX, nBytes, timer.elapsed());
+        i += nWindow;
     }
     //
+    const WIZKMDATAPARTTASK& last = arrayPart[partCount - 1];
+    CWizKMDataUploadParam param(m_kbInfo.strToken, m_kbInfo.strKbGUID, strObjectGUID, strObjectType, strMD5,
+                                (int)nStreamSize, partCount, partCount - 1, last.part.stream, last.strPartMD5);
+    if (!Call(_T("data.upload"), &param))
+    {
+        TOLOG1(_T("Failed to upload part data: %1"), strDisplayName);
+        return FALSE;
+    }
     //
     return TRUE;
 }
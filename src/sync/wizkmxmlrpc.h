@@ -8,6 +8,14 @@
 #define WIZKM_XMLRPC_ERROR_BIZ_SERVICE_EXPR		380
 #define WIZKM_XMLRPC_ERROR_BIZ_NOTE_COUNT_LIMIT		3032
 
+// object data transfer: parts posted at once, objects downloaded together
+// and bounds of part size which is adapted to measured throughput
+#define WIZKM_DATA_PARTS_IN_FLIGHT      4
+#define WIZKM_DATA_OBJECTS_IN_FLIGHT    8
+#define WIZKM_DATA_PART_SIZE_DEFAULT    (500 * 1000)
+#define WIZKM_DATA_PART_SIZE_MIN        (100 * 1000)
+#define WIZKM_DATA_PART_SIZE_MAX        (2 * 1000 * 1000)
+
 class CWizKMXmlRpcServerBase : public CWizXmlRpcServerBase
 {
 public:
@@ -155,6 +163,12 @@ public:
 
 protected:
     WIZUSERINFOBASE m_kbInfo;
+    int m_nDownloadPartSize;
+    int m_nUploadPartSize;
+    // server may return less than requested, don't ask more than that
+    int m_nDownloadPartSizeMax;
+
+    void UpdatePartSize(int& nPartSize, int nPartSizeMax, qint64 nBytes, int nMilliseconds);
 
 public:
     QString GetToken() const { return m_kbInfo.strToken; }
@@ -190,6 +204,9 @@ public:
     BOOL category_getAll(QString& str);
 
     BOOL data_download(const QString& strObjectGUID, const QString& strObjectType, QByteArray& stream, const QString& strDisplayName);
+    // download data of several objects together, arrayData of each object is
+    // filled. return false if any failed, see arraySucceeded for each one
+    BOOL data_downloadList(CWizObjectDataArray& arrayObject, std::vector<bool>& arraySucceeded);
     BOOL data_upload(const QString& strObjectGUID, const QString& strObjectType, const QByteArray& stream, const QString& strObjMD5, const QString& strDisplayName);
     //
     BOOL GetValueVersion(const QString& strKey, __int64& nVersion);
@@ -1,11 +1,7 @@
 #include "thumbcache.h"
 #include "thumbcache_p.h"
 
-#if QT_VERSION > 0x050000
-#include <QtConcurrent>
-#else
-#include <QtConcurrentRun>
-#endif
+#include <QDebug>
 
 #include "share/wizDatabaseManager.h"
 #include "share/wizDatabase.h"
@@ -13,86 +9,349 @@
 using namespace Core;
 using namespace Core::Internal;
 
-#define THUMB_CACHE_MAX 10000
+// budget of decoded thumbs in bytes
+#define THUMB_CACHE_MAX_COST (32 * 1024 * 1024)
+// max requests waiting in loader, lowest priority dropped first
+#define THUMB_QUEUE_MAX 512
+// max notes read from thumb db by one query
+#define THUMB_BATCH_SIZE 32
 
 
-ThumbCachePrivate::ThumbCachePrivate(ThumbCache* cache)
-    : q(cache)
+ThumbLoaderThread::ThumbLoaderThread(ThumbCachePrivate* cache)
+    : m_cache(cache)
+    , m_stop(false)
 {
-    connect(CWizDatabaseManager::instance(), SIGNAL(documentAbstractModified(const WIZDOCUMENTDATA&)),
-            SLOT(onNoteThumbChanged(const WIZDOCUMENTDATA&)));
-    connect(this, SIGNAL(thumbLoaded(const QString&, const QString&)),
-            cache, SIGNAL(loaded(const QString&, const QString&)));
 }
 
-QString ThumbCachePrivate::key(const QString& strKbGUID, const QString& strGUID)
+void ThumbLoaderThread::request(const ThumbKey& key, Priority priority)
 {
-    return strKbGUID + "::" + strGUID;
+    QMutexLocker locker(&m_mutex);
+    if (m_setPending.contains(key))
+        return;
+
+    // cancelled while loading, wanted again
+    if (m_setLoading.contains(key)) {
+        m_setPending.insert(key);
+        return;
+    }
+
+    enqueue(key, priority);
+    m_waitForData.wakeAll();
 }
 
-bool ThumbCachePrivate::find(const QString& strKbGUID, const QString& strGUID, WIZABSTRACT& abs)
+void ThumbLoaderThread::reload(const ThumbKey& key)
 {
-    QString strKey(key(strKbGUID, strGUID));
-    if (m_mapThumb.contains(strKey)) {
-        abs = m_mapThumb.value(strKey);
-        return true;
+    QMutexLocker locker(&m_mutex);
+    if (m_setLoading.contains(key)) {
+        m_setDirty.insert(key);
+        m_setPending.insert(key);
+        return;
+    }
+
+    if (m_setPending.contains(key))
+        return;
+
+    enqueue(key, PriorityVisible);
+    m_waitForData.wakeAll();
+}
+
+void ThumbLoaderThread::prefetch(const QList<ThumbKey>& listVisible, const QList<ThumbKey>& listAhead)
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (int i = 0; i < PriorityCount; i++) {
+        foreach (const ThumbKey& key, m_queue[i]) {
+            m_setPending.remove(key);
+        }
+        m_queue[i].clear();
     }
 
-    if (m_mapThumb.size() >= THUMB_CACHE_MAX) {
-        m_mapThumb.clear();
-        qDebug() << "[ThumCache]pool is full, clear...";
+    // notes being loaded are cancelled too if not wanted any more, loader
+    // skip rendering their abstracts
+    QSet<ThumbKey> setWanted = listVisible.toSet() + listAhead.toSet();
+    QSet<ThumbKey> setCancelled = m_setPending - setWanted;
+    m_setPending -= setCancelled;
+
+    foreach (const ThumbKey& key, listVisible) {
+        if (!m_setPending.contains(key)) {
+            enqueue(key, PriorityVisible);
+        }
     }
 
-    load(strKbGUID, strGUID);
-    return false;
+    foreach (const ThumbKey& key, listAhead) {
+        if (!m_setPending.contains(key)) {
+            enqueue(key, PriorityAhead);
+        }
+    }
+
+    m_waitForData.wakeAll();
 }
 
-void ThumbCachePrivate::load(const QString& strKbGUID, const QString& strGUID)
+void ThumbLoaderThread::enqueue(const ThumbKey& key, Priority priority)
 {
-    QtConcurrent::run(this, &ThumbCachePrivate::load_impl, strKbGUID, strGUID);
+    int nCount = 0;
+    for (int i = 0; i < PriorityCount; i++) {
+        nCount += m_queue[i].size();
+    }
+
+    if (nCount >= THUMB_QUEUE_MAX) {
+        int i = PriorityCount - 1;
+        while (i > priority && m_queue[i].isEmpty()) {
+            i--;
+        }
+
+        // full of more important requests
+        if (m_queue[i].isEmpty())
+            return;
+
+        // drop lower priority one first, then the oldest one of the same
+        ThumbKey keyDropped = (i > priority) ? m_queue[i].takeLast() : m_queue[i].takeFirst();
+        m_setPending.remove(keyDropped);
+    }
+
+    m_queue[priority].append(key);
+    m_setPending.insert(key);
+}
+
+void ThumbLoaderThread::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stop = true;
+    m_waitForData.wakeAll();
+}
+
+void ThumbLoaderThread::waitForDone()
+{
+    stop();
+    wait();
+}
+
+bool ThumbLoaderThread::cancelLoad(const ThumbKey& key)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_setPending.contains(key))
+        return false;
+
+    // requested again later is queued as usual
+    m_setLoading.remove(key);
+    m_setDirty.remove(key);
+    return true;
+}
+
+bool ThumbLoaderThread::isStopped()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stop;
 }
 
-void ThumbCachePrivate::load_impl(const QString& strKbGUID, const QString& strGUID)
+bool ThumbLoaderThread::finishLoad(const ThumbKey& key)
 {
+    QMutexLocker locker(&m_mutex);
+    m_setLoading.remove(key);
+
+    if (m_setDirty.remove(key)) {
+        // load again if still wanted
+        if (m_setPending.remove(key)) {
+            enqueue(key, PriorityVisible);
+        }
+        return false;
+    }
+
+    m_setPending.remove(key);
+    return true;
+}
+
+bool ThumbLoaderThread::peekBatch(QString& strKbGUID, CWizStdStringArray& arrayGUID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_stop) {
+        for (int i = 0; i < PriorityCount; i++) {
+            QList<ThumbKey>::iterator it = m_queue[i].begin();
+            while (it != m_queue[i].end() && arrayGUID.size() < THUMB_BATCH_SIZE) {
+                if (strKbGUID.isEmpty()) {
+                    strKbGUID = it->first;
+                }
+
+                if (it->first == strKbGUID) {
+                    arrayGUID.push_back(it->second);
+                    m_setLoading.insert(*it);
+                    it = m_queue[i].erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+
+        if (!arrayGUID.empty())
+            return true;
+
+        m_waitForData.wait(&m_mutex);
+    }
+
+    return false;
+}
+
+void ThumbLoaderThread::loadBatch(const QString& strKbGUID, const CWizStdStringArray& arrayGUID)
+{
+    CWizStdStringArray::const_iterator it;
+
     if (!CWizDatabaseManager::instance()->isOpened(strKbGUID)) {
         qDebug() << "[ThumbCache]discard for invalid kb: " << strKbGUID;
+        for (it = arrayGUID.begin(); it != arrayGUID.end(); it++) {
+            finishLoad(ThumbKey(strKbGUID, *it));
+        }
         return;
     }
 
-    WIZABSTRACT abs;
     CWizDatabase& db = CWizDatabaseManager::instance()->db(strKbGUID);
 
-    bool bUpdated = false;
+    std::map<CString, WIZABSTRACT> mapAbstract;
+    db.PadAbstractsFromGUID(arrayGUID, mapAbstract);
+
+    for (it = arrayGUID.begin(); it != arrayGUID.end(); it++) {
+        if (isStopped())
+            return;
 
-    // update if not exist
-    if (db.PadAbstractFromGUID(strGUID, abs)) {
-        bUpdated = false;
-    } else {
-        qDebug() << "[ThumbCache]thumb not exist, try update: " << strGUID;
-        if (db.UpdateDocumentAbstract(strGUID)) {
-            bUpdated = true;
+        const CString& strGUID = *it;
+        ThumbKey key(strKbGUID, strGUID);
+
+        WIZABSTRACT abs;
+        std::map<CString, WIZABSTRACT>::const_iterator itAbs = mapAbstract.find(strGUID);
+        if (itAbs != mapAbstract.end()) {
+            abs = itAbs->second;
         } else {
-            bUpdated = false;
+            // update if not exist, it's expensive, skip if scrolled away
+            if (cancelLoad(key))
+                continue;
+
+            qDebug() << "[ThumbCache]thumb not exist, try update: " << strGUID;
+            if (db.UpdateDocumentAbstract(strGUID) && !db.PadAbstractFromGUID(strGUID, abs)) {
+                qDebug() << "[ThumCache]failed to load thumb from db: " << strGUID;
+            }
+        }
+
+        abs.strKbGUID = strKbGUID;
+        if (abs.text.isEmpty()) {
+            abs.text = " ";
         }
+
+        if (finishLoad(key)) {
+            m_cache->insert(strKbGUID, strGUID, abs);
+        }
+    }
+}
+
+void ThumbLoaderThread::run()
+{
+    while (true) {
+        QString strKbGUID;
+        CWizStdStringArray arrayGUID;
+        if (!peekBatch(strKbGUID, arrayGUID))
+            return;
+
+        loadBatch(strKbGUID, arrayGUID);
+    }
+}
+
+
+
+ThumbCachePrivate::ThumbCachePrivate(ThumbCache* cache)
+    : m_cacheThumb(THUMB_CACHE_MAX_COST)
+    , m_nHits(0)
+    , m_nMisses(0)
+    , q(cache)
+{
+    connect(CWizDatabaseManager::instance(), SIGNAL(documentAbstractModified(const WIZDOCUMENTDATA&)),
+            SLOT(onNoteThumbChanged(const WIZDOCUMENTDATA&)));
+    connect(this, SIGNAL(thumbLoaded(const QString&, const QString&)),
+            cache, SIGNAL(loaded(const QString&, const QString&)));
+
+    m_loader = new ThumbLoaderThread(this);
+    m_loader->start();
+}
+
+ThumbCachePrivate::~ThumbCachePrivate()
+{
+    m_loader->waitForDone();
+    delete m_loader;
+}
+
+QString ThumbCachePrivate::key(const QString& strKbGUID, const QString& strGUID)
+{
+    return strKbGUID + "::" + strGUID;
+}
+
+bool ThumbCachePrivate::find(const QString& strKbGUID, const QString& strGUID, WIZABSTRACT& abs)
+{
+    QString strKey(key(strKbGUID, strGUID));
+
+    QMutexLocker locker(&m_mutex);
+    // object() also move it to the head of lru list
+    if (WIZABSTRACT* pAbs = m_cacheThumb.object(strKey)) {
+        abs = *pAbs;
+        m_nHits++;
+        return true;
     }
 
-    // load again if updated
-    if (bUpdated && !db.PadAbstractFromGUID(strGUID, abs)) {
-        qDebug() << "[ThumCache]failed to load thumb from db: " << strGUID;
+    m_nMisses++;
+    locker.unlock();
+
+    // being painted, load it first
+    m_loader->request(ThumbKey(strKbGUID, strGUID), ThumbLoaderThread::PriorityVisible);
+    return false;
+}
+
+void ThumbCachePrivate::prefetch(const QList<ThumbKey>& listVisible, const QList<ThumbKey>& listAhead)
+{
+    QList<ThumbKey> listVisibleMissed;
+    QList<ThumbKey> listAheadMissed;
+
+    QMutexLocker locker(&m_mutex);
+    foreach (const ThumbKey& k, listVisible) {
+        if (!m_cacheThumb.contains(key(k.first, k.second))) {
+            listVisibleMissed.append(k);
+        }
     }
 
-    abs.strKbGUID = strKbGUID;
-    if (abs.text.isEmpty()) {
-        abs.text = " ";
+    foreach (const ThumbKey& k, listAhead) {
+        if (!m_cacheThumb.contains(key(k.first, k.second))) {
+            listAheadMissed.append(k);
+        }
     }
+    locker.unlock();
+
+    m_loader->prefetch(listVisibleMissed, listAheadMissed);
+}
+
+void ThumbCachePrivate::insert(const QString& strKbGUID, const QString& strGUID, const WIZABSTRACT& abs)
+{
+    int nCost = abs.image.byteCount() + abs.text.size() * sizeof(QChar) + sizeof(WIZABSTRACT);
+
+    QMutexLocker locker(&m_mutex);
+    m_cacheThumb.insert(key(strKbGUID, strGUID), new WIZABSTRACT(abs), nCost);
+    locker.unlock();
 
-    m_mapThumb.insert(key(strKbGUID, strGUID), abs);
     Q_EMIT thumbLoaded(strKbGUID, strGUID);
 }
 
+void ThumbCachePrivate::statistics(qint64& nHits, qint64& nMisses, int& nCost)
+{
+    QMutexLocker locker(&m_mutex);
+    nHits = m_nHits;
+    nMisses = m_nMisses;
+    nCost = m_cacheThumb.totalCost();
+}
+
 void ThumbCachePrivate::onNoteThumbChanged(const WIZDOCUMENTDATA& data)
 {
-    load(data.strKbGUID, data.strGUID);
+    // drop the old one, reloaded if it's still on the screen, otherwise
+    // loaded again when scrolled back
+    QMutexLocker locker(&m_mutex);
+    m_cacheThumb.remove(key(data.strKbGUID, data.strGUID));
+    locker.unlock();
+
+    m_loader->reload(ThumbKey(data.strKbGUID, data.strGUID));
 }
 
 
@@ -123,3 +382,13 @@ bool ThumbCache::find(const QString& strKbGUID, const QString& strGUID, WIZABSTR
 {
     return d->find(strKbGUID, strGUID, abs);
 }
+
+void ThumbCache::prefetch(const QList<ThumbKey>& listVisible, const QList<ThumbKey>& listAhead)
+{
+    d->prefetch(listVisible, listAhead);
+}
+
+void ThumbCache::statistics(qint64& nHits, qint64& nMisses, int& nCost)
+{
+    d->statistics(nHits, nMisses, nCost);
+}
@@ -2,6 +2,8 @@
 #define CORE_THUMBCACHE_H
 
 #include <QObject>
+#include <QPair>
+#include <QList>
 
 struct WIZABSTRACT;
 
@@ -10,6 +12,9 @@ namespace Internal{
 class ThumbCachePrivate;
 }
 
+// kb guid, note guid
+typedef QPair<QString, QString> ThumbKey;
+
 class ThumbCache : public QObject
 {
     Q_OBJECT
@@ -21,6 +26,13 @@ public:
     static ThumbCache* instance();
     static bool find(const QString& strKbGUID, const QString& strGUID, WIZABSTRACT& abs);
 
+    // load thumbs of visible notes first, then notes ahead in the scroll
+    // direction. queued loads of other notes are cancelled
+    static void prefetch(const QList<ThumbKey>& listVisible, const QList<ThumbKey>& listAhead);
+
+    // cache hits, misses and bytes used since started
+    static void statistics(qint64& nHits, qint64& nMisses, int& nCost);
+
 Q_SIGNALS:
     void loaded(const QString& strKbGUID, const QString& strGUID);
 
@@ -2,17 +2,72 @@
 #define THUMBCACHE_P_H
 
 #include <QObject>
-#include <QMap>
+#include <QThread>
+#include <QCache>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
 
-
-struct WIZABSTRACT;
-struct WIZDOCUMENTDATA;
+#include "share/wizobject.h"
+#include "thumbcache.h"
 
 namespace Core {
-class ThumbCache;
 
 namespace Internal{
 
+class ThumbCachePrivate;
+
+class ThumbLoaderThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        PriorityVisible,
+        PriorityAhead,
+        PriorityCount
+    };
+
+    ThumbLoaderThread(ThumbCachePrivate* cache);
+
+    // queue a load, do nothing if the note is queued or being loaded
+    void request(const ThumbKey& key, Priority priority);
+    // thumb changed, load again even if it's being loaded
+    void reload(const ThumbKey& key);
+    // replace queue with given notes, others are cancelled
+    void prefetch(const QList<ThumbKey>& listVisible, const QList<ThumbKey>& listAhead);
+
+    void waitForDone();
+
+protected:
+    virtual void run();
+
+private:
+    void stop();
+    void enqueue(const ThumbKey& key, Priority priority);
+    // block until requests arrived, batch is made of notes in the same kb
+    bool peekBatch(QString& strKbGUID, CWizStdStringArray& arrayGUID);
+    void loadBatch(const QString& strKbGUID, const CWizStdStringArray& arrayGUID);
+    // give up loading a note not wanted any more, false if it's still pending
+    bool cancelLoad(const ThumbKey& key);
+    bool isStopped();
+    // false if thumb changed while loading, it's queued again and the
+    // stale result should be discarded
+    bool finishLoad(const ThumbKey& key);
+
+    ThumbCachePrivate* m_cache;
+    QMutex m_mutex;
+    QWaitCondition m_waitForData;
+    QList<ThumbKey> m_queue[PriorityCount];
+    // queued or being loaded
+    QSet<ThumbKey> m_setPending;
+    // taken by loader thread
+    QSet<ThumbKey> m_setLoading;
+    // changed while being loaded
+    QSet<ThumbKey> m_setDirty;
+    bool m_stop;
+};
+
 
 class ThumbCachePrivate : public QObject
 {
@@ -20,12 +75,17 @@ class ThumbCachePrivate : public QObject
 
 public:
     ThumbCachePrivate(ThumbCache* cache);
+    ~ThumbCachePrivate();
+
     bool find(const QString& strKbGUID, const QString& strGUID, WIZABSTRACT& abs);
+    void prefetch(const QList<ThumbKey>& listVisible, const QList<ThumbKey>& listAhead);
+    void statistics(qint64& nHits, qint64& nMisses, int& nCost);
+
+    // called by loader thread
+    void insert(const QString& strKbGUID, const QString& strGUID, const WIZABSTRACT& abs);
 
 private:
     QString key(const QString& strKbGUID, const QString& strGUID);
-    void load(const QString& strKbGUID, const QString& strGUID);
-    void load_impl(const QString& strKbGUID, const QString& strGUID);
 
 protected Q_SLOTS:
     void onNoteThumbChanged(const WIZDOCUMENTDATA& data);
@@ -34,7 +94,14 @@ Q_SIGNALS:
     void thumbLoaded(const QString& strKbGUID, const QString& strGUID);
 
 private:
-    QMap<QString, WIZABSTRACT> m_mapThumb;
+    // find() is called from main thread while insert() from loader thread,
+    // guard the cache and counters
+    QMutex m_mutex;
+    // lru, cost is decoded bytes of thumb
+    QCache<QString, WIZABSTRACT> m_cacheThumb;
+    qint64 m_nHits;
+    qint64 m_nMisses;
+    ThumbLoaderThread* m_loader;
     ThumbCache* q;
 };
 
@@ -0,0 +1,603 @@
+#include "wizDocumentListModel.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+
+#include "share/wizDatabaseManager.h"
+#include "share/wizDatabase.h"
+#include "wizPopupButton.h"
+
+template <class T>
+static int WizCompareValue(const T& v1, const T& v2)
+{
+    if (v1 < v2)
+        return -1;
+    else if (v2 < v1)
+        return 1;
+
+    return 0;
+}
+
+static QString WizDateTimeToHumanFriendlyString(qint64 t)
+{
+    return COleDateTime(QDateTime::fromMSecsSinceEpoch(t)).toHumanFriendlyString();
+}
+
+
+int CWizDocumentListModel::WIZSTRINGPOOL::intern(const QString& str)
+{
+    QHash<QString, int>::const_iterator it = index.find(str);
+    if (it != index.end())
+        return it.value();
+
+    int n = strings.size();
+    strings.append(str);
+    index.insert(str, n);
+    return n;
+}
+
+
+CWizDocumentListModel::CWizDocumentListModel(CWizDatabaseManager& dbMgr, QObject* parent)
+    : QAbstractListModel(parent)
+    , m_dbMgr(dbMgr)
+    , m_nSortingType(CWizSortingPopupButton::SortingCreateTime)
+{
+    m_strPersonalKbGUID = m_dbMgr.db().kbGUID();
+}
+
+int CWizDocumentListModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_rows.size();
+}
+
+QVariant CWizDocumentListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size())
+        return QVariant();
+
+    if (role == Qt::DisplayRole)
+        return title(index.row());
+
+    return QVariant();
+}
+
+Qt::ItemFlags CWizDocumentListModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid())
+        return 0;
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
+}
+
+void CWizDocumentListModel::setSortingType(int type)
+{
+    if (type == m_nSortingType)
+        return;
+
+    Q_EMIT layoutAboutToBeChanged();
+
+    // keep selection and current item
+    QModelIndexList listFrom = persistentIndexList();
+    QVector<int> arraySlot;
+    foreach (const QModelIndex& index, listFrom) {
+        arraySlot.push_back(slotAt(index.row()));
+    }
+
+    m_nSortingType = type;
+    m_arrayInfo.fill(QString());
+
+    prepareSortingKeys();
+    std::sort(m_rows.begin(), m_rows.end(), SlotLessThan(this));
+
+    QVector<int> arrayRowOfSlot(m_arrayGUID.size(), -1);
+    for (int i = 0; i < m_rows.size(); i++) {
+        arrayRowOfSlot[m_rows.at(i)] = i;
+    }
+
+    QModelIndexList listTo;
+    foreach (int nSlot, arraySlot) {
+        listTo.append(index(arrayRowOfSlot.at(nSlot)));
+    }
+
+    changePersistentIndexList(listFrom, listTo);
+
+    Q_EMIT layoutChanged();
+}
+
+void CWizDocumentListModel::setDocuments(const CWizDocumentDataArray& arrayDocument)
+{
+    beginResetModel();
+
+    m_arrayGUID.clear();
+    m_arrayTitle.clear();
+    m_arrayKbGUID.clear();
+    m_arrayLocation.clear();
+    m_arrayOwner.clear();
+    m_arrayCreated.clear();
+    m_arrayModified.clear();
+    m_arrayFlags.clear();
+    m_arrayTags.clear();
+    m_arraySize.clear();
+    m_arrayInfo.clear();
+
+    m_poolKbGUID.clear();
+    m_poolLocation.clear();
+    m_poolOwner.clear();
+
+    m_arrayFreeSlot.clear();
+    m_hashSlot.clear();
+    m_rows.clear();
+
+    m_hashSlot.reserve(int(arrayDocument.size()));
+    m_rows.reserve(int(arrayDocument.size()));
+
+    CWizDocumentDataArray::const_iterator it;
+    for (it = arrayDocument.begin(); it != arrayDocument.end(); it++) {
+        if (m_hashSlot.contains(it->strGUID))
+            continue;
+
+        m_rows.push_back(allocSlot(*it));
+    }
+
+    prepareSortingKeys();
+    std::sort(m_rows.begin(), m_rows.end(), SlotLessThan(this));
+
+    endResetModel();
+}
+
+void CWizDocumentListModel::addDocuments(const CWizDocumentDataArray& arrayDocument)
+{
+    if (m_rows.isEmpty()) {
+        setDocuments(arrayDocument);
+        return;
+    }
+
+    CWizDocumentDataArray::const_iterator it;
+    for (it = arrayDocument.begin(); it != arrayDocument.end(); it++) {
+        addDocument(*it);
+    }
+}
+
+int CWizDocumentListModel::addDocument(const WIZDOCUMENTDATA& doc)
+{
+    if (m_hashSlot.contains(doc.strGUID)) {
+        updateDocument(doc);
+        return documentRow(doc.strGUID);
+    }
+
+    int nSlot = allocSlot(doc);
+    int row = insertPosition(nSlot);
+
+    beginInsertRows(QModelIndex(), row, row);
+    m_rows.insert(row, nSlot);
+    endInsertRows();
+
+    return row;
+}
+
+bool CWizDocumentListModel::updateDocument(const WIZDOCUMENTDATA& doc)
+{
+    int nSlot = m_hashSlot.value(doc.strGUID, -1);
+    if (-1 == nSlot)
+        return false;
+
+    // located by sorting key before modified
+    int row = rowOfSlot(nSlot);
+    setSlot(nSlot, doc);
+
+    bool bOrdered = (row == 0 || lessThan(m_rows.at(row - 1), nSlot))
+            && (row + 1 == m_rows.size() || lessThan(nSlot, m_rows.at(row + 1)));
+
+    int rowNew = row;
+    if (!bOrdered) {
+        m_rows.remove(row);
+        rowNew = insertPosition(nSlot);
+        m_rows.insert(row, nSlot);
+    }
+
+    if (rowNew != row) {
+        // destination is counted before the row is taken out
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), rowNew > row ? rowNew + 1 : rowNew);
+        m_rows.remove(row);
+        m_rows.insert(rowNew, nSlot);
+        endMoveRows();
+    }
+
+    QModelIndex indexNew = index(rowNew);
+    Q_EMIT dataChanged(indexNew, indexNew);
+    return true;
+}
+
+bool CWizDocumentListModel::removeDocument(const QString& strGUID)
+{
+    int nSlot = m_hashSlot.value(strGUID, -1);
+    if (-1 == nSlot)
+        return false;
+
+    int row = rowOfSlot(nSlot);
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.remove(row);
+    endRemoveRows();
+
+    freeSlot(nSlot);
+    return true;
+}
+
+void CWizDocumentListModel::clear()
+{
+    setDocuments(CWizDocumentDataArray());
+}
+
+int CWizDocumentListModel::documentRow(const QString& strGUID) const
+{
+    int nSlot = m_hashSlot.value(strGUID, -1);
+    if (-1 == nSlot)
+        return -1;
+
+    return rowOfSlot(nSlot);
+}
+
+WIZDOCUMENTDATA CWizDocumentListModel::document(int row) const
+{
+    int nSlot = slotAt(row);
+
+    WIZDOCUMENTDATA doc;
+    if (m_dbMgr.db(kbGUID(row)).DocumentFromGUID(m_arrayGUID.at(nSlot), doc))
+        return doc;
+
+    // deleted meanwhile
+    doc.strKbGUID = kbGUID(row);
+    doc.strGUID = m_arrayGUID.at(nSlot);
+    doc.strTitle = m_arrayTitle.at(nSlot);
+    doc.strLocation = m_poolLocation.strings.at(m_arrayLocation.at(nSlot));
+    doc.strOwner = m_poolOwner.strings.at(m_arrayOwner.at(nSlot));
+    doc.tCreated = QDateTime::fromMSecsSinceEpoch(m_arrayCreated.at(nSlot));
+    doc.tModified = QDateTime::fromMSecsSinceEpoch(m_arrayModified.at(nSlot));
+    doc.nProtected = isProtected(row) ? 1 : 0;
+    return doc;
+}
+
+QString CWizDocumentListModel::documentGUID(int row) const
+{
+    return m_arrayGUID.at(slotAt(row));
+}
+
+QString CWizDocumentListModel::kbGUID(int row) const
+{
+    return m_poolKbGUID.strings.at(m_arrayKbGUID.at(slotAt(row)));
+}
+
+QString CWizDocumentListModel::title(int row) const
+{
+    return m_arrayTitle.at(slotAt(row));
+}
+
+QString CWizDocumentListModel::authorId(int row) const
+{
+    return m_poolOwner.strings.at(m_arrayOwner.at(slotAt(row)));
+}
+
+QString CWizDocumentListModel::info(int row) const
+{
+    int nSlot = slotAt(row);
+
+    const QString& strCached = m_arrayInfo.at(nSlot);
+    if (!strCached.isNull())
+        return strCached;
+
+    QString strInfo;
+    QString strCreated = WizDateTimeToHumanFriendlyString(m_arrayCreated.at(nSlot));
+    QString strModified = WizDateTimeToHumanFriendlyString(m_arrayModified.at(nSlot));
+
+    if (m_arrayFlags.at(nSlot) & flagGroup) {
+        switch (m_nSortingType) {
+        case CWizSortingPopupButton::SortingCreateTime:
+        case -CWizSortingPopupButton::SortingCreateTime:
+            strInfo = strCreated;
+            break;
+        case CWizSortingPopupButton::SortingUpdateTime:
+        case -CWizSortingPopupButton::SortingUpdateTime:
+        case CWizSortingPopupButton::SortingTitle:
+        case -CWizSortingPopupButton::SortingTitle:
+            strInfo = strModified;
+            break;
+        case CWizSortingPopupButton::SortingTag:
+        case -CWizSortingPopupButton::SortingTag:
+        case CWizSortingPopupButton::SortingLocation:
+        case -CWizSortingPopupButton::SortingLocation:
+            strInfo = tags(nSlot);
+            break;
+        case CWizSortingPopupButton::SortingSize:
+        case -CWizSortingPopupButton::SortingSize:
+            if (size(nSlot) <= 0) {
+                strInfo = QObject::tr("Unknown");
+            } else {
+                strInfo = ::WizGetFileSizeHumanReadalbe(documentFileName(nSlot));
+            }
+            break;
+        default:
+            Q_ASSERT(0);
+            break;
+        }
+    } else {
+        switch (m_nSortingType) {
+        case CWizSortingPopupButton::SortingCreateTime:
+        case -CWizSortingPopupButton::SortingCreateTime:
+            strInfo = strCreated + " " + tags(nSlot);
+            break;
+        case CWizSortingPopupButton::SortingUpdateTime:
+        case -CWizSortingPopupButton::SortingUpdateTime:
+        case CWizSortingPopupButton::SortingTitle:
+        case -CWizSortingPopupButton::SortingTitle:
+        case CWizSortingPopupButton::SortingTag:
+        case -CWizSortingPopupButton::SortingTag:
+            strInfo = strModified + " " + tags(nSlot);
+            break;
+        case CWizSortingPopupButton::SortingLocation:
+        case -CWizSortingPopupButton::SortingLocation:
+            strInfo = ::WizLocation2Display(location(nSlot));
+            break;
+        case CWizSortingPopupButton::SortingSize:
+        case -CWizSortingPopupButton::SortingSize:
+            if (size(nSlot) <= 0) {
+                strInfo = QObject::tr("Unknown") + " " + tags(nSlot);
+            } else {
+                strInfo = ::WizGetFileSizeHumanReadalbe(documentFileName(nSlot)) + " " + tags(nSlot);
+            }
+            break;
+        default:
+            Q_ASSERT(0);
+            break;
+        }
+    }
+
+    // null means not cached
+    if (strInfo.isNull())
+        strInfo = "";
+
+    m_arrayInfo[nSlot] = strInfo;
+    return strInfo;
+}
+
+int CWizDocumentListModel::itemType(int row) const
+{
+    return (m_arrayFlags.at(slotAt(row)) & flagGroup) ? TypeGroupDocument : TypePrivateDocument;
+}
+
+bool CWizDocumentListModel::isProtected(int row) const
+{
+    return m_arrayFlags.at(slotAt(row)) & flagProtected;
+}
+
+bool CWizDocumentListModel::isContainsAttachment(int row) const
+{
+    return m_arrayFlags.at(slotAt(row)) & flagAttachment;
+}
+
+bool CWizDocumentListModel::isUnread(int row) const
+{
+    return m_arrayFlags.at(slotAt(row)) & flagUnread;
+}
+
+bool CWizDocumentListModel::isSpecialFocused(int row) const
+{
+    return m_arrayFlags.at(slotAt(row)) & flagSpecialFocused;
+}
+
+void CWizDocumentListModel::setSpecialFocused(const QString& strGUID, bool bSpecialFocused)
+{
+    int nSlot = m_hashSlot.value(strGUID, -1);
+    if (-1 == nSlot)
+        return;
+
+    if (bSpecialFocused) {
+        m_arrayFlags[nSlot] |= flagSpecialFocused;
+    } else {
+        m_arrayFlags[nSlot] &= ~flagSpecialFocused;
+    }
+}
+
+int CWizDocumentListModel::allocSlot(const WIZDOCUMENTDATA& doc)
+{
+    int nSlot;
+    if (!m_arrayFreeSlot.isEmpty()) {
+        nSlot = m_arrayFreeSlot.last();
+        m_arrayFreeSlot.pop_back();
+    } else {
+        nSlot = m_arrayGUID.size();
+        m_arrayGUID.push_back(QString());
+        m_arrayTitle.push_back(QString());
+        m_arrayKbGUID.push_back(0);
+        m_arrayLocation.push_back(0);
+        m_arrayOwner.push_back(0);
+        m_arrayCreated.push_back(0);
+        m_arrayModified.push_back(0);
+        m_arrayFlags.push_back(0);
+        m_arrayTags.push_back(QString());
+        m_arraySize.push_back(-1);
+        m_arrayInfo.push_back(QString());
+    }
+
+    m_arrayFlags[nSlot] = 0;
+    setSlot(nSlot, doc);
+    m_hashSlot.insert(doc.strGUID, nSlot);
+
+    return nSlot;
+}
+
+void CWizDocumentListModel::setSlot(int nSlot, const WIZDOCUMENTDATA& doc)
+{
+    Q_ASSERT(!doc.strKbGUID.isEmpty());
+    Q_ASSERT(!doc.strGUID.isEmpty());
+
+    bool bGroup = !doc.strKbGUID.isEmpty() && doc.strKbGUID != m_strPersonalKbGUID;
+
+    m_arrayGUID[nSlot] = doc.strGUID;
+    m_arrayTitle[nSlot] = doc.strTitle;
+    m_arrayKbGUID[nSlot] = m_poolKbGUID.intern(doc.strKbGUID);
+    m_arrayLocation[nSlot] = m_poolLocation.intern(doc.strLocation);
+    // author avatar is only drawn for group documents
+    m_arrayOwner[nSlot] = m_poolOwner.intern(bGroup ? doc.strOwner : QString());
+    m_arrayCreated[nSlot] = doc.tCreated.toMSecsSinceEpoch();
+    m_arrayModified[nSlot] = doc.tModified.toMSecsSinceEpoch();
+
+    quint8 nFlags = m_arrayFlags.at(nSlot) & flagSpecialFocused;
+    if (doc.nProtected)
+        nFlags |= flagProtected;
+    if (doc.nAttachmentCount > 0)
+        nFlags |= flagAttachment;
+    if (bGroup)
+        nFlags |= flagGroup;
+    if (bGroup && doc.nReadCount == 0)
+        nFlags |= flagUnread;
+    m_arrayFlags[nSlot] = nFlags;
+
+    m_arrayTags[nSlot] = QString();
+    m_arraySize[nSlot] = -1;
+    m_arrayInfo[nSlot] = QString();
+}
+
+void CWizDocumentListModel::freeSlot(int nSlot)
+{
+    m_hashSlot.remove(m_arrayGUID.at(nSlot));
+
+    m_arrayGUID[nSlot] = QString();
+    m_arrayTitle[nSlot] = QString();
+    m_arrayFlags[nSlot] = 0;
+    m_arrayTags[nSlot] = QString();
+    m_arrayInfo[nSlot] = QString();
+
+    m_arrayFreeSlot.push_back(nSlot);
+}
+
+int CWizDocumentListModel::slotAt(int row) const
+{
+    Q_ASSERT(row >= 0 && row < m_rows.size());
+    return m_rows.at(row);
+}
+
+int CWizDocumentListModel::rowOfSlot(int nSlot) const
+{
+    QVector<int>::const_iterator it = std::lower_bound(m_rows.begin(), m_rows.end(),
+                                                       nSlot, SlotLessThan(this));
+    if (it != m_rows.end() && *it == nSlot)
+        return it - m_rows.begin();
+
+    // sorting key changed behind us, eg: note file size
+    return m_rows.indexOf(nSlot);
+}
+
+int CWizDocumentListModel::insertPosition(int nSlot) const
+{
+    QVector<int>::const_iterator it = std::upper_bound(m_rows.begin(), m_rows.end(),
+                                                       nSlot, SlotLessThan(this));
+    return it - m_rows.begin();
+}
+
+void CWizDocumentListModel::prepareSortingKeys() const
+{
+    // read keys from database once before sorting rather than while comparing
+    int nSlotCount = m_arrayGUID.size();
+    switch (qAbs(m_nSortingType)) {
+    case CWizSortingPopupButton::SortingTag:
+        for (int i = 0; i < nSlotCount; i++) {
+            if (!m_arrayGUID.at(i).isEmpty())
+                tags(i);
+        }
+        break;
+    case CWizSortingPopupButton::SortingSize:
+        for (int i = 0; i < nSlotCount; i++) {
+            if (!m_arrayGUID.at(i).isEmpty())
+                size(i);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+bool CWizDocumentListModel::lessThan(int nSlot1, int nSlot2) const
+{
+    int nCompare = 0;
+    switch (qAbs(m_nSortingType)) {
+    case CWizSortingPopupButton::SortingCreateTime:
+        nCompare = WizCompareValue(m_arrayCreated.at(nSlot1), m_arrayCreated.at(nSlot2));
+        break;
+    case CWizSortingPopupButton::SortingUpdateTime:
+        nCompare = WizCompareValue(m_arrayModified.at(nSlot1), m_arrayModified.at(nSlot2));
+        break;
+    case CWizSortingPopupButton::SortingTitle:
+        nCompare = m_arrayTitle.at(nSlot1).localeAwareCompare(m_arrayTitle.at(nSlot2));
+        break;
+    case CWizSortingPopupButton::SortingLocation:
+        nCompare = location(nSlot1).localeAwareCompare(location(nSlot2));
+        break;
+    case CWizSortingPopupButton::SortingTag:
+        nCompare = WizCompareValue(tags(nSlot1), tags(nSlot2));
+        break;
+    case CWizSortingPopupButton::SortingSize:
+        nCompare = WizCompareValue(size(nSlot1), size(nSlot2));
+        break;
+    default:
+        Q_ASSERT(0);
+        break;
+    }
+
+    // equal keys still need a fixed order, rows are searched by binary search
+    if (0 == nCompare)
+        return m_arrayGUID.at(nSlot1) < m_arrayGUID.at(nSlot2);
+
+    // larger first, reversed by negative sorting type
+    return m_nSortingType > 0 ? nCompare > 0 : nCompare < 0;
+}
+
+const QString& CWizDocumentListModel::tags(int nSlot) const
+{
+    QString& strTags = m_arrayTags[nSlot];
+    if (!strTags.isNull())
+        return strTags;
+
+    CWizDatabase& db = m_dbMgr.db(m_poolKbGUID.strings.at(m_arrayKbGUID.at(nSlot)));
+    if (m_arrayFlags.at(nSlot) & flagGroup) {
+        strTags = "/" + db.name() + db.GetDocumentTagTreeDisplayString(m_arrayGUID.at(nSlot));
+    } else {
+        strTags = db.GetDocumentTagDisplayNameText(m_arrayGUID.at(nSlot));
+    }
+
+    // null means not cached
+    if (strTags.isNull())
+        strTags = "";
+
+    return strTags;
+}
+
+qint64 CWizDocumentListModel::size(int nSlot) const
+{
+    qint64& nSize = m_arraySize[nSlot];
+    if (-1 == nSize) {
+        QFileInfo fi(documentFileName(nSlot));
+        nSize = fi.exists() ? fi.size() : 0;
+    }
+
+    return nSize;
+}
+
+QString CWizDocumentListModel::location(int nSlot) const
+{
+    // the same as second line of item
+    if (m_arrayFlags.at(nSlot) & flagGroup)
+        return tags(nSlot);
+
+    return ::WizLocation2Display(m_poolLocation.strings.at(m_arrayLocation.at(nSlot)));
+}
+
+QString CWizDocumentListModel::documentFileName(int nSlot) const
+{
+    CWizDatabase& db = m_dbMgr.db(m_poolKbGUID.strings.at(m_arrayKbGUID.at(nSlot)));
+    return db.GetDocumentFileName(m_arrayGUID.at(nSlot));
+}
@@ -0,0 +1,139 @@
+#ifndef WIZDOCUMENTLISTMODEL_H
+#define WIZDOCUMENTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+#include "share/wizobject.h"
+
+class CWizDatabaseManager;
+
+/*
+ * Notes of document list, one column per field rather than one object per
+ * note, strings repeated by many notes (kb guid, location, owner) are pooled.
+ *
+ * Rows are a sorted permutation of note slots, so a row is located by binary
+ * search with the sorting key of its note, and notes created, modified or
+ * deleted are moved in place instead of sorting the whole list again.
+ */
+class CWizDocumentListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum ItemType {
+        TypePrivateDocument,
+        TypeGroupDocument
+    };
+
+    explicit CWizDocumentListModel(CWizDatabaseManager& dbMgr, QObject* parent = 0);
+
+    virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex& index, int role) const;
+    virtual Qt::ItemFlags flags(const QModelIndex& index) const;
+
+    int sortingType() const { return m_nSortingType; }
+    void setSortingType(int type);
+
+    void setDocuments(const CWizDocumentDataArray& arrayDocument);
+    void addDocuments(const CWizDocumentDataArray& arrayDocument);
+    // return row of document, existing document is updated
+    int addDocument(const WIZDOCUMENTDATA& doc);
+    bool updateDocument(const WIZDOCUMENTDATA& doc);
+    bool removeDocument(const QString& strGUID);
+    void clear();
+
+    int documentRow(const QString& strGUID) const;
+
+    // read from database, the list only keeps what is drawn and sorted
+    WIZDOCUMENTDATA document(int row) const;
+
+    // drawing
+    QString documentGUID(int row) const;
+    QString kbGUID(int row) const;
+    QString title(int row) const;
+    QString authorId(int row) const;
+    QString info(int row) const;
+    int itemType(int row) const;
+    bool isProtected(int row) const;
+    bool isContainsAttachment(int row) const;
+    bool isUnread(int row) const;
+
+    // items of context menu
+    bool isSpecialFocused(int row) const;
+    void setSpecialFocused(const QString& strGUID, bool bSpecialFocused);
+
+private:
+    enum DocumentFlags {
+        flagProtected = 0x01,
+        flagAttachment = 0x02,
+        flagUnread = 0x04,
+        flagGroup = 0x08,
+        flagSpecialFocused = 0x10
+    };
+
+    struct WIZSTRINGPOOL
+    {
+        QStringList strings;
+        QHash<QString, int> index;
+
+        int intern(const QString& str);
+        void clear() { strings.clear(); index.clear(); }
+    };
+
+    CWizDatabaseManager& m_dbMgr;
+    QString m_strPersonalKbGUID;
+    int m_nSortingType;
+
+    // columns, indexed by slot
+    QVector<QString> m_arrayGUID;
+    QVector<QString> m_arrayTitle;
+    QVector<int> m_arrayKbGUID;
+    QVector<int> m_arrayLocation;
+    QVector<int> m_arrayOwner;
+    QVector<qint64> m_arrayCreated;
+    QVector<qint64> m_arrayModified;
+    QVector<quint8> m_arrayFlags;
+
+    // computed when sorted or drawn, reset when document is modified
+    mutable QVector<QString> m_arrayTags;
+    mutable QVector<qint64> m_arraySize;
+    mutable QVector<QString> m_arrayInfo;
+
+    WIZSTRINGPOOL m_poolKbGUID;
+    WIZSTRINGPOOL m_poolLocation;
+    WIZSTRINGPOOL m_poolOwner;
+
+    QVector<int> m_arrayFreeSlot;
+    QHash<QString, int> m_hashSlot;     // guid -> slot
+
+    // row -> slot, sorted by sorting type
+    QVector<int> m_rows;
+
+    struct SlotLessThan
+    {
+        const CWizDocumentListModel* model;
+        SlotLessThan(const CWizDocumentListModel* m) : model(m) {}
+        bool operator()(int nSlot1, int nSlot2) const { return model->lessThan(nSlot1, nSlot2); }
+    };
+
+    int allocSlot(const WIZDOCUMENTDATA& doc);
+    void setSlot(int nSlot, const WIZDOCUMENTDATA& doc);
+    void freeSlot(int nSlot);
+
+    int slotAt(int row) const;
+    int rowOfSlot(int nSlot) const;
+    int insertPosition(int nSlot) const;
+    void prepareSortingKeys() const;
+
+    bool lessThan(int nSlot1, int nSlot2) const;
+
+    const QString& tags(int nSlot) const;
+    qint64 size(int nSlot) const;
+    QString location(int nSlot) const;
+    QString documentFileName(int nSlot) const;
+};
+
+#endif // WIZDOCUMENTLISTMODEL_H
@@ -1,8 +1,8 @@
 #include "wizDocumentListView.h"
 
-#include <QPixmapCache>
 #include <QApplication>
 #include <QMenu>
+#include <QStyledItemDelegate>
 
 #include "share/wizDatabaseManager.h"
 #include "wizCategoryView.h"
@@ -36,13 +36,46 @@ using namespace Core::Internal;
 #define WIZACTION_LIST_COPY_DOCUMENT_LINK QObject::tr("Copy Document Link")
 
 
+class CWizDocumentListViewDelegate : public QStyledItemDelegate
+{
+public:
+    CWizDocumentListViewDelegate(CWizDocumentListView* view)
+        : QStyledItemDelegate(view)
+        , m_view(view)
+    {
+    }
+
+    virtual QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const
+    {
+        Q_UNUSED(option);
+        Q_UNUSED(index);
+
+        // all rows have the same height, see setUniformItemSizes
+        return QSize(m_view->sizeHint().width(), Utils::StyleHelper::listViewItemHeight(m_view->viewType()));
+    }
+
+    virtual void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+    {
+        QStyleOptionViewItemV4 opt = option;
+        initStyleOption(&opt, index);
+
+        m_view->drawItem(painter, &opt);
+    }
+
+private:
+    CWizDocumentListView* m_view;
+};
+
+
 CWizDocumentListView::CWizDocumentListView(CWizExplorerApp& app, QWidget *parent /*= 0*/)
-    : QListWidget(parent)
+    : QListView(parent)
     , m_app(app)
     , m_dbMgr(app.databaseManager())
+    , m_model(new CWizDocumentListModel(app.databaseManager(), this))
     , m_tagList(NULL)
     , m_itemSelectionChanged(false)
     , m_accpetAllItems(false)
+    , m_nPrefetchScrollPos(0)
 {
     setFrameStyle(QFrame::NoFrame);
     setAttribute(Qt::WA_MacShowFocusRect, false);
@@ -56,7 +89,13 @@ CWizDocumentListView::CWizDocumentListView(CWizExplorerApp& app, QWidget *parent
         m_nSortingType = CWizSortingPopupButton::SortingCreateTime;
     }
 
-    connect(this, SIGNAL(itemSelectionChanged()), SLOT(on_itemSelectionChanged()));
+    m_model->setSortingType(m_nSortingType);
+    setModel(m_model);
+    setItemDelegate(new CWizDocumentListViewDelegate(this));
+    setUniformItemSizes(true);
+
+    connect(selectionModel(), SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
+            SLOT(on_itemSelectionChanged()));
 
     // scroll bar
     setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
@@ -66,6 +105,8 @@ CWizDocumentListView::CWizDocumentListView(CWizExplorerApp& app, QWidget *parent
     verticalScrollBar()->setSingleStep(30);
 #endif
 
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), SLOT(on_verticalScrollBar_valueChanged(int)));
+
 #ifdef WIZNOTE_CUSTOM_SCROLLBAR
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -183,60 +224,43 @@ void CWizDocumentListView::resizeEvent(QResizeEvent* event)
     m_vScroll->move(event->size().width() - m_vScroll->sizeHint().width(), 0);
 #endif
 
-    // FIXME!!!
-    //QPixmapCache::clear();
-    setItemsNeedUpdate();
-    QListWidget::resizeEvent(event);
+    QListView::resizeEvent(event);
 }
 
-void CWizDocumentListView::setDocuments(const CWizDocumentDataArray& arrayDocument)
+int CWizDocumentListView::count() const
 {
-    //reset
-    clear();
+    return m_model->rowCount();
+}
 
-    Q_EMIT documentCountChanged();
+void CWizDocumentListView::clear()
+{
+    m_rightButtonFocusedDocuments.clear();
+    m_model->clear();
+}
+
+void CWizDocumentListView::setDocuments(const CWizDocumentDataArray& arrayDocument)
+{
+    m_rightButtonFocusedDocuments.clear();
+    m_model->setDocuments(arrayDocument);
 
     verticalScrollBar()->setValue(0);
 
-    addDocuments(arrayDocument);
+    Q_EMIT documentCountChanged();
 }
 
 void CWizDocumentListView::addDocuments(const CWizDocumentDataArray& arrayDocument)
 {
-    CWizDocumentDataArray::const_iterator it;
-    for (it = arrayDocument.begin(); it != arrayDocument.end(); it++) {
-        addDocument(*it, false);
+    m_model->addDocuments(arrayDocument);
 
-        //QCoreApplication::processEvents(QEventLoop::AllEvents);
-    }
-
-    sortItems();
+    Q_EMIT documentCountChanged();
 }
 
-int CWizDocumentListView::addDocument(const WIZDOCUMENTDATA& doc, bool sort)
+int CWizDocumentListView::addDocument(const WIZDOCUMENTDATA& doc)
 {
-    WizDocumentListViewItemData data;
-    data.doc = doc;
-
-    if (doc.strKbGUID.isEmpty() || m_dbMgr.db().kbGUID() == doc.strKbGUID) {
-        data.nType = CWizDocumentListViewItem::TypePrivateDocument;
-    } else {
-        data.nType = CWizDocumentListViewItem::TypeGroupDocument;
-        data.strAuthorId = doc.strOwner;
-    }
-
-    CWizDocumentListViewItem* pItem = new CWizDocumentListViewItem(m_app, data);
-    //pItem->setSizeHint(itemSizeFromViewType(m_nViewType));
-    pItem->setSizeHint(QSize(sizeHint().width(), Utils::StyleHelper::listViewItemHeight(m_nViewType)));
-    pItem->setSortingType(m_nSortingType);
-    addItem(pItem);
-
-    if (sort) {
-        sortItems();
-    }
+    int row = m_model->addDocument(doc);
 
     Q_EMIT documentCountChanged();
-    return count();
+    return row;
 }
 
 bool CWizDocumentListView::acceptDocument(const WIZDOCUMENTDATA& document)
@@ -265,43 +289,36 @@ void CWizDocumentListView::addAndSelectDocument(const WIZDOCUMENTDATA& document)
 
     int index = documentIndexFromGUID(document.strGUID);
     if (-1 == index) {
-        index = addDocument(document, false);
+        index = addDocument(document);
     }
 
     if (-1 == index)
         return;
 
-    setCurrentItem(item(index), QItemSelectionModel::ClearAndSelect);
+    selectionModel()->setCurrentIndex(m_model->index(index), QItemSelectionModel::ClearAndSelect);
     emit documentsSelectionChanged();
-    sortItems();
 }
 
 void CWizDocumentListView::getSelectedDocuments(CWizDocumentDataArray& arrayDocument)
 {
-    QList<QListWidgetItem*> items = selectedItems();
+    QModelIndexList indexes = selectionModel()->selectedRows();
 
-    QList<QListWidgetItem*>::const_iterator it;
-    for (it = items.begin(); it != items.end(); it++)
+    QModelIndexList::const_iterator it;
+    for (it = indexes.begin(); it != indexes.end(); it++)
     {
-        QListWidgetItem* pItem = *it;
-
-        CWizDocumentListViewItem* pDocumentItem = dynamic_cast<CWizDocumentListViewItem*>(pItem);
-        if (!pDocumentItem)
-            continue;
-
-        arrayDocument.push_back(pDocumentItem->data().doc);
+        arrayDocument.push_back(m_model->document(it->row()));
     }
 }
 
 /*
 void CWizDocumentListView::contextMenuEvent(QContextMenuEvent * e)
 {
-    CWizDocumentListViewItem* pItem = dynamic_cast<CWizDocumentListViewItem*>(itemAt(e->pos()));
+    QModelIndex index = indexAt(e->pos());
 
-    if (!pItem)
+    if (!index.isValid())
         return;
 
-    //if (pItem->itemType() == CWizDocumentListViewItem::TypeMessage) {
+    //if (m_model->itemType(index.row()) == CWizDocumentListModel::TypeMessage) {
     //    m_menuMessage->popup(e->globalPos());
     //} else {
     m_menuDocument->popup(e->globalPos());
@@ -311,11 +328,7 @@ void CWizDocumentListView::contextMenuEvent(QContextMenuEvent * e)
 
 void CWizDocumentListView::resetPermission()
 {
-    CWizDocumentDataArray arrayDocument;
-    //QList<QListWidgetItem*> items = selectedItems();
-    foreach (CWizDocumentListViewItem* item, m_rightButtonFocusedItems) {
-        arrayDocument.push_back(item->document());
-    }
+    const CWizDocumentDataArray& arrayDocument = m_rightButtonFocusedDocuments;
 
     bool bGroup = isDocumentsWithGroupDocument(arrayDocument);
     bool bDeleted = isDocumentsWithDeleted(arrayDocument);
@@ -343,7 +356,7 @@ void CWizDocumentListView::resetPermission()
     }
 
     // disable note history if selection is not only one
-    if (m_rightButtonFocusedItems.count() != 1) {
+    if (m_rightButtonFocusedDocuments.size() != 1) {
         findAction(WIZACTION_LIST_DOCUMENT_HISTORY)->setEnabled(false);
     } else {
         findAction(WIZACTION_LIST_DOCUMENT_HISTORY)->setEnabled(true);
@@ -407,35 +420,31 @@ void CWizDocumentListView::mousePressEvent(QMouseEvent* event)
     {
         m_dragStartPosition.setX(event->pos().x());
         m_dragStartPosition.setY(event->pos().y());
-        QListWidget::mousePressEvent(event);
+        QListView::mousePressEvent(event);
     }
     else if (event->button() == Qt::RightButton)
     {
-        m_rightButtonFocusedItems.clear();
+        m_rightButtonFocusedDocuments.clear();
         //
-        CWizDocumentListViewItem* pItem = dynamic_cast<CWizDocumentListViewItem*>(itemAt(event->pos()));
-        if (!pItem)
+        QModelIndex index = indexAt(event->pos());
+        if (!index.isValid())
             return;
 
         // if selectdItems contains clicked item use all selectedItems as special focused item.
-        if (selectedItems().contains(pItem))
+        if (selectionModel()->isSelected(index))
         {
-            foreach (QListWidgetItem* lsItem, selectedItems())
-            {
-                pItem = dynamic_cast<CWizDocumentListViewItem*>(lsItem);
-                if (pItem)
-                {
-                    m_rightButtonFocusedItems.append(pItem);
-                    pItem->setSpecialFocused(true);
-                }
-
-            }
+            getSelectedDocuments(m_rightButtonFocusedDocuments);
         }
         else
         {
-            m_rightButtonFocusedItems.append(pItem);
-            pItem->setSpecialFocused(true);
+            m_rightButtonFocusedDocuments.push_back(m_model->document(index.row()));
+        }
+
+        foreach (const WIZDOCUMENTDATAEX& doc, m_rightButtonFocusedDocuments)
+        {
+            m_model->setSpecialFocused(doc.strGUID, true);
         }
+        viewport()->update();
         //
         resetPermission();
         m_menuDocument->popup(event->globalPos());
@@ -449,7 +458,7 @@ void CWizDocumentListView::mouseMoveEvent(QMouseEvent* event)
         setState(QAbstractItemView::DraggingState);
     }
 
-    QListWidget::mouseMoveEvent(event);
+    QListView::mouseMoveEvent(event);
 }
 
 void CWizDocumentListView::mouseReleaseEvent(QMouseEvent* event)
@@ -461,7 +470,7 @@ void CWizDocumentListView::mouseReleaseEvent(QMouseEvent* event)
         m_itemSelectionChanged = false;
     }
 
-    QListWidget::mouseReleaseEvent(event);
+    QListView::mouseReleaseEvent(event);
 }
 
 QPixmap WizGetDocumentDragBadget(int nCount)
@@ -537,13 +546,7 @@ void CWizDocumentListView::startDrag(Qt::DropActions supportedActions)
     Q_UNUSED(supportedActions);
 
     CWizDocumentDataArray arrayDocument;
-    QList<QListWidgetItem*> items = selectedItems();
-    foreach (QListWidgetItem* it, items) {
-        if (CWizDocumentListViewItem* item = dynamic_cast<CWizDocumentListViewItem*>(it)) {
-//            CWizDatabase& db = CWizDatabaseManager::instance()->db(item->document().strKbGUID);
-            arrayDocument.push_back(item->document());
-        }
-    }
+    getSelectedDocuments(arrayDocument);
 
     if (!arrayDocument.size())
         return;
@@ -555,7 +558,7 @@ void CWizDocumentListView::startDrag(Qt::DropActions supportedActions)
     mimeData->setData(WIZNOTE_MIMEFORMAT_DOCUMENTS, strMime.toUtf8());
     drag->setMimeData(mimeData);
 
-    drag->setPixmap(WizGetDocumentDragBadget(items.size()));
+    drag->setPixmap(WizGetDocumentDragBadget(arrayDocument.size()));
     drag->exec();
 }
 
@@ -581,8 +584,10 @@ void CWizDocumentListView::dropEvent(QDropEvent * event)
 {
     if (event->mimeData()->hasFormat(WIZNOTE_MIMEFORMAT_TAGS))
     {
-        if (CWizDocumentListViewItem* item = dynamic_cast<CWizDocumentListViewItem*>(itemAt(event->pos())))
+        QModelIndex index = indexAt(event->pos());
+        if (index.isValid())
         {
+            WIZDOCUMENTDATA document = m_model->document(index.row());
             QByteArray data = event->mimeData()->data(WIZNOTE_MIMEFORMAT_TAGS);
             QString strTagGUIDs = QString::fromUtf8(data, data.length());
             CWizStdStringArray arrayTagGUID;
@@ -592,7 +597,7 @@ void CWizDocumentListView::dropEvent(QDropEvent * event)
                 WIZTAGDATA dataTag;
                 if (m_dbMgr.db().TagFromGUID(strTagGUID, dataTag))
                 {
-                    CWizDocument doc(m_dbMgr.db(), item->document());
+                    CWizDocument doc(m_dbMgr.db(), document);
                     doc.AddTag(dataTag);
                 }
             }
@@ -606,10 +611,8 @@ void CWizDocumentListView::resetItemsViewType(int type)
 {
     m_nViewType = (ViewType)type;
 
-    for (int i = 0; i < count(); i++) {
-        item(i)->setSizeHint(QSize(sizeHint().width(), Utils::StyleHelper::listViewItemHeight(m_nViewType)));
-        //item(i)->setSizeHint(itemSizeFromViewType(m_nViewType));
-    }
+    // row height is asked from delegate again
+    scheduleDelayedItemsLayout();
 }
 
 QSize CWizDocumentListView::itemSizeFromViewType(ViewType type)
@@ -635,18 +638,8 @@ QSize CWizDocumentListView::itemSizeFromViewType(ViewType type)
 
 void CWizDocumentListView::resetItemsSortingType(int type)
 {
-    // FIXME!!!
-    //QPixmapCache::clear();
-    setItemsNeedUpdate();
-
     m_nSortingType = type;
-
-    for (int i = 0; i < count(); i++) {
-        CWizDocumentListViewItem* pItem = dynamic_cast<CWizDocumentListViewItem*>(item(i));
-        pItem->setSortingType(type);
-    }
-
-    sortItems();
+    m_model->setSortingType(type);
 }
 
 void CWizDocumentListView::on_itemSelectionChanged()
@@ -672,7 +665,7 @@ void CWizDocumentListView::on_document_created(const WIZDOCUMENTDATA& document)
     {
         if (-1 == documentIndexFromGUID(document.strGUID))
         {
-            addDocument(document, true);
+            addDocument(document);
         }
     }
 }
@@ -685,30 +678,28 @@ void CWizDocumentListView::on_document_modified(const WIZDOCUMENTDATA& documentO
     // FIXME: if user search on-going, acceptDocument will remove this document from the list.
     if (acceptDocument(documentNew))
     {
+        // read count and attachment count are not in documentNew
+        WIZDOCUMENTDATA document;
+        if (!m_dbMgr.db(documentNew.strKbGUID).DocumentFromGUID(documentNew.strGUID, document))
+            document = documentNew;
+
         int index = documentIndexFromGUID(documentNew.strGUID);
         if (-1 == index) {
-            addDocument(documentNew, true);
+            addDocument(document);
         } else {
-            if (CWizDocumentListViewItem* pItem = documentItemAt(index)) {
-                pItem->reload(m_dbMgr.db(documentNew.strKbGUID));
-                pItem->setSortingType(m_nSortingType);
-                update(indexFromItem(pItem));
-                sortItems();
-            }
+            m_model->updateDocument(document);
         }
     } else {
-        int index = documentIndexFromGUID(documentNew.strGUID);
-        if (-1 != index) {
-            takeItem(index);
+        if (m_model->removeDocument(documentNew.strGUID)) {
+            Q_EMIT documentCountChanged();
         }
     }
 }
 
 void CWizDocumentListView::on_document_deleted(const WIZDOCUMENTDATA& document)
 {
-    int index = documentIndexFromGUID(document.strGUID);
-    if (-1 != index) {
-        takeItem(index);
+    if (m_model->removeDocument(document.strGUID)) {
+        Q_EMIT documentCountChanged();
     }
 }
 
@@ -718,57 +709,36 @@ void CWizDocumentListView::on_document_abstractLoaded(const WIZABSTRACT& abs)
     if (-1 == index)
         return;
 
-    // kbGUID also should equal
-    CWizDocumentListViewItem* pItem = documentItemAt(index);
-    //if (!pItem->document().strKbGUID.isEmpty() &&
-    //        pItem->document().strKbGUID != abs.strKbGUID) {
-    //    return;
-    //}
-
-    //if (!pItem->message().kbGUID.isEmpty() &&
-    //        pItem->message().kbGUID != abs.strKbGUID) {
-    //    return;
-    //}
-
-    pItem->resetAbstract(abs);
-    update(indexFromItem(pItem));
+    // thumb is read from ThumbCache when drawing
+    update(m_model->index(index));
 }
 
 void CWizDocumentListView::on_userAvatar_loaded(const QString& strUserGUID)
 {
-    CWizDocumentListViewItem* pItem = NULL;
-    for (int i = 0; i < count(); i++) {
-        pItem = documentItemAt(i);
-        if (pItem->data().strAuthorId == strUserGUID) {
-            update(indexFromItem(pItem));
-        }
-    }
+    Q_UNUSED(strUserGUID);
+
+    // avatars are only drawn for visible rows
+    viewport()->update();
 }
 
 void CWizDocumentListView::onThumbCacheLoaded(const QString& strKbGUID, const QString& strGUID)
 {
-    setItemsNeedUpdate(strKbGUID, strGUID);
+    int index = documentIndexFromGUID(strGUID);
+    if (-1 == index || m_model->kbGUID(index) != strKbGUID)
+        return;
 
-    CWizDocumentListViewItem* pItem = NULL;
-    for (int i = 0; i < count(); i++) {
-        pItem = documentItemAt(i);
-        if (pItem->data().doc.strKbGUID == strKbGUID && pItem->data().doc.strGUID == strGUID) {
-            update(indexFromItem(pItem));
-        }
-    }
+    update(m_model->index(index));
 }
 
 void CWizDocumentListView::on_action_documentHistory()
 {
-    if (m_rightButtonFocusedItems.count() != 1)
+    if (m_rightButtonFocusedDocuments.size() != 1)
         return;
 
-   CWizDocumentListViewItem* item = m_rightButtonFocusedItems.first();
-   if (!item)
-       return;
+    const WIZDOCUMENTDATAEX& document = m_rightButtonFocusedDocuments.front();
 
     CString strExt = WizFormatString2(_T("obj_guid=%1&kb_guid=%2&obj_type=document"),
-                                      item->document().strGUID, item->document().strKbGUID);
+                                      document.strGUID, document.strKbGUID);
     QString strUrl = WizService::ApiEntry::standardCommandUrl("document_history", WIZ_TOKEN_IN_URL_REPLACE_PART, strExt);
 
     showWebDialogWithToken(tr("Note History"), strUrl, window());
@@ -841,33 +811,23 @@ void CWizDocumentListView::on_action_selectTags()
         m_tagList = new CWizTagListWidget(this);
     }
 
-    if (m_rightButtonFocusedItems.isEmpty())
+    if (m_rightButtonFocusedDocuments.empty())
         return;
 
-    CWizDocumentDataArray arrayDocument;
-    for (int i = 0; i < m_rightButtonFocusedItems.size(); i++) {
-        CWizDocumentListViewItem* pItem = m_rightButtonFocusedItems.at(i);
-        arrayDocument.push_back(pItem->document());
-    }
-
-    m_tagList->setDocuments(arrayDocument);
+    m_tagList->setDocuments(m_rightButtonFocusedDocuments);
     m_tagList->showAtPoint(QCursor::pos());
 }
 
 void CWizDocumentListView::on_action_deleteDocument()
 {
-    if (m_rightButtonFocusedItems.isEmpty())
+    if (m_rightButtonFocusedDocuments.empty())
         return;
     //
     blockSignals(true);
     int index = -1;
-    foreach (CWizDocumentListViewItem* item, m_rightButtonFocusedItems) {
-        if (item->type() == CWizDocumentListViewItem::TypeMessage) {
-            continue;
-        }
-
-        index = indexFromItem(item).row();
-        CWizDocument doc(m_dbMgr.db(item->document().strKbGUID), item->document());
+    foreach (const WIZDOCUMENTDATAEX& document, m_rightButtonFocusedDocuments) {
+        index = documentIndexFromGUID(document.strGUID);
+        CWizDocument doc(m_dbMgr.db(document.strKbGUID), document);
         doc.Delete();
     }
     blockSignals(false);
@@ -883,9 +843,9 @@ void CWizDocumentListView::on_action_deleteDocument()
     {
         emit lastDocumentDeleted();
     }
-    else if (selectedItems().isEmpty())
+    else if (!selectionModel()->hasSelection() && index >= 0)
     {
-        setItemSelected(documentItemAt(index), true);
+        selectionModel()->select(m_model->index(index), QItemSelectionModel::Select);
     }
 }
 
@@ -913,10 +873,7 @@ void CWizDocumentListView::on_action_moveDocument_confirmed(int result)
     }
 
     // collect documents
-    CWizDocumentDataArray arrayDocument;
-    foreach (CWizDocumentListViewItem* item, m_rightButtonFocusedItems) {
-        arrayDocument.push_back(item->document());
-    }
+    CWizDocumentDataArray arrayDocument = m_rightButtonFocusedDocuments;
 
     // only move user private documents
     if (isDocumentsWithGroupDocument(arrayDocument)) {
@@ -980,13 +937,12 @@ void CWizDocumentListView::on_action_copyDocument_confirmed(int result)
 
 void CWizDocumentListView::on_action_copyDocumentLink()
 {
-    if (m_rightButtonFocusedItems.isEmpty())
+    if (m_rightButtonFocusedDocuments.empty())
         return;
     //
     QList<WIZDOCUMENTDATA> documents;
-    foreach(CWizDocumentListViewItem* item, m_rightButtonFocusedItems)
+    foreach(const WIZDOCUMENTDATAEX& document, m_rightButtonFocusedDocuments)
     {
-        const WIZDOCUMENTDATA& document = item->document();
         documents.append(document);
     }
     m_dbMgr.db().CopyDocumentsLink(documents);
@@ -995,27 +951,26 @@ void CWizDocumentListView::on_action_copyDocumentLink()
 void CWizDocumentListView::on_action_showDocumentInFloatWindow()
 {
     MainWindow* mainWindow = qobject_cast<MainWindow*>(m_app.mainWindow());
-    foreach(CWizDocumentListViewItem* item, m_rightButtonFocusedItems)
+    foreach(const WIZDOCUMENTDATAEX& document, m_rightButtonFocusedDocuments)
     {
-        const WIZDOCUMENTDATA& document = item->document();
         mainWindow->viewDocumentInFloatWidget(document);
     }
 }
 
 void CWizDocumentListView::on_menu_aboutToHide()
 {
-    foreach(CWizDocumentListViewItem* item, m_rightButtonFocusedItems)
+    foreach(const WIZDOCUMENTDATAEX& document, m_rightButtonFocusedDocuments)
     {
-        item->setSpecialFocused(false);
+        m_model->setSpecialFocused(document.strGUID, false);
     }
     viewport()->update();
 }
 
 void CWizDocumentListView::on_action_encryptDocument()
 {
-    foreach(CWizDocumentListViewItem* item, m_rightButtonFocusedItems)
+    foreach(const WIZDOCUMENTDATAEX& document, m_rightButtonFocusedDocuments)
     {
-        CWizDocument doc(m_dbMgr.db(), item->document());
+        CWizDocument doc(m_dbMgr.db(), document);
         doc.encryptDocument();
     }
 }
@@ -1025,41 +980,18 @@ int CWizDocumentListView::documentIndexFromGUID(const QString& strGUID)
 {
     Q_ASSERT(!strGUID.isEmpty());
 
-    for (int i = 0; i < count(); i++) {
-        if (CWizDocumentListViewItem *pItem = documentItemAt(i)) {
-            if (pItem->document().strGUID == strGUID) {
-                return i;
-            }
-        }
-    }
-
-    return -1;
+    return m_model->documentRow(strGUID);
 }
 
-CWizDocumentListViewItem *CWizDocumentListView::documentItemAt(int index)
+WIZDOCUMENTDATA CWizDocumentListView::documentFromIndex(const QModelIndex &index) const
 {
-    return dynamic_cast<CWizDocumentListViewItem*>(item(index));
-}
-
-CWizDocumentListViewItem *CWizDocumentListView::documentItemFromIndex(const QModelIndex &index) const
-{
-    return dynamic_cast<CWizDocumentListViewItem*>(itemFromIndex(index));
-}
-
-const WizDocumentListViewItemData& CWizDocumentListView::documentItemDataFromIndex(const QModelIndex& index) const
-{
-    return documentItemFromIndex(index)->data();
-}
-
-const WIZDOCUMENTDATA& CWizDocumentListView::documentFromIndex(const QModelIndex &index) const
-{
-    return documentItemFromIndex(index)->document();
+    return m_model->document(index.row());
 }
 
 //#ifndef Q_OS_MAC
 //void CWizDocumentListView::updateGeometries()
 //{
-//    QListWidget::updateGeometries();
+//    QListView::updateGeometries();
 //
 //    // singleStep will initialized to item height(94 pixel), reset it
 //    verticalScrollBar()->setSingleStep(1);
@@ -1090,7 +1022,7 @@ void CWizDocumentListView::wheelEvent(QWheelEvent* event)
                                           event->buttons(),
                                           event->modifiers(),
                                           event->orientation());
-    QListWidget::wheelEvent(newEvent);
+    QListView::wheelEvent(newEvent);
 }
 
 void CWizDocumentListView::vscrollBeginUpdate(int delta)
@@ -1172,6 +1104,66 @@ void CWizDocumentListView::on_vscroll_valueChanged(int value)
     m_vscrollOldPos = value;
 }
 
+void CWizDocumentListView::on_verticalScrollBar_valueChanged(int value)
+{
+    prefetchThumbs(value);
+
+    // only search results are paged, folder and tag lists are loaded at once
+    if (!m_accpetAllItems)
+        return;
+
+    QScrollBar* scrollBar = verticalScrollBar();
+    if (scrollBar->maximum() > 0 && value >= scrollBar->maximum()) {
+        Q_EMIT loadMoreRequested();
+    }
+}
+
+static void appendThumbKey(const CWizDocumentListModel* model, int row, QList<ThumbKey>& listKey)
+{
+    listKey.append(ThumbKey(model->kbGUID(row), model->documentGUID(row)));
+}
+
+void CWizDocumentListView::prefetchThumbs(int nScrollPos)
+{
+    bool bScrollDown = nScrollPos >= m_nPrefetchScrollPos;
+    m_nPrefetchScrollPos = nScrollPos;
+
+    // thumbs are only drawn in thumbnail view
+    if (m_nViewType != TypeThumbnail || !count())
+        return;
+
+    QRect rc = viewport()->rect();
+    QModelIndex indexFirst = indexAt(rc.topLeft());
+    if (!indexFirst.isValid())
+        return;
+
+    QModelIndex indexLast = indexAt(rc.bottomLeft());
+    int nFirst = indexFirst.row();
+    int nLast = indexLast.isValid() ? indexLast.row() : count() - 1;
+    int nPage = nLast - nFirst + 1;
+
+    QList<ThumbKey> listVisible;
+    for (int i = nFirst; i <= nLast; i++) {
+        appendThumbKey(m_model, i, listVisible);
+    }
+
+    // nearest rows first
+    QList<ThumbKey> listAhead;
+    if (bScrollDown) {
+        int nEnd = qMin(count() - 1, nLast + nPage);
+        for (int i = nLast + 1; i <= nEnd; i++) {
+            appendThumbKey(m_model, i, listAhead);
+        }
+    } else {
+        int nBegin = qMax(0, nFirst - nPage);
+        for (int i = nFirst - 1; i >= nBegin; i--) {
+            appendThumbKey(m_model, i, listAhead);
+        }
+    }
+
+    ThumbCache::prefetch(listVisible, listAhead);
+}
+
 void CWizDocumentListView::on_vscroll_actionTriggered(int action)
 {
     switch (action) {
@@ -1189,34 +1181,178 @@ void CWizDocumentListView::on_vscroll_actionTriggered(int action)
 
 void CWizDocumentListView::drawItem(QPainter* p, const QStyleOptionViewItemV4* vopt) const
 {
-    CWizDocumentListViewItem* pItem = documentItemFromIndex(vopt->index);
-    if (pItem)
-        pItem->draw(p, vopt, viewType());
+    int row = vopt->index.row();
+    if (row < 0 || row >= count())
+        return;
+
+    if (m_model->itemType(row) == CWizDocumentListModel::TypePrivateDocument)
+    {
+        switch (m_nViewType) {
+        case TypeThumbnail:
+            drawPrivateSummaryView(p, vopt, row);
+            break;
+        case TypeTwoLine:
+            drawPrivateTwoLineView(p, vopt, row);
+            break;
+        case TypeOneLine:
+            drawOneLineView(p, vopt, row);
+            break;
+        default:
+            Q_ASSERT(0);
+            return;
+        }
+    }
+    else
+    {
+        switch (m_nViewType) {
+        case TypeThumbnail:
+            drawGroupSummaryView(p, vopt, row);
+            break;
+        case TypeTwoLine:
+            drawGroupTwoLineView(p, vopt, row);
+            break;
+        case TypeOneLine:
+            drawOneLineView(p, vopt, row);
+            break;
+        default:
+            Q_ASSERT(0);
+            return;
+        }
+    }
+
+    drawSyncStatus(p, vopt, row);
 }
 
-void CWizDocumentListView::setAcceptAllItems(bool bAccept)
+void CWizDocumentListView::drawPrivateSummaryView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const
 {
-    m_accpetAllItems = bAccept;
+    bool bSelected = vopt->state & QStyle::State_Selected;
+    bool bFocused = hasFocus();
+
+    WIZABSTRACT thumb;
+    ThumbCache::instance()->find(m_model->kbGUID(row), m_model->documentGUID(row), thumb);
+
+    QRect rcd = drawItemBackground(p, vopt->rect, bSelected, bFocused, row);
+
+    if (!thumb.image.isNull()) {
+        QPixmap pmt = QPixmap::fromImage(thumb.image);
+        QRect rcp = Utils::StyleHelper::drawThumbnailPixmap(p, rcd, pmt);
+        rcd.setRight(rcp.left());
+    }
+
+    int nType = m_model->isProtected(row) ? Utils::StyleHelper::BadgeEncryted : Utils::StyleHelper::BadgeNormal;
+    bool bContainsAttach = m_model->isContainsAttachment(row);
+    Utils::StyleHelper::drawListViewItemThumb(p, rcd, nType, m_model->title(row), m_model->info(row), thumb.text, bFocused, bSelected, bContainsAttach);
 }
 
-void CWizDocumentListView::setItemsNeedUpdate(const QString& strKbGUID, const QString& strGUID)
+void CWizDocumentListView::drawGroupSummaryView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const
 {
-    if (strKbGUID.isEmpty() || strGUID.isEmpty()) {
-        for (int i = 0; i < count(); i++) {
-            CWizDocumentListViewItem* pItem = dynamic_cast<CWizDocumentListViewItem*>(item(i));
-            Q_ASSERT(pItem);
+    bool bSelected = vopt->state & QStyle::State_Selected;
+    bool bFocused = hasFocus();
 
-            pItem->setNeedUpdate();
-        }
+    WIZABSTRACT thumb;
+    ThumbCache::instance()->find(m_model->kbGUID(row), m_model->documentGUID(row), thumb);
 
-        return;
+    QRect rcd = drawItemBackground(p, vopt->rect, bSelected, bFocused, row);
+
+    QPixmap pmAvatar;
+    WizService::AvatarHost::avatar(m_model->authorId(row), &pmAvatar);
+    QRect rcAvatar = Utils::StyleHelper::drawAvatar(p, rcd, pmAvatar);
+    int nAvatarRightMargin = 4;
+    rcd.setLeft(rcAvatar.right() + nAvatarRightMargin);
+
+    int nType = m_model->isProtected(row) ? Utils::StyleHelper::BadgeEncryted : Utils::StyleHelper::BadgeNormal;
+    bool bContainsAttach = m_model->isContainsAttachment(row);
+    Utils::StyleHelper::drawListViewItemThumb(p, rcd, nType, m_model->title(row), m_model->info(row), thumb.text, bFocused, bSelected, bContainsAttach);
+}
+
+void CWizDocumentListView::drawPrivateTwoLineView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const
+{
+    bool bSelected = vopt->state & QStyle::State_Selected;
+    bool bFocused = hasFocus();
+
+    QRect rcd = drawItemBackground(p, vopt->rect, bSelected, bFocused, row);
+
+    int nType = m_model->isProtected(row) ? Utils::StyleHelper::BadgeEncryted : Utils::StyleHelper::BadgeNormal;
+    bool bContainsAttach = m_model->isContainsAttachment(row);
+    Utils::StyleHelper::drawListViewItemThumb(p, rcd, nType, m_model->title(row), m_model->info(row), NULL, bFocused, bSelected, bContainsAttach);
+}
+
+void CWizDocumentListView::drawGroupTwoLineView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const
+{
+    bool bSelected = vopt->state & QStyle::State_Selected;
+    bool bFocused = hasFocus();
+
+    QRect rcd = drawItemBackground(p, vopt->rect, bSelected, bFocused, row);
+
+    QPixmap pmAvatar;
+    WizService::AvatarHost::avatar(m_model->authorId(row), &pmAvatar);
+    QRect rcAvatar = Utils::StyleHelper::drawAvatar(p, rcd, pmAvatar);
+    int nAvatarRightMargin = 4;
+    rcd.setLeft(rcAvatar.right() + nAvatarRightMargin);
+
+    int nType = m_model->isProtected(row) ? Utils::StyleHelper::BadgeEncryted : Utils::StyleHelper::BadgeNormal;
+    bool bContainsAttach = m_model->isContainsAttachment(row);
+    Utils::StyleHelper::drawListViewItemThumb(p, rcd, nType, m_model->title(row), m_model->info(row), NULL, bFocused, bSelected, bContainsAttach);
+}
+
+void CWizDocumentListView::drawOneLineView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const
+{
+    bool bSelected = vopt->state & QStyle::State_Selected;
+    bool bFocused = hasFocus();
+
+    QRect rcd = drawItemBackground(p, vopt->rect, bSelected, bFocused, row);
+
+    int nType = m_model->isProtected(row) ? Utils::StyleHelper::BadgeEncryted : Utils::StyleHelper::BadgeNormal;
+    bool bContainsAttach = m_model->isContainsAttachment(row);
+    Utils::StyleHelper::drawListViewItemThumb(p, rcd, nType, m_model->title(row), NULL, NULL, bFocused, bSelected, bContainsAttach);
+}
+
+void CWizDocumentListView::drawSyncStatus(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const
+{
+    QString strIconPath;
+    QString strGUID = m_model->documentGUID(row);
+    CWizDatabase& db = m_dbMgr.db(m_model->kbGUID(row));
+    if (db.IsDocumentModified(strGUID))
+    {
+        strIconPath = ::WizGetSkinResourcePath(m_app.userSettings().skin()) + "uploading.bmp";
+    }
+    else if (!db.IsDocumentDownloaded(strGUID))
+    {
+        strIconPath = ::WizGetSkinResourcePath(m_app.userSettings().skin()) + "downloading.bmp";
     }
+    else
+        return;
 
-    CWizDocumentListViewItem* pItem = NULL;
-    for (int i = 0; i < count(); i++) {
-        pItem = documentItemAt(i);
-        if (pItem->data().doc.strKbGUID == strKbGUID && pItem->data().doc.strGUID == strGUID) {
-            pItem->setNeedUpdate();
-        }
+    p->save();
+    int nMargin = -1;
+    QPixmap fullPic(strIconPath);
+    QPixmap pix = fullPic.copy(0, 0, fullPic.height(), fullPic.height());
+    pix.setMask(pix.createMaskFromColor(Qt::black, Qt::MaskInColor));
+    QRect rcSync(vopt->rect.right() - pix.width() - nMargin, vopt->rect.bottom() - pix.height() - nMargin,
+                 pix.width(), pix.height());
+    p->drawPixmap(rcSync, pix);
+    p->restore();
+}
+
+QRect CWizDocumentListView::drawItemBackground(QPainter* p, const QRect& rect, bool selected, bool focused, int row) const
+{
+    if (selected && focused)
+    {
+        return Utils::StyleHelper::initListViewItemPainter(p, rect,Utils::StyleHelper::ListBGTypeActive);
+    }
+    else if ((selected && !focused) || m_model->isSpecialFocused(row))
+    {
+        return Utils::StyleHelper::initListViewItemPainter(p, rect,  Utils::StyleHelper::ListBGTypeHalfActive);
     }
+    else if (m_model->isUnread(row))
+    {
+        return Utils::StyleHelper::initListViewItemPainter(p, rect, Utils::StyleHelper::ListBGTypeUnread);
+    }
+
+    return Utils::StyleHelper::initListViewItemPainter(p, rect, Utils::StyleHelper::ListBGTypeNone);
+}
+
+void CWizDocumentListView::setAcceptAllItems(bool bAccept)
+{
+    m_accpetAllItems = bAccept;
 }
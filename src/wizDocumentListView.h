@@ -1,12 +1,12 @@
 #ifndef WIZDOCUMENTLISTVIEW_H
 #define WIZDOCUMENTLISTVIEW_H
 
-#include <QListWidget>
+#include <QListView>
 
 #include "wizdef.h"
 #include "share/wizobject.h"
 #include "share/wizuihelper.h"
-#include "wizDocumentListViewItem.h"
+#include "wizDocumentListModel.h"
 
 class CWizTagListWidget;
 class CWizFolderSelector;
@@ -22,7 +22,7 @@ class CWizUserAvatarDownloaderHost;
 #endif
 
 
-class CWizDocumentListView : public QListWidget
+class CWizDocumentListView : public QListView
 {
     Q_OBJECT
 
@@ -46,7 +46,6 @@ public:
 
     //CWizThumbIndexCache* thumbCache() const { return m_thumbCache; }
 
-    void setItemsNeedUpdate(const QString& strKbGUID = 0, const QString& strGUID = 0);
     void drawItem(QPainter*p, const QStyleOptionViewItemV4* vopt) const;
 
     void setAcceptAllItems(bool bAccept);
@@ -66,6 +65,7 @@ protected:
 private:
     CWizExplorerApp& m_app;
     CWizDatabaseManager& m_dbMgr;
+    CWizDocumentListModel* m_model;
 #ifdef WIZNOTE_CUSTOM_SCROLLBAR
     CWizScrollBar* m_vScroll;
 #endif
@@ -79,7 +79,7 @@ private:
 
     QPoint m_dragStartPosition;
 
-    QList<CWizDocumentListViewItem*> m_rightButtonFocusedItems;
+    CWizDocumentDataArray m_rightButtonFocusedDocuments;
 
 //#ifndef Q_OS_MAC
     // used for smoothly scroll
@@ -91,22 +91,38 @@ private:
 
     bool m_itemSelectionChanged;
     bool m_accpetAllItems;
+    // scroll position of last prefetch, used to get scroll direction
+    int m_nPrefetchScrollPos;
 
     QPointer<QPropertyAnimation> m_scrollAnimation;
 
     QAction* findAction(const QString& strName);
 
+    // load thumbs of visible rows and rows one page ahead
+    void prefetchThumbs(int nScrollPos);
+
     void resetPermission();
 
+    void drawPrivateSummaryView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const;
+    void drawGroupSummaryView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const;
+    void drawPrivateTwoLineView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const;
+    void drawGroupTwoLineView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const;
+    void drawOneLineView(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const;
+    void drawSyncStatus(QPainter* p, const QStyleOptionViewItemV4* vopt, int row) const;
+    QRect drawItemBackground(QPainter* p, const QRect& rect, bool selected, bool focused, int row) const;
+
     // Test documents property
     bool isDocumentsAllCanDelete(const CWizDocumentDataArray& arrayDocument);
     bool isDocumentsWithGroupDocument(const CWizDocumentDataArray& arrayDocument);
     bool isDocumentsWithDeleted(const CWizDocumentDataArray& arrayDocument);
 
 public:
+    int count() const;
+    void clear();
+
     void setDocuments(const CWizDocumentDataArray& arrayDocument);
     void addDocuments(const CWizDocumentDataArray& arrayDocument);
-    int addDocument(const WIZDOCUMENTDATA& data, bool sort);
+    int addDocument(const WIZDOCUMENTDATA& data);
 
     bool acceptDocument(const WIZDOCUMENTDATA& document);
     void addAndSelectDocument(const WIZDOCUMENTDATA& document);
@@ -115,12 +131,7 @@ public:
     void getSelectedDocuments(CWizDocumentDataArray& arrayDocument);
 
     int documentIndexFromGUID(const QString &strGUID);
-    CWizDocumentListViewItem *documentItemAt(int index);
-
-    // drawing passthrought methods
-    CWizDocumentListViewItem *documentItemFromIndex(const QModelIndex &index) const;
-    const WIZDOCUMENTDATA& documentFromIndex(const QModelIndex &index) const;
-    const WizDocumentListViewItemData& documentItemDataFromIndex(const QModelIndex& index) const;
+    WIZDOCUMENTDATA documentFromIndex(const QModelIndex &index) const;
 
 //#ifndef Q_OS_MAC
     // used for smoothly scroll
@@ -179,10 +190,15 @@ public Q_SLOTS:
     void on_vscrollAnimation_finished();
 //#endif // Q_OS_MAC
 
+    void on_verticalScrollBar_valueChanged(int value);
+
 Q_SIGNALS:
     void documentCountChanged();
     void lastDocumentDeleted();
     void documentsSelectionChanged();
+
+    // list scrolled to the end while showing search results
+    void loadMoreRequested();
 };
 
 
@@ -1,11 +1,19 @@
 #include "wizDocumentWebView.h"
 
 #include <QRunnable>
+#include <QtGlobal>
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentRun>
+#endif
 #include <QThreadPool>
 #include <QList>
 #include <QMimeData>
 #include <QUrl>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QString>
 #include <QRegExp>
 #include <QAction>
@@ -184,6 +192,9 @@ CWizDocumentWebView::CWizDocumentWebView(CWizExplorerApp& app, QWidget* parent)
     CWizDocumentWebViewPage* page = new CWizDocumentWebViewPage(this);
     setPage(page);
 
+    m_networkAccessManager = new CWizDocumentWebViewNetworkAccessManager(m_dbMgr, this);
+    page->setNetworkAccessManager(m_networkAccessManager);
+
 #ifdef QT_DEBUG
     settings()->globalSettings()->setAttribute(QWebSettings::DeveloperExtrasEnabled, true);
 #endif
@@ -581,6 +592,7 @@ void CWizDocumentWebView::onTimerAutoSaveTimout()
 void CWizDocumentWebView::onDocumentReady(const QString kbGUID, const QString strGUID, const QString strFileName)
 {
     m_mapFile.insert(strGUID, strFileName);
+    m_networkAccessManager->setNote(kbGUID, strGUID);
 
     if (m_bEditorInited) {
         viewDocumentInEditor(m_bEditingMode);
@@ -1721,8 +1733,11 @@ void CWizDocumentWebViewLoaderThread::run()
             continue;
         }
         //
+        // resources are read by network access manager when displayed,
+        // except protected notes, user cipher may be cleared once loaded
         QString strHtmlFile;
-        if (db.DocumentToTempHtmlFile(data, strHtmlFile))
+        bool bExtractResources = data.nProtected ? true : false;
+        if (db.DocumentToTempHtmlFile(data, strHtmlFile, "index.html", bExtractResources))
         {
             emit loaded(kbGuid, docGuid, strHtmlFile);
         }
@@ -1853,6 +1868,21 @@ void CWizDocumentWebViewSaverThread::run()
         //
         qDebug() << "Saving note: " << doc.strTitle;
 
+        QString kbGuid = db.IsGroup() ? db.kbGUID() : "";
+
+        // resources which have not been displayed are not in temp folder yet,
+        // note would lose them if saved without
+        if (!data.htmlFile.isEmpty() && !doc.nProtected
+                && PathFileExists(db.GetDocumentFileName(doc.strGUID)))
+        {
+            if (!db.extractZiwFileToFolder(doc, WizExtractFilePath(data.htmlFile), false))
+            {
+                qDebug() << "Save note failed, can't extract resources: " << doc.strTitle;
+                emit saved(kbGuid, doc.strGUID, false);
+                continue;
+            }
+        }
+
         bool notify = false;    //don't notify
         bool ok = db.UpdateDocumentData(doc, data.html, data.htmlFile, data.flags, notify);
 
@@ -1866,9 +1896,157 @@ void CWizDocumentWebViewSaverThread::run()
             qDebug() << "Save note failed: " << doc.strTitle;
         }
 
-        QString kbGuid = db.IsGroup() ? db.kbGUID() : "";
         emit saved(kbGuid, doc.strGUID, ok);
 
     };
 }
 
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CWizDocumentWebViewNetworkAccessManager::CWizDocumentWebViewNetworkAccessManager(CWizDatabaseManager& dbMgr,
+                                                                                 QObject* parent)
+    : QNetworkAccessManager(parent)
+    , m_dbMgr(dbMgr)
+{
+}
+
+void CWizDocumentWebViewNetworkAccessManager::setNote(const QString& strKbGUID, const QString& strGUID)
+{
+    m_strKbGUID = strKbGUID;
+    m_strGUID = strGUID;
+}
+
+static QString WizResourceContentType(const QString& strFileName)
+{
+    QString strExt = WizExtractFileExt(strFileName).toLower();
+    if (strExt == ".png")
+        return "image/png";
+    else if (strExt == ".jpg" || strExt == ".jpeg")
+        return "image/jpeg";
+    else if (strExt == ".gif")
+        return "image/gif";
+    else if (strExt == ".bmp")
+        return "image/bmp";
+    else if (strExt == ".svg")
+        return "image/svg+xml";
+    else if (strExt == ".css")
+        return "text/css";
+    else if (strExt == ".js")
+        return "application/javascript";
+
+    return "application/octet-stream";
+}
+
+QNetworkReply* CWizDocumentWebViewNetworkAccessManager::createRequest(Operation op,
+                                                                      const QNetworkRequest& request,
+                                                                      QIODevice* outgoingData)
+{
+    QUrl url = request.url();
+    if (op != GetOperation || url.scheme() != "file")
+        return QNetworkAccessManager::createRequest(op, request, outgoingData);
+
+    // <temp path>/<guid>/index_files/xxx
+    QString strTempPath = Utils::PathResolve::tempPath();
+    QString strFileName = url.toLocalFile();
+    if (!strFileName.startsWith(strTempPath))
+        return QNetworkAccessManager::createRequest(op, request, outgoingData);
+
+    QString strName = strFileName.mid(strTempPath.length());
+    int nPos = strName.indexOf('/');
+    QString strGUID = strName.left(nPos);
+    QString strNameInZip = strName.mid(nPos + 1);
+    if (nPos <= 0 || !strNameInZip.startsWith("index_files/") || strGUID != m_strGUID)
+        return QNetworkAccessManager::createRequest(op, request, outgoingData);
+
+    // protected notes are extracted to temp folder when loaded
+    CWizDatabase& db = m_dbMgr.db(m_strKbGUID);
+    WIZDOCUMENTDATA doc;
+    if (!db.DocumentFromGUID(strGUID, doc) || doc.nProtected)
+        return QNetworkAccessManager::createRequest(op, request, outgoingData);
+
+    // nothing is written to temp folder, saver thread extracts missing
+    // resources before saving
+    QNetworkRequest req(request);
+    req.setHeader(QNetworkRequest::ContentTypeHeader, WizResourceContentType(strFileName));
+    return new CWizDocumentWebViewResourceReply(db, doc, strNameInZip, strFileName, req, this);
+}
+
+
+CWizDocumentWebViewResourceReply::CWizDocumentWebViewResourceReply(CWizDatabase& db,
+                                                                   const WIZDOCUMENTDATA& doc,
+                                                                   const QString& strNameInZip,
+                                                                   const QString& strFileName,
+                                                                   const QNetworkRequest& request,
+                                                                   QObject* parent)
+    : QNetworkReply(parent)
+    , m_db(db)
+    , m_doc(doc)
+    , m_strNameInZip(strNameInZip)
+    , m_strFileName(strFileName)
+    , m_nOffset(0)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(QNetworkAccessManager::GetOperation);
+    setHeader(QNetworkRequest::ContentTypeHeader, request.header(QNetworkRequest::ContentTypeHeader));
+
+    // don't unzip on gui thread, signals are emitted after reply is
+    // returned to webkit anyway
+    connect(&m_watcher, SIGNAL(finished()), SLOT(on_loaded()));
+    m_watcher.setFuture(QtConcurrent::run(this, &CWizDocumentWebViewResourceReply::load));
+}
+
+CWizDocumentWebViewResourceReply::~CWizDocumentWebViewResourceReply()
+{
+    // deleted by webkit before loaded
+    m_watcher.waitForFinished();
+}
+
+bool CWizDocumentWebViewResourceReply::load()
+{
+    if (m_db.extractZiwFileResource(m_doc, m_strNameInZip, m_data))
+        return true;
+
+    // such as images inserted by editor and not saved yet
+    QFile file(m_strFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_data = file.readAll();
+    return true;
+}
+
+qint64 CWizDocumentWebViewResourceReply::bytesAvailable() const
+{
+    return m_data.size() - m_nOffset + QNetworkReply::bytesAvailable();
+}
+
+qint64 CWizDocumentWebViewResourceReply::readData(char* data, qint64 maxSize)
+{
+    if (m_nOffset >= m_data.size())
+        return -1;
+
+    qint64 nLen = qMin(maxSize, m_data.size() - m_nOffset);
+    memcpy(data, m_data.constData() + m_nOffset, nLen);
+    m_nOffset += nLen;
+
+    return nLen;
+}
+
+void CWizDocumentWebViewResourceReply::on_loaded()
+{
+    if (m_watcher.result()) {
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        setHeader(QNetworkRequest::ContentLengthHeader, m_data.size());
+
+        emit metaDataChanged();
+        emit readyRead();
+    } else {
+        setError(ContentNotFoundError, tr("Can't read %1").arg(m_strFileName));
+        emit error(ContentNotFoundError);
+    }
+
+    setFinished(true);
+    emit finished();
+}
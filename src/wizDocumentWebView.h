@@ -9,6 +9,9 @@
 #include <QMap>
 #include <QThread>
 #include <QWaitCondition>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QFutureWatcher>
 
 //#include "wizdownloadobjectdatadialog.h"
 #include "wizdef.h"
@@ -93,6 +96,64 @@ private:
     bool m_stop;
 };
 
+/*
+ * Serve index_files/ of notes in temp folder straight out of note file,
+ * so that only index.html is extracted when note is opened.
+ * Protected notes are extracted at once, user cipher may be cleared after
+ * the note is loaded.
+ */
+class CWizDocumentWebViewNetworkAccessManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+public:
+    CWizDocumentWebViewNetworkAccessManager(CWizDatabaseManager& dbMgr, QObject* parent = 0);
+
+    // note shown by web view, requests of other notes are read from disk
+    void setNote(const QString& strKbGUID, const QString& strGUID);
+
+protected:
+    virtual QNetworkReply* createRequest(Operation op, const QNetworkRequest& request,
+                                         QIODevice* outgoingData = 0);
+
+private:
+    CWizDatabaseManager& m_dbMgr;
+    QString m_strKbGUID;
+    QString m_strGUID;
+};
+
+class CWizDocumentWebViewResourceReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    // entry is read on thread pool, or from strFileName if not in note
+    CWizDocumentWebViewResourceReply(CWizDatabase& db, const WIZDOCUMENTDATA& doc,
+                                     const QString& strNameInZip, const QString& strFileName,
+                                     const QNetworkRequest& request, QObject* parent = 0);
+    virtual ~CWizDocumentWebViewResourceReply();
+
+    virtual void abort() {}
+    virtual qint64 bytesAvailable() const;
+    virtual bool isSequential() const { return true; }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize);
+
+private Q_SLOTS:
+    void on_loaded();
+
+private:
+    CWizDatabase& m_db;
+    WIZDOCUMENTDATA m_doc;
+    QString m_strNameInZip;
+    QString m_strFileName;
+
+    QFutureWatcher<bool> m_watcher;
+    QByteArray m_data;
+    qint64 m_nOffset;
+
+    bool load();
+};
+
 class CWizDocumentWebViewPage: public QWebPage
 {
     Q_OBJECT
@@ -226,6 +287,7 @@ private:
     CWizDocumentTransitionView* m_transitionView;
     CWizDocumentWebViewLoaderThread* m_docLoadThread;
     CWizDocumentWebViewSaverThread* m_docSaverThread;
+    CWizDocumentWebViewNetworkAccessManager* m_networkAccessManager;
 
     QPointer<CWizEditorInsertLinkForm> m_editorInsertLinkForm;
     QPointer<CWizEditorInsertTableForm> m_editorInsertTableForm;
@@ -232,6 +232,9 @@ void CWizAttachmentListView::openAttachment(CWizAttachmentListViewItem* item)
         return;
     }
 
+    // may be edited in place, the blob shared with others is left as is
+    db.DetachAttachmentBlob(attachment.strGUID);
+
     QDesktopServices::openUrl(QUrl::fromLocalFile(strFileName));
 
     CWizFileMonitor& monitor = CWizFileMonitor::instance();
@@ -4,7 +4,7 @@
 #include <QtGlobal>
 
 #define WIZ_CLIENT_VERSION  "2.1.12"
-#define WIZNOTE_FTS_VERSION "5"
+#define WIZNOTE_FTS_VERSION "6"
 #define WIZNOTE_THUMB_VERSION "3"
 
 #if defined Q_OS_MAC
@@ -1135,8 +1135,9 @@ void MainWindow::init()
     connect(m_msgList, SIGNAL(itemSelectionChanged()), SLOT(on_message_itemSelectionChanged()));
     connect(m_msgList, SIGNAL(loacteDocumetRequest(QString,QString)), SLOT(locateDocument(QString,QString)));
     connect(m_documents, SIGNAL(documentsSelectionChanged()), SLOT(on_documents_itemSelectionChanged()));
-    connect(m_documents, SIGNAL(itemDoubleClicked(QListWidgetItem*)), SLOT(on_documents_itemDoubleClicked(QListWidgetItem*)));
+    connect(m_documents, SIGNAL(doubleClicked(const QModelIndex&)), SLOT(on_documents_itemDoubleClicked(const QModelIndex&)));
     connect(m_documents, SIGNAL(lastDocumentDeleted()), SLOT(on_documents_lastDocumentDeleted()));
+    connect(m_documents, SIGNAL(loadMoreRequested()), SLOT(on_documents_loadMoreRequested()));
 
 #ifndef Q_OS_MAC
     QTimer::singleShot(100, this, SLOT(adjustToolBarLayout()));
@@ -1592,6 +1593,14 @@ void MainWindow::on_searchProcess(const QString& strKeywords, const CWizDocument
     on_documents_itemSelectionChanged();
 }
 
+void MainWindow::on_documents_loadMoreRequested()
+{
+    if (m_strSearchKeywords.isEmpty())
+        return;
+
+    m_searcher->searchMore();
+}
+
 #ifndef Q_OS_MAC
 void MainWindow::on_actionPopupMainMenu_triggered()
 {
@@ -1718,12 +1727,11 @@ void MainWindow::on_documents_itemSelectionChanged()
     }
 }
 
-void MainWindow::on_documents_itemDoubleClicked(QListWidgetItem* item)
+void MainWindow::on_documents_itemDoubleClicked(const QModelIndex& index)
 {
-    CWizDocumentListViewItem* pItem = dynamic_cast<CWizDocumentListViewItem*>(item);
-    if (pItem)
+    if (index.isValid())
     {
-        WIZDOCUMENTDATA doc = pItem->document();
+        WIZDOCUMENTDATA doc = m_documents->documentFromIndex(index);
         if (m_dbMgr.db(doc.strKbGUID).IsDocumentDownloaded(doc.strGUID))
         {
             viewDocumentInFloatWidget(doc);
@@ -2043,7 +2051,7 @@ void MainWindow::viewDocumentByWizKMURL(const QString &strKMURL)
     {
         //m_category->setCurrentItem();
         m_documents->blockSignals(true);
-        m_documents->setCurrentItem(0);
+        m_documents->clearSelection();
         m_documents->blockSignals(false);
         viewDocument(document, true);
     }
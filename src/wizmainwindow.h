@@ -279,10 +279,11 @@ public Q_SLOTS:
 
     void on_category_itemSelectionChanged();
     void on_documents_itemSelectionChanged();
-    void on_documents_itemDoubleClicked(QListWidgetItem * item);
+    void on_documents_itemDoubleClicked(const QModelIndex& index);
     void on_message_itemSelectionChanged();
     void on_documents_documentCountChanged();
     void on_documents_lastDocumentDeleted();
+    void on_documents_loadMoreRequested();
     void on_documents_hintChanged(const QString& strHint);
     void on_documents_viewTypeChanged(int type);
     void on_documents_sortingTypeChanged(int type);
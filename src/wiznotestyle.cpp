@@ -5,7 +5,6 @@
 
 #include "wizCategoryView.h"
 #include "wizDocumentListView.h"
-#include "wizDocumentListViewItem.h"
 #include "wizattachmentlistwidget.h"
 #include "share/wizdrawtexthelper.h"
 #include "share/wizqthelper.h"
@@ -363,11 +362,6 @@ void CWizNoteStyle::drawControl(ControlElement element, const QStyleOption *opti
                 view->drawItem(painter, vopt);
                 //drawMessageListViewItem(vopt, painter, view);
             }
-            else if (const CWizDocumentListView *view = dynamic_cast<const CWizDocumentListView *>(widget))
-            {
-                view->drawItem(painter, vopt);
-                //drawDocumentListViewItem(vopt, painter, view);
-            }
             else if (const CWizMultiLineListWidget *view = dynamic_cast<const CWizMultiLineListWidget *>(widget))
             {
                 drawMultiLineListWidgetItem(vopt, painter, view);